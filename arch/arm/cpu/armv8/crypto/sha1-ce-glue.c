@@ -0,0 +1,31 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * sha1-ce-glue.c - SHA-1 using ARMv8 Crypto Extensions
+ *
+ * Copyright (C) 2014 - 2017 Linaro Ltd <ard.biesheuvel@linaro.org>
+ */
+
+#include <linux/kernel.h>
+#include <linux/linkage.h>
+#include <asm/armv8/cpu.h>
+#include <u-boot/sha1.h>
+
+asmlinkage void sha1_ce_transform(u32 *state, u8 const *src, int blocks);
+
+bool sha1_ce_blocks(sha1_context *ctx, const unsigned char *data, int blocks)
+{
+	u32 state[5];
+	int i;
+
+	if (!has_sha1_ce())
+		return false;
+
+	/* sha1_context keeps the digest in longs, the instructions use words */
+	for (i = 0; i < 5; i++)
+		state[i] = ctx->state[i];
+	sha1_ce_transform(state, data, blocks);
+	for (i = 0; i < 5; i++)
+		ctx->state[i] = state[i];
+
+	return true;
+}
@@ -0,0 +1,24 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * sha512-ce-glue.c - SHA-384/SHA-512 using ARMv8 Crypto Extensions
+ *
+ * Copyright (C) 2018 Linaro Ltd <ard.biesheuvel@linaro.org>
+ */
+
+#include <linux/kernel.h>
+#include <linux/linkage.h>
+#include <asm/armv8/cpu.h>
+#include <u-boot/sha512.h>
+
+asmlinkage void sha512_ce_transform(u64 *state, u8 const *src, int blocks);
+
+bool sha512_ce_blocks(sha512_context *ctx, const uint8_t *data, int blocks)
+{
+	/* The SHA-512 instructions are optional, even with SHA-256 present */
+	if (!has_sha512_ce())
+		return false;
+
+	sha512_ce_transform(ctx->state, data, blocks);
+
+	return true;
+}
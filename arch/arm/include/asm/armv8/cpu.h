@@ -24,3 +24,28 @@ static inline unsigned int read_midr(void)
 			 MIDR_PARTNUM_SHIFT) == MIDR_PARTNUM_CORTEX_A53)
 #define is_cortex_a72() (((read_midr() & MIDR_PARTNUM_MASK) >>\
 			 MIDR_PARTNUM_SHIFT) == MIDR_PARTNUM_CORTEX_A72)
+
+#define ID_AA64ISAR0_SHA1_SHIFT		8
+#define ID_AA64ISAR0_SHA2_SHIFT		12
+#define ID_AA64ISAR0_CRC32_SHIFT	16
+#define ID_AA64ISAR0_FIELD(reg, shift)	(((reg) >> (shift)) & 0xf)
+
+/* SHA2 field values: 1 is SHA-256 only, 2 adds SHA-512 */
+#define ID_AA64ISAR0_SHA2_SHA256	1
+#define ID_AA64ISAR0_SHA2_SHA512	2
+
+static inline unsigned long read_id_aa64isar0(void)
+{
+	unsigned long val;
+
+	asm volatile("mrs %0, id_aa64isar0_el1" : "=r" (val));
+
+	return val;
+}
+
+#define has_sha1_ce() (ID_AA64ISAR0_FIELD(read_id_aa64isar0(), \
+			ID_AA64ISAR0_SHA1_SHIFT) != 0)
+#define has_sha512_ce() (ID_AA64ISAR0_FIELD(read_id_aa64isar0(), \
+			 ID_AA64ISAR0_SHA2_SHIFT) >= ID_AA64ISAR0_SHA2_SHA512)
+#define has_crc32() (ID_AA64ISAR0_FIELD(read_id_aa64isar0(), \
+		     ID_AA64ISAR0_CRC32_SHIFT) != 0)
@@ -178,43 +178,6 @@ static int spl_romapi_load_image_seekable(struct spl_image_info *spl_image,
 	return 0;
 }
 
-static ulong spl_ram_load_read(struct spl_load_info *load, ulong sector,
-			       ulong count, void *buf)
-{
-	memcpy(buf, (void *)(sector), count);
-
-	if (load->priv) {
-		ulong *p = (ulong *)load->priv;
-		ulong total = sector + count;
-
-		if (total > *p)
-			*p = total;
-	}
-
-	return count;
-}
-
-static ulong get_fit_image_size(void *fit)
-{
-	struct spl_image_info spl_image;
-	struct spl_load_info spl_load_info;
-	ulong last = (ulong)fit;
-
-	memset(&spl_load_info, 0, sizeof(spl_load_info));
-	spl_load_info.bl_len = 1;
-	spl_load_info.read = spl_ram_load_read;
-	spl_load_info.priv = &last;
-
-        /* We call load_simple_fit is just to get total size, the image is not downloaded,
-         * so should bypass authentication
-         */
-	spl_image.flags = SPL_FIT_BYPASS_POST_LOAD;
-	spl_load_simple_fit(&spl_image, &spl_load_info,
-			    (uintptr_t)fit, fit);
-
-	return last - (ulong)fit;
-}
-
 static u8 *search_fit_header(u8 *p, int size)
 {
 	int i;
@@ -273,28 +236,170 @@ static int img_info_size(void *img_hdr)
 #endif
 }
 
-static int img_total_size(void *img_hdr)
+/* Number of directly placed regions remembered in a stream boot */
+#define ROMAPI_STREAM_PLACED	8
+
+/**
+ * struct romapi_placed - part of the stream read straight to its destination
+ *
+ * @start:	Offset of the data in the stream
+ * @len:	Number of bytes
+ * @buf:	Where the data was put
+ */
+struct romapi_placed {
+	u32 start;
+	u32 len;
+	u8 *buf;
+};
+
+/**
+ * struct romapi_stream - state of a boot from a stream device
+ *
+ * The ROM can only read forwards. Data which is skipped over, and the pages
+ * which are only partly wanted, are staged at their offset from @base. Whole
+ * pages which are wanted go straight to the buffer given to the read, which
+ * is normally the final load address of an image.
+ *
+ * @base:	Staging address of the start of the stream
+ * @hdr:	Offset of the image header in the stream
+ * @pos:	Offset of the next byte the ROM will return
+ * @pagesize:	Unit of ROM reads
+ * @nr_placed:	Number of valid entries in @placed
+ * @placed:	Data which was read straight to its destination, and so is
+ *		not in the staging area
+ */
+struct romapi_stream {
+	u8 *base;
+	u32 hdr;
+	u32 pos;
+	u32 pagesize;
+	int nr_placed;
+	struct romapi_placed placed[ROMAPI_STREAM_PLACED];
+};
+
+/* The ROM cannot write to the i.MX8MP OCRAM ECC region */
+static bool romapi_can_write(void *buf, u32 size)
 {
-	if (IS_ENABLED(CONFIG_SPL_LOAD_FIT)) {
-		return get_fit_image_size(img_hdr);
-	} else if (IS_ENABLED(CONFIG_SPL_LOAD_IMX_CONTAINER)) {
-		int total = get_container_size((ulong)img_hdr, NULL);
+	return !is_imx8mp() || (ulong)buf + size <= 0x980000 ||
+	       (ulong)buf > 0x98ffff;
+}
+
+static int romapi_stream_download(struct romapi_stream *ss, void *buf,
+				  u32 size)
+{
+	volatile gd_t *pgd = gd;
+	int ret;
+
+	ret = g_rom_api->download_image(buf, 0, size,
+					((uintptr_t)buf) ^ size);
+	set_gd(pgd);
+
+	if (ret != ROM_API_OKAY) {
+		printf("ROMAPI: stream download failure %d\n", size);
+		return -EIO;
+	}
+	ss->pos += size;
+
+	return 0;
+}
+
+/* Read @size bytes from the stream into the staging area */
+static int romapi_stream_stage(struct romapi_stream *ss, u32 size)
+{
+	return romapi_stream_download(ss, ss->base + ss->pos, size);
+}
+
+/* Copy data which the stream has already gone past */
+static int romapi_stream_copy(struct romapi_stream *ss, u32 start, u8 *dst,
+			      u32 len)
+{
+	struct romapi_placed *pl;
+	int i;
+
+	for (i = 0; i < ss->nr_placed; i++) {
+		pl = &ss->placed[i];
+		if (start >= pl->start + pl->len || start + len <= pl->start)
+			continue;
+		if (start < pl->start || start + len > pl->start + pl->len) {
+			printf("ROMAPI: cannot read back 0x%x, size 0x%x\n",
+			       start, len);
+			return -ESPIPE;
+		}
+		memcpy(dst, pl->buf + start - pl->start, len);
+		return 0;
+	}
+	memcpy(dst, ss->base + start, len);
+
+	return 0;
+}
+
+static ulong spl_romapi_read_stream(struct spl_load_info *load, ulong sector,
+				    ulong count, void *buf)
+{
+	struct romapi_stream *ss = load->priv;
+	u32 start = ss->hdr + sector;
+	u32 end = start + count;
+	u8 *dst = buf;
+	u32 len;
+
+	/* Data before the stream position was staged or placed already */
+	if (start < ss->pos) {
+		len = min(end, ss->pos) - start;
+		if (romapi_stream_copy(ss, start, dst, len))
+			return 0;
+		start += len;
+		dst += len;
+	}
+	if (start == end)
+		return count;
 
-		if (total < 0) {
-			printf("invalid container image\n");
+	/* Skip to the page holding @start, and take the head from there */
+	if (start > ss->pos) {
+		len = roundup(start - ss->pos, ss->pagesize);
+		if (romapi_stream_stage(ss, len))
 			return 0;
+		len = min(end, ss->pos) - start;
+		memcpy(dst, ss->base + start, len);
+		start += len;
+		dst += len;
+	}
+
+	/* Read all the whole pages at once, straight into the buffer */
+	len = rounddown(end - start, ss->pagesize);
+	if (len) {
+		if (ss->nr_placed < ROMAPI_STREAM_PLACED &&
+		    romapi_can_write(dst, len)) {
+			struct romapi_placed *pl = &ss->placed[ss->nr_placed++];
+
+			pl->start = start;
+			pl->len = len;
+			pl->buf = dst;
+			if (romapi_stream_download(ss, dst, len))
+				return 0;
+		} else {
+			if (romapi_stream_stage(ss, len))
+				return 0;
+			memcpy(dst, ss->base + start, len);
 		}
+		start += len;
+		dst += len;
+	}
 
-		return total;
+	/* The last partial page */
+	if (start < end) {
+		if (romapi_stream_stage(ss, ss->pagesize))
+			return 0;
+		memcpy(dst, ss->base + start, end - start);
 	}
 
-	return 0;
+	return count;
 }
 
 static int spl_romapi_load_image_stream(struct spl_image_info *spl_image,
 					struct spl_boot_device *bootdev)
 {
 	struct spl_load_info load;
+	struct romapi_stream ss;
 	volatile gd_t *pgd = gd;
 	u32 pagesize, pg;
 	int ret;
@@ -302,7 +407,6 @@ static int spl_romapi_load_image_stream(struct spl_image_info *spl_image,
 	u8 *p = (u8 *)CONFIG_SPL_IMX_ROMAPI_LOADADDR;
 	u8 *phdr = NULL;
 	int imagesize;
-	int total;
 
 	ret = g_rom_api->query_boot_infor(QUERY_PAGE_SZ, &pagesize,
 					  ((uintptr_t)&pagesize) ^ QUERY_PAGE_SZ);
@@ -315,15 +419,13 @@ static int spl_romapi_load_image_stream(struct spl_image_info *spl_image,
 	if (pg < 1024)
 		pg = 1024;
 
-	for (i = 0; i < 640; i++) {
-		ret = g_rom_api->download_image(p, 0, pg,
-						((uintptr_t)p) ^ pg);
-		set_gd(pgd);
+	memset(&ss, 0, sizeof(ss));
+	ss.base = p;
+	ss.pagesize = pagesize;
 
-		if (ret != ROM_API_OKAY) {
-			puts("Steam(USB) download failure\n");
+	for (i = 0; i < 640; i++) {
+		if (romapi_stream_stage(&ss, pg))
 			return -1;
-		}
 
 		phdr = search_img_header(p, pg);
 		p += pg;
@@ -338,67 +440,31 @@ static int spl_romapi_load_image_stream(struct spl_image_info *spl_image,
 	}
 
 	if (p - phdr < img_header_size()) {
-		ret = g_rom_api->download_image(p, 0, pg,  ((uintptr_t)p) ^ pg);
-		set_gd(pgd);
-
-		if (ret != ROM_API_OKAY) {
-			puts("Steam(USB) download failure\n");
+		if (romapi_stream_stage(&ss, pg))
 			return -1;
-		}
-
 		p += pg;
 	}
 
 	imagesize = img_info_size(phdr);
 	printf("Find img info 0x&%p, size %d\n", phdr, imagesize);
 
+	/* Stage the rest of the header; the images are read as needed */
 	if (p - phdr < imagesize) {
-		imagesize -= p - phdr;
-		/*need pagesize hear after ROM fix USB problme*/
-		imagesize += pg - 1;
-		imagesize /= pg;
-		imagesize *= pg;
-
-		printf("Need continue download %d\n", imagesize);
-
-		ret = g_rom_api->download_image(p, 0, imagesize,
-						((uintptr_t)p) ^ imagesize);
-		set_gd(pgd);
-
-		p += imagesize;
-
-		if (ret != ROM_API_OKAY) {
-			printf("Failure download %d\n", imagesize);
+		imagesize = roundup(imagesize - (p - phdr), pg);
+		if (romapi_stream_stage(&ss, imagesize))
 			return -1;
-		}
 	}
-
-	total = img_total_size(phdr);
-	total += 3;
-	total &= ~0x3;
-
-	imagesize = total - (p - phdr);
-
-	imagesize += pagesize - 1;
-	imagesize /= pagesize;
-	imagesize *= pagesize;
-
-	printf("Download %d, Total size %d\n", imagesize, total);
-
-	ret = g_rom_api->download_image(p, 0, imagesize,
-					((uintptr_t)p) ^ imagesize);
-	set_gd(pgd);
-	if (ret != ROM_API_OKAY)
-		printf("ROM download failure %d\n", imagesize);
+	ss.hdr = phdr - ss.base;
 
 	memset(&load, 0, sizeof(load));
 	load.bl_len = 1;
-	load.read = spl_ram_load_read;
+	load.read = spl_romapi_read_stream;
+	load.priv = &ss;
 
 	if (IS_ENABLED(CONFIG_SPL_LOAD_FIT))
-		return spl_load_simple_fit(spl_image, &load, (ulong)phdr, phdr);
+		return spl_load_simple_fit(spl_image, &load, 0, phdr);
 	else if (IS_ENABLED(CONFIG_SPL_LOAD_IMX_CONTAINER))
-		return spl_load_imx_container(spl_image, &load, (ulong)phdr);
+		return spl_load_imx_container(spl_image, &load, 0);
 
 	return -1;
 }
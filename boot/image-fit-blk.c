@@ -0,0 +1,282 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Load a FIT with external data directly from a block device
+ *
+ * Only the FIT structure is staged in memory. The data of every sub-image
+ * used by the selected configuration is read straight to its load address
+ * where possible, everything else stays on the device.
+ */
+
+#include <common.h>
+#include <blk.h>
+#include <image.h>
+#include <log.h>
+#include <mapmem.h>
+#include <linux/libfdt.h>
+
+/* Room needed to turn one data-offset into a data-position property */
+#define FIT_BLK_PROP_SLACK	16
+
+/**
+ * fit_blk_read() - read a byte range of the FIT
+ *
+ * @rd:		Reader for the device holding the FIT
+ * @offset:	Byte offset from the start of the FIT
+ * @len:	Number of bytes to read
+ * @buf:	Buffer to read into
+ * Return: 0 if OK, -EIO on error
+ */
+static int fit_blk_read(struct image_reader *rd, ulong offset, ulong len,
+			void *buf)
+{
+	if (image_reader_pread(rd, offset, buf, len) != len)
+		return -EIO;
+
+	return 0;
+}
+
+/**
+ * fit_blk_image_used() - check whether a configuration refers to an image
+ *
+ * @fit:	FIT to check
+ * @conf:	Offset of the configuration node
+ * @name:	Name of the image node
+ * Return: true if any image property of @conf lists @name
+ */
+static bool fit_blk_image_used(const void *fit, int conf, const char *name)
+{
+	const char *prop;
+	int offset;
+
+	fdt_for_each_property_offset(offset, fit, conf) {
+		fdt_getprop_by_offset(fit, offset, &prop, NULL);
+		if (!strcmp(prop, FIT_DESC_PROP) ||
+		    !strcmp(prop, "compatible"))
+			continue;
+		if (fdt_stringlist_search(fit, conf, prop, name) >= 0)
+			return true;
+	}
+
+	return false;
+}
+
+/**
+ * fit_blk_data() - find the external data of an image on the device
+ *
+ * @fit:	FIT containing the image
+ * @node:	Offset of the image node
+ * @old_base:	Offset of the external data in the FIT as stored
+ * @devoffp:	Returns the offset of the data from the start of the FIT
+ * @lenp:	Returns the size of the data
+ * Return: 0 if OK, -ENOENT if the image has embedded data, -EINVAL if the
+ * data properties are bad
+ */
+static int fit_blk_data(const void *fit, int node, ulong old_base,
+			ulong *devoffp, int *lenp)
+{
+	int data_offset;
+
+	if (!fit_image_get_data_position(fit, node, &data_offset))
+		*devoffp = data_offset;
+	else if (!fit_image_get_data_offset(fit, node, &data_offset))
+		*devoffp = old_base + data_offset;
+	else
+		return -ENOENT;
+
+	if (*devoffp < old_base || fit_image_get_data_size(fit, node, lenp))
+		return -EINVAL;
+
+	return 0;
+}
+
+/**
+ * fit_blk_overlaps() - check a range against the images already placed
+ *
+ * The images before @node have been given a data-position property.
+ * Those at or above @stage_end were read straight to their load address.
+ *
+ * @fit:	FIT being loaded
+ * @images:	Offset of the images node
+ * @node:	Offset of the image node being placed
+ * @addr:	Address of the FIT
+ * @stage_end:	First address after the staging area
+ * @dst:	Start of the range to check
+ * @len:	Size of the range
+ * Return: true if the range overlaps an image already read to its load
+ * address
+ */
+static bool fit_blk_overlaps(const void *fit, int images, int node,
+			     ulong addr, ulong stage_end, ulong dst, int len)
+{
+	int other, pos, size;
+	ulong start;
+
+	fdt_for_each_subnode(other, fit, images) {
+		if (other == node)
+			break;
+		if (fit_image_get_data_position(fit, other, &pos) ||
+		    fit_image_get_data_size(fit, other, &size))
+			continue;
+		start = addr + pos;
+		if (start >= stage_end && start < dst + len &&
+		    dst < start + size)
+			return true;
+	}
+
+	return false;
+}
+
+/**
+ * fit_blk_direct_addr() - get the address an image can be read to directly
+ *
+ * An image can only be placed at its load address if nothing needs to
+ * happen to it between reading and booting, and if that address can be
+ * described by a data-position property, i.e. it lies above the FIT. It
+ * must also stay clear of the area where other images are staged.
+ *
+ * @fit:	FIT containing the image
+ * @node:	Offset of the image node
+ * @stage_end:	First address after the FIT structure and the staging area
+ * @loadp:	Returns the load address
+ * Return: true if the image can be read to @loadp
+ */
+static bool fit_blk_direct_addr(const void *fit, int node, ulong stage_end,
+				ulong *loadp)
+{
+	ulong fit_addr = map_to_sysmem(fit);
+	uint8_t comp = IH_COMP_NONE;
+	uint8_t type;
+
+	if (fit_image_get_load(fit, node, loadp))
+		return false;
+	if (!fit_image_get_type(fit, node, &type) &&
+	    type == IH_TYPE_KERNEL_NOLOAD)
+		return false;
+	fit_image_get_comp(fit, node, &comp);
+	if (comp != IH_COMP_NONE)
+		return false;
+
+	return *loadp >= stage_end && *loadp - fit_addr <= INT_MAX;
+}
+
+int fit_blk_load(struct blk_desc *desc, ulong start, ulong addr,
+		 const char *conf_name)
+{
+	void *fit = map_sysmem(addr, sizeof(struct fdt_header));
+	struct image_blk_reader brd;
+	ulong old_base, new_base, stage_end;
+	int images, conf, node;
+	int count = 0;
+	ulong size;
+	u64 dev_size;
+	int ret;
+
+	/* A 32-bit ulong cannot hold the size of every device */
+	dev_size = (u64)(desc->lba - start) * desc->blksz;
+	image_blk_reader_init(&brd, desc, start,
+			      min_t(u64, dev_size, ULONG_MAX));
+
+	/* Stage the FIT structure, but none of its external data */
+	ret = fit_blk_read(&brd.rd, 0, sizeof(struct fdt_header), fit);
+	if (ret)
+		return ret;
+	if (fdt_check_header(fit)) {
+		printf("Bad FIT header\n");
+		return -ENOEXEC;
+	}
+	size = fdt_totalsize(fit);
+	fit = map_sysmem(addr, size);
+	ret = fit_blk_read(&brd.rd, 0, size, fit);
+	if (ret)
+		return ret;
+	ret = fit_check_format(fit, size);
+	if (ret) {
+		printf("Bad FIT image format\n");
+		return ret;
+	}
+
+	images = fdt_path_offset(fit, FIT_IMAGES_PATH);
+	if (images < 0) {
+		printf("Can't find images parent node '%s' (%s)\n",
+		       FIT_IMAGES_PATH, fdt_strerror(images));
+		return -EINVAL;
+	}
+	fdt_for_each_subnode(node, fit, images)
+		count++;
+
+	/*
+	 * Every image is switched to data-position, so make room for the
+	 * properties. This moves the start of the external data, which is
+	 * why data-offset cannot be kept.
+	 */
+	old_base = ALIGN(size, 4);
+	new_base = ALIGN(size + (count + 1) * FIT_BLK_PROP_SLACK +
+			 sizeof(FIT_DATA_POSITION_PROP), 4);
+	fit = map_sysmem(addr, new_base);
+	ret = fdt_open_into(fit, fit, new_base);
+	if (ret)
+		return -ENOSPC;
+	images = fdt_path_offset(fit, FIT_IMAGES_PATH);
+
+	conf = fit_conf_get_node(fit, conf_name);
+	if (conf < 0) {
+		printf("Could not find configuration node\n");
+		return -ENOENT;
+	}
+
+	/* Images which are not read directly are staged up to here */
+	stage_end = addr + new_base;
+	fdt_for_each_subnode(node, fit, images) {
+		ulong devoff;
+		int len;
+
+		ret = fit_blk_data(fit, node, old_base, &devoff, &len);
+		if (ret == -ENOENT)
+			continue;
+		if (ret)
+			return ret;
+		stage_end = max(stage_end, addr + new_base + devoff - old_base +
+				len);
+	}
+
+	fdt_for_each_subnode(node, fit, images) {
+		const char *name = fit_get_name(fit, node, NULL);
+		ulong devoff, dst, pos;
+		int len;
+
+		ret = fit_blk_data(fit, node, old_base, &devoff, &len);
+		if (ret == -ENOENT)
+			continue;	/* Embedded data */
+		if (ret)
+			return ret;
+
+		/* Unused images keep their place, relative to the new base */
+		pos = new_base + devoff - old_base;
+		if (fit_blk_image_used(fit, conf, name)) {
+			if (fit_blk_direct_addr(fit, node, stage_end, &dst) &&
+			    !fit_blk_overlaps(fit, images, node, addr,
+					      stage_end, dst, len)) {
+				pos = dst - addr;
+				printf("   Reading '%s' to 0x%08lx\n", name,
+				       dst);
+			} else {
+				dst = addr + pos;
+				printf("   Staging '%s' at 0x%08lx\n", name,
+				       dst);
+			}
+			ret = fit_blk_read(&brd.rd, devoff, len,
+					   map_sysmem(dst, len));
+			if (ret)
+				return ret;
+		}
+
+		ret = fdt_delprop(fit, node, FIT_DATA_OFFSET_PROP);
+		if (ret && ret != -FDT_ERR_NOTFOUND)
+			return -ENOSPC;
+		ret = fdt_setprop_u32(fit, node, FIT_DATA_POSITION_PROP, pos);
+		if (ret)
+			return -ENOSPC;
+	}
+
+	return 0;
+}
@@ -0,0 +1,127 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Readers supplying image data straight from storage
+ *
+ * These let image loaders and decompressors pull their input in chunks
+ * instead of needing a copy of the whole image in memory first.
+ */
+
+#include <common.h>
+#include <blk.h>
+#include <fs.h>
+#include <image.h>
+#include <mapmem.h>
+#include <memalign.h>
+
+long image_reader_pread(struct image_reader *rd, ulong pos, void *buf,
+			ulong len)
+{
+	if (pos >= rd->size)
+		return 0;
+	len = min(len, rd->size - pos);
+
+	return rd->read(rd, pos, buf, len);
+}
+
+long image_reader_read(struct image_reader *rd, void *buf, ulong len)
+{
+	long ret;
+
+	ret = image_reader_pread(rd, rd->pos, buf, len);
+	if (ret > 0)
+		rd->pos += ret;
+
+	return ret;
+}
+
+static long image_blk_read(struct image_reader *rd, ulong pos, void *buf,
+			   ulong len)
+{
+	struct image_blk_reader *brd = container_of(rd, struct image_blk_reader,
+						    rd);
+	struct blk_desc *desc = brd->desc;
+	ALLOC_CACHE_ALIGN_BUFFER(char, bounce, desc->blksz);
+	lbaint_t blk = brd->start + pos / desc->blksz;
+	ulong skip = pos % desc->blksz;
+	ulong left = len;
+	lbaint_t cnt;
+	ulong n;
+
+	/* Partial head block */
+	if (skip) {
+		n = min(left, desc->blksz - skip);
+		if (blk_dread(desc, blk, 1, bounce) != 1)
+			return -EIO;
+		memcpy(buf, bounce + skip, n);
+		buf += n;
+		left -= n;
+		blk++;
+	}
+
+	/* Whole blocks go straight to their destination */
+	cnt = left / desc->blksz;
+	if (cnt) {
+		if (blk_dread(desc, blk, cnt, buf) != cnt)
+			return -EIO;
+		n = cnt * desc->blksz;
+		buf += n;
+		left -= n;
+		blk += cnt;
+	}
+
+	/* Partial tail block */
+	if (left) {
+		if (blk_dread(desc, blk, 1, bounce) != 1)
+			return -EIO;
+		memcpy(buf, bounce, left);
+	}
+
+	return len;
+}
+
+void image_blk_reader_init(struct image_blk_reader *brd,
+			   struct blk_desc *desc, ulong start, ulong size)
+{
+	brd->rd.read = image_blk_read;
+	brd->rd.size = size;
+	brd->rd.pos = 0;
+	brd->desc = desc;
+	brd->start = start;
+}
+
+static long image_fs_read(struct image_reader *rd, ulong pos, void *buf,
+			  ulong len)
+{
+	struct image_fs_reader *frd;
+	loff_t actread;
+
+	frd = container_of(rd, struct image_fs_reader, rd);
+
+	/* Each filesystem operation closes the device again */
+	if (fs_set_blk_dev(frd->ifname, frd->dev_part, FS_TYPE_ANY))
+		return -ENODEV;
+	if (fs_read(frd->filename, map_to_sysmem(buf), pos, len, &actread))
+		return -EIO;
+
+	return actread;
+}
+
+int image_fs_reader_init(struct image_fs_reader *frd, const char *ifname,
+			 const char *dev_part, const char *filename)
+{
+	loff_t size;
+
+	if (fs_set_blk_dev(ifname, dev_part, FS_TYPE_ANY))
+		return -ENODEV;
+	if (fs_size(filename, &size))
+		return -ENOENT;
+
+	frd->rd.read = image_fs_read;
+	frd->rd.size = size;
+	frd->rd.pos = 0;
+	frd->ifname = ifname;
+	frd->dev_part = dev_part;
+	frd->filename = filename;
+
+	return 0;
+}
@@ -521,6 +521,81 @@ int image_decomp(int comp, ulong load, ulong image_start, int type,
 	return 0;
 }
 
+#if !defined(USE_HOSTCC) && defined(CONFIG_IMAGE_DECOMP_STREAM)
+int image_decomp_stream(int comp, ulong load, void *load_buf,
+			struct image_reader *rd, ulong unc_len,
+			ulong *load_end)
+{
+	ulong image_len = 0;
+	int ret = -ENOSYS;
+
+	*load_end = load;
+
+	switch (comp) {
+	case IH_COMP_NONE:
+		if (rd->size > unc_len) {
+			ret = -ENOSPC;
+			break;
+		}
+		ret = image_reader_read(rd, load_buf, rd->size);
+		if (ret == rd->size) {
+			image_len = ret;
+			ret = 0;
+		} else if (ret >= 0) {
+			ret = -EIO;
+		}
+		break;
+	case IH_COMP_GZIP:
+		if (CONFIG_IS_ENABLED(GZIP)) {
+			unsigned long size;
+
+			ret = gunzip_stream(load_buf, unc_len, rd, &size);
+			image_len = size;
+		}
+		break;
+	case IH_COMP_LZMA:
+		if (CONFIG_IS_ENABLED(LZMA)) {
+			SizeT lzma_len = unc_len;
+
+			ret = lzmaStreamDecompress(load_buf, &lzma_len, rd);
+			image_len = lzma_len;
+		}
+		break;
+	case IH_COMP_LZ4:
+		if (CONFIG_IS_ENABLED(LZ4)) {
+			size_t size = unc_len;
+
+			ret = ulz4fn_stream(rd, load_buf, &size);
+			image_len = size;
+		}
+		break;
+	case IH_COMP_ZSTD:
+		if (CONFIG_IS_ENABLED(ZSTD)) {
+			struct abuf out;
+
+			abuf_init_set(&out, load_buf, unc_len);
+			ret = zstd_decompress_stream(rd, &out);
+			if (ret >= 0) {
+				image_len = ret;
+				ret = 0;
+			}
+		}
+		break;
+	}
+	if (ret == -ENOSYS) {
+		printf("Streaming not supported for compression type %d\n",
+		       comp);
+		return ret;
+	}
+	if (ret)
+		return ret;
+
+	*load_end = load + image_len;
+
+	return 0;
+}
+#endif
+
 const table_entry_t *get_table_entry(const table_entry_t *table, int id)
 {
 	for (; table->id >= 0; ++table) {
@@ -18,11 +18,12 @@ static int blkc_show(struct cmd_tbl *cmdtp, int flag,
 
 	printf("hits: %u\n"
 	       "misses: %u\n"
+	       "readaheads: %u (%u blocks)\n"
 	       "entries: %u\n"
 	       "max blocks/entry: %u\n"
 	       "max cache entries: %u\n",
-	       stats.hits, stats.misses, stats.entries,
-	       stats.max_blocks_per_entry, stats.max_entries);
+	       stats.hits, stats.misses, stats.readaheads, stats.ra_blocks,
+	       stats.entries, stats.max_blocks_per_entry, stats.max_entries);
 	return 0;
 }
 
@@ -0,0 +1,56 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Load the images of one FIT configuration straight from a block device
+ */
+
+#include <common.h>
+#include <command.h>
+#include <env.h>
+#include <image.h>
+#include <part.h>
+
+static int do_fitload(struct cmd_tbl *cmdtp, int flag, int argc,
+		      char *const argv[])
+{
+	struct disk_partition part_info;
+	struct blk_desc *dev_desc;
+	const char *conf_name = NULL;
+	ulong addr, blk = 0;
+	int part;
+
+	if (argc < 4 || argc > 5)
+		return CMD_RET_USAGE;
+
+	part = blk_get_device_part_str(argv[1], argv[2], &dev_desc,
+				       &part_info, 1);
+	if (part < 0)
+		return CMD_RET_FAILURE;
+
+	if (!fit_parse_conf(argv[3], image_load_addr, &addr, &conf_name))
+		addr = hextoul(argv[3], NULL);
+	if (argc == 5)
+		blk = hextoul(argv[4], NULL);
+
+	if (blk >= part_info.size) {
+		printf("Read out of range\n");
+		return CMD_RET_FAILURE;
+	}
+
+	if (fit_blk_load(dev_desc, part_info.start + blk, addr, conf_name))
+		return CMD_RET_FAILURE;
+
+	image_load_addr = addr;
+	env_set_hex("fileaddr", addr);
+
+	return CMD_RET_SUCCESS;
+}
+
+U_BOOT_CMD(
+	fitload,	5,	0,	do_fitload,
+	"load a FIT with external data, reading only the images it boots",
+	"<interface> <dev[:part]> <addr>[#conf] [blk#]\n"
+	"    - read the FIT structure found at block 'blk#' of the partition\n"
+	"      to 'addr', then read each sub-image used by configuration\n"
+	"      'conf' (default one if omitted) directly to its load address.\n"
+	"      Boot the result with 'bootm <addr>[#conf]'."
+);
@@ -11,8 +11,147 @@
 
 #include <common.h>
 #include <command.h>
+#include <cpu.h>
+#include <dm.h>
 #include <hash.h>
+#include <malloc.h>
 #include <linux/ctype.h>
+#include <linux/sizes.h>
+
+#define HASH_BENCH_ALIGN	64
+#define HASH_BENCH_MAX_SIZES	8
+
+static const uint hash_bench_sizes[] = { SZ_1K, SZ_64K, SZ_1M };
+
+static ulong hash_bench_cpu_hz(void)
+{
+	struct cpu_info info;
+	struct udevice *dev;
+
+	if (!IS_ENABLED(CONFIG_CPU) ||
+	    uclass_first_device_err(UCLASS_CPU, &dev) ||
+	    cpu_get_info(dev, &info))
+		return 0;
+
+	return info.cpu_freq;
+}
+
+static void hash_bench_show(const char *name, const char *source, uint chunk,
+			    uint size, uint align, ulong cpu_hz,
+			    const struct hash_bench_result *res)
+{
+	ulong rate = hash_bench_rate(res);
+	ulong cpb = hash_bench_cpb(res, cpu_hz);
+
+	printf("%-12s %-10s %8u %8u %5u %8lu.%lu", name, source, chunk, size,
+	       align, rate / 10, rate % 10);
+	if (cpu_hz)
+		printf(" %6lu.%02lu", cpb / 100, cpb % 100);
+	printf("\n");
+}
+
+static void hash_bench_algo(struct hash_algo *algo, const void *buf,
+			    uint size, uint align, uint chunk, ulong min_us,
+			    ulong cpu_hz)
+{
+	struct hash_bench_result res;
+	struct udevice *dev;
+
+	if (!hash_bench(algo, buf, size, 0, min_us, &res))
+		hash_bench_show(algo->name, "hash", 0, size, align, cpu_hz,
+				&res);
+	if (!hash_bench(algo, buf, size, chunk, min_us, &res))
+		hash_bench_show(algo->name, "hash", chunk, size, align, cpu_hz,
+				&res);
+
+	if (!IS_ENABLED(CONFIG_DM_HASH))
+		return;
+	uclass_foreach_dev_probe(UCLASS_HASH, dev) {
+		if (!hash_bench_dev(dev, algo->name, buf, size, 0, min_us,
+				    &res))
+			hash_bench_show(algo->name, dev->name, 0, size, align,
+					cpu_hz, &res);
+		if (!hash_bench_dev(dev, algo->name, buf, size, chunk, min_us,
+				    &res))
+			hash_bench_show(algo->name, dev->name, chunk, size,
+					align, cpu_hz, &res);
+	}
+}
+
+static int do_hash_bench(struct cmd_tbl *cmdtp, int flag, int argc,
+			 char *const argv[])
+{
+	uint sizes[HASH_BENCH_MAX_SIZES];
+	const char *name = "all";
+	uint align = 0, chunk = SZ_4K;
+	ulong min_us = 100000;
+	struct hash_algo *algo;
+	uint nsizes = 0, max_size = 0;
+	ulong cpu_hz;
+	char *buf;
+	int i, j;
+
+	for (argc--, argv++; argc && *argv[0] == '-'; argc -= 2, argv += 2) {
+		if (argc < 2)
+			return CMD_RET_USAGE;
+		if (!strcmp(argv[0], "-a"))
+			align = hextoul(argv[1], NULL) % HASH_BENCH_ALIGN;
+		else if (!strcmp(argv[0], "-c"))
+			chunk = hextoul(argv[1], NULL);
+		else if (!strcmp(argv[0], "-t"))
+			min_us = dectoul(argv[1], NULL) * 1000;
+		else
+			return CMD_RET_USAGE;
+	}
+	if (!chunk)
+		return CMD_RET_USAGE;
+	if (argc) {
+		name = argv[0];
+		argc--;
+		argv++;
+	}
+	if (argc > HASH_BENCH_MAX_SIZES)
+		return CMD_RET_USAGE;
+	for (; nsizes < argc; nsizes++)
+		sizes[nsizes] = hextoul(argv[nsizes], NULL);
+	if (!nsizes) {
+		memcpy(sizes, hash_bench_sizes, sizeof(hash_bench_sizes));
+		nsizes = ARRAY_SIZE(hash_bench_sizes);
+	}
+	for (i = 0; i < nsizes; i++)
+		max_size = max(max_size, sizes[i]);
+
+	if (strcmp(name, "all") && hash_lookup_algo(name, &algo)) {
+		printf("Unknown hash algorithm '%s'\n", name);
+		return CMD_RET_FAILURE;
+	}
+
+	/* Fill the buffer so that no memory is left untouched by the test */
+	buf = memalign(HASH_BENCH_ALIGN, max_size + align);
+	if (!buf) {
+		printf("Cannot allocate %u bytes\n", max_size + align);
+		return CMD_RET_FAILURE;
+	}
+	for (i = 0; i < max_size + align; i++)
+		buf[i] = i * 7 + (i >> 8);
+
+	cpu_hz = hash_bench_cpu_hz();
+	printf("%-12s %-10s %8s %8s %5s %10s%s\n", "Algorithm", "Source",
+	       "Chunk", "Size", "Align", "MB/s", cpu_hz ? "      cyc/B" : "");
+	for (i = 0; i < nsizes; i++) {
+		if (strcmp(name, "all")) {
+			hash_bench_algo(algo, buf + align, sizes[i], align,
+					chunk, min_us, cpu_hz);
+			continue;
+		}
+		for (j = 0; !hash_lookup_algo_index(j, &algo); j++)
+			hash_bench_algo(algo, buf + align, sizes[i], align,
+					chunk, min_us, cpu_hz);
+	}
+	free(buf);
+
+	return CMD_RET_SUCCESS;
+}
 
 static int do_hash(struct cmd_tbl *cmdtp, int flag, int argc,
 		   char *const argv[])
@@ -20,6 +159,10 @@ static int do_hash(struct cmd_tbl *cmdtp, int flag, int argc,
 	char *s;
 	int flags = HASH_FLAG_ENV;
 
+	if (IS_ENABLED(CONFIG_HASH_BENCH) && argc > 1 &&
+	    !strcmp(argv[1], "bench"))
+		return do_hash_bench(cmdtp, flag, argc - 1, argv + 1);
+
 #ifdef CONFIG_HASH_VERIFY
 	if (argc < 4)
 		return CMD_RET_USAGE;
@@ -37,7 +180,9 @@ static int do_hash(struct cmd_tbl *cmdtp, int flag, int argc,
 	return hash_command(*argv, flags, cmdtp, flag, argc - 1, argv + 1);
 }
 
-#ifdef CONFIG_HASH_VERIFY
+#if defined(CONFIG_HASH_BENCH)
+#define HARGS CONFIG_SYS_MAXARGS
+#elif defined(CONFIG_HASH_VERIFY)
 #define HARGS 6
 #else
 #define HARGS 5
@@ -53,4 +198,8 @@ U_BOOT_CMD(
 		"    - verify message digest of memory area to immediate value, \n"
 		"      env var or *address"
 #endif
+#ifdef CONFIG_HASH_BENCH
+	"\nhash bench [-a align] [-c chunk] [-t ms] [algorithm|all] [size...]\n"
+		"    - measure hashing throughput, one-shot and in chunks"
+#endif
 );
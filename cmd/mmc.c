@@ -155,6 +155,9 @@ static struct mmc *__init_mmc_device(int dev, bool force_init,
 	struct blk_desc *bd = mmc_get_blk_desc(mmc);
 	blkcache_invalidate(bd->if_type, bd->devnum);
 #endif
+	/* A rescan may have found another card */
+	if (force_init)
+		blk_changed(mmc_get_blk_desc(mmc));
 
 	return mmc;
 }
@@ -388,7 +391,7 @@ static lbaint_t mmc_sparse_reserve(struct sparse_storage *info,
 static int do_mmc_sparse_write(struct cmd_tbl *cmdtp, int flag,
 			       int argc, char *const argv[])
 {
-	struct sparse_storage sparse;
+	struct sparse_storage sparse = { };
 	struct blk_desc *dev_desc;
 	struct mmc *mmc;
 	char dest[11];
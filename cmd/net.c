@@ -14,6 +14,7 @@
 #include <env.h>
 #include <image.h>
 #include <net.h>
+#include <net/tftp.h>
 #include <net/udp.h>
 #include <net/sntp.h>
 
@@ -82,6 +83,67 @@ U_BOOT_CMD(
 );
 #endif
 
+#ifdef CONFIG_CMD_TFTPMULTI
+static int do_tftpmulti(struct cmd_tbl *cmdtp, int flag, int argc,
+			char *const argv[])
+{
+	struct tftp_file files[CONFIG_TFTP_MULTI_MAX];
+	char var[16];
+	char *end;
+	int count = argc - 1;
+	int i, j, size;
+
+	if (count < 1 || count > CONFIG_TFTP_MULTI_MAX)
+		return CMD_RET_USAGE;
+
+	for (i = 0; i < count; i++) {
+		files[i].addr = hextoul(argv[i + 1], &end);
+		if (end == argv[i + 1] || *end != ':' || !end[1])
+			return CMD_RET_USAGE;
+		files[i].name = end + 1;
+		for (j = 0; j < i; j++) {
+			if (files[j].addr == files[i].addr) {
+				printf("*** ERROR: two files at 0x%lx\n",
+				       files[i].addr);
+				return CMD_RET_FAILURE;
+			}
+		}
+	}
+
+	if (!net_server_ip.s_addr) {
+		puts("*** ERROR: `serverip' not set\n");
+		return CMD_RET_FAILURE;
+	}
+
+	image_load_addr = files[0].addr;
+	tftp_multi_set_files(files, count);
+
+	bootstage_mark_name(BOOTSTAGE_KERNELREAD_START, "tftp_start");
+	size = net_loop(TFTPMULTI);
+	bootstage_mark_name(BOOTSTAGE_KERNELREAD_STOP, "tftp_done");
+	if (size < 0)
+		return CMD_RET_FAILURE;
+
+	for (i = 0; i < count; i++) {
+		snprintf(var, sizeof(var), "filesize%d", i);
+		env_set_hex(var, files[i].size);
+	}
+
+	return CMD_RET_SUCCESS;
+}
+
+U_BOOT_CMD(
+	tftpmulti,	CONFIG_TFTP_MULTI_MAX + 1,	0,	do_tftpmulti,
+	"load several files at once via network using TFTP protocol",
+	"address:filename [address:filename ...]\n"
+	"All files are read from the server in serverip at the same time,\n"
+	"each to its own address. A file may not grow past the address of\n"
+	"the next one.\n"
+	"The size of the n-th file (counting from 0) is saved in the\n"
+	"environment variable filesize<n>."
+);
+#endif
+
 
 #ifdef CONFIG_CMD_RARP
 int do_rarpb(struct cmd_tbl *cmdtp, int flag, int argc, char *const argv[])
@@ -124,6 +186,20 @@ U_BOOT_CMD(
 );
 #endif
 
+#if defined(CONFIG_CMD_WGET)
+static int do_wget(struct cmd_tbl *cmdtp, int flag, int argc,
+		   char *const argv[])
+{
+	return netboot_common(WGET, cmdtp, argc, argv);
+}
+
+U_BOOT_CMD(
+	wget,	3,	1,	do_wget,
+	"load a file via network using HTTP",
+	"[loadAddress] [[hostIPaddr:]path]"
+);
+#endif
+
 static void netboot_update_env(void)
 {
 	char tmp[22];
@@ -496,8 +572,30 @@ static int do_net_list(struct cmd_tbl *cmdtp, int flag, int argc, char *const ar
 	return CMD_RET_SUCCESS;
 }
 
+#if CONFIG_IS_ENABLED(NET_RX_STATS)
+static int do_net_stats(struct cmd_tbl *cmdtp, int flag, int argc,
+			char *const argv[])
+{
+	struct eth_rx_stats *stats;
+	struct udevice *dev;
+	struct uclass *uc;
+
+	printf("dev   polls      frames     max/poll budget     errors\n");
+	uclass_id_foreach_dev(UCLASS_ETH, dev, uc) {
+		stats = eth_get_rx_stats(dev);
+		printf("eth%-2d %-10lu %-10lu %-8u %-10lu %lu\n", dev_seq(dev),
+		       stats->polls, stats->frames, stats->max_frames,
+		       stats->budget_hits, stats->errors);
+	}
+	return CMD_RET_SUCCESS;
+}
+#endif
+
 static struct cmd_tbl cmd_net[] = {
 	U_BOOT_CMD_MKENT(list, 1, 0, do_net_list, "", ""),
+#if CONFIG_IS_ENABLED(NET_RX_STATS)
+	U_BOOT_CMD_MKENT(stats, 1, 0, do_net_stats, "", ""),
+#endif
 };
 
 static int do_net(struct cmd_tbl *cmdtp, int flag, int argc, char *const argv[])
@@ -522,5 +620,8 @@ U_BOOT_CMD(
 	net, 2, 1, do_net,
 	"NET sub-system",
 	"list - list available devices\n"
+#if CONFIG_IS_ENABLED(NET_RX_STATS)
+	"net stats - show receive statistics of the devices\n"
+#endif
 );
 #endif // CONFIG_DM_ETH
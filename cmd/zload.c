@@ -0,0 +1,69 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Load a compressed file, decompressing it while it is being read
+ */
+
+#include <common.h>
+#include <command.h>
+#include <env.h>
+#include <image.h>
+#include <mapmem.h>
+
+#ifndef CONFIG_SYS_BOOTM_LEN
+#define CONFIG_SYS_BOOTM_LEN	0x800000
+#endif
+
+static int do_zload(struct cmd_tbl *cmdtp, int flag, int argc,
+		    char *const argv[])
+{
+	struct image_fs_reader frd;
+	ulong addr, load_end;
+	ulong max_size = CONFIG_SYS_BOOTM_LEN;
+	u8 magic[2];
+	int comp;
+	int ret;
+
+	if (argc < 5 || argc > 6)
+		return CMD_RET_USAGE;
+
+	addr = hextoul(argv[3], NULL);
+	if (argc == 6)
+		max_size = hextoul(argv[5], NULL);
+
+	ret = image_fs_reader_init(&frd, argv[1], argv[2], argv[4]);
+	if (ret) {
+		printf("** Cannot access file %s: %d **\n", argv[4], ret);
+		return CMD_RET_FAILURE;
+	}
+
+	if (image_reader_pread(&frd.rd, 0, magic, sizeof(magic)) !=
+	    sizeof(magic))
+		return CMD_RET_FAILURE;
+	comp = image_decomp_type(magic, sizeof(magic));
+
+	printf("   Streaming %s data to 0x%08lx\n",
+	       genimg_get_comp_name(comp), addr);
+	ret = image_decomp_stream(comp, addr, map_sysmem(addr, max_size),
+				  &frd.rd, max_size, &load_end);
+	if (ret) {
+		printf("%s: uncompress error %d\n", genimg_get_comp_name(comp),
+		       ret);
+		return CMD_RET_FAILURE;
+	}
+
+	printf("Uncompressed size: %lu = 0x%lX\n", load_end - addr,
+	       load_end - addr);
+	env_set_hex("fileaddr", addr);
+	env_set_hex("filesize", load_end - addr);
+
+	return CMD_RET_SUCCESS;
+}
+
+U_BOOT_CMD(
+	zload,	6,	0,	do_zload,
+	"load a compressed file, decompressing it while it is read",
+	"<interface> <dev[:part]> <addr> <filename> [maxsize]\n"
+	"    - read 'filename' and decompress it to 'addr' in chunks, so the\n"
+	"      compressed file is never held in memory as a whole.\n"
+	"      gzip, lz4, lzma, zstd and uncompressed files are supported."
+);
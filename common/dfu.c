@@ -103,6 +103,9 @@ int run_usb_dnl_gadget(int usbctrl_index, char *usb_dnl_gadget)
 
 		WATCHDOG_RESET();
 		usb_gadget_handle_interrupts(usbctrl_index);
+
+		/* Errors are reported to the host by the next request */
+		dfu_pending_io();
 	}
 exit:
 	g_dnl_unregister();
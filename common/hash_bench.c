@@ -0,0 +1,150 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Throughput measurement for the hash algorithms
+ *
+ * This times the algorithms in common/hash.c, including any hardware
+ * acceleration selected there, as well as UCLASS_HASH devices.
+ */
+
+#include <common.h>
+#include <dm.h>
+#include <hash.h>
+#include <image.h>
+#include <time.h>
+#include <linux/math64.h>
+#include <u-boot/hash.h>
+
+/**
+ * typedef hash_bench_fn - Compute one digest for a benchmark
+ *
+ * @priv:	Algorithm or device details
+ * @buf:	Data to hash
+ * @size:	Number of bytes to hash
+ * @chunk:	Number of bytes per update, 0 for one-shot
+ * @digest:	Returns the digest
+ * Return: 0 if OK, -ve on error
+ */
+typedef int (*hash_bench_fn)(void *priv, const void *buf, uint size,
+			     uint chunk, u8 *digest);
+
+static int hash_bench_algo_once(void *priv, const void *buf, uint size,
+				uint chunk, u8 *digest)
+{
+	struct hash_algo *algo = priv;
+	uint pos, len;
+	void *ctx;
+
+	if (!chunk) {
+		algo->hash_func_ws(buf, size, digest, algo->chunk_size);
+		return 0;
+	}
+
+	if (!algo->hash_init)
+		return -ENOSYS;
+	if (algo->hash_init(algo, &ctx))
+		return -EIO;
+	for (pos = 0; pos < size; pos += len) {
+		len = min(chunk, size - pos);
+		/* The context is freed on failure */
+		if (algo->hash_update(algo, ctx, buf + pos, len,
+				      pos + len == size))
+			return -EIO;
+	}
+	if (algo->hash_finish(algo, ctx, digest, HASH_MAX_DIGEST_SIZE))
+		return -EIO;
+
+	return 0;
+}
+
+struct hash_bench_dev_priv {
+	struct udevice *dev;
+	enum HASH_ALGO algo;
+};
+
+static int hash_bench_dev_once(void *priv, const void *buf, uint size,
+			       uint chunk, u8 *digest)
+{
+	struct hash_bench_dev_priv *dpriv = priv;
+	uint pos, len;
+	void *ctx;
+	int ret;
+
+	if (!chunk)
+		return hash_digest_wd(dpriv->dev, dpriv->algo, buf, size,
+				      digest, CHUNKSZ);
+
+	ret = hash_init(dpriv->dev, dpriv->algo, &ctx);
+	if (ret)
+		return ret;
+	for (pos = 0; pos < size; pos += len) {
+		len = min(chunk, size - pos);
+		ret = hash_update(dpriv->dev, ctx, buf + pos, len);
+		if (ret)
+			return ret;
+	}
+
+	return hash_finish(dpriv->dev, ctx, digest);
+}
+
+static int hash_bench_run(hash_bench_fn once, void *priv, const void *buf,
+			  uint size, uint chunk, ulong min_us,
+			  struct hash_bench_result *res)
+{
+	u8 digest[HASH_MAX_DIGEST_SIZE];
+	ulong start, elapsed;
+	ulong loops = 0;
+	int ret;
+
+	start = timer_get_us();
+	do {
+		ret = once(priv, buf, size, chunk, digest);
+		if (ret)
+			return ret;
+		loops++;
+		elapsed = timer_get_us() - start;
+	} while (elapsed < min_us);
+
+	res->bytes = (u64)size * loops;
+	res->time_us = elapsed;
+
+	return 0;
+}
+
+int hash_bench(struct hash_algo *algo, const void *buf, uint size, uint chunk,
+	       ulong min_us, struct hash_bench_result *res)
+{
+	return hash_bench_run(hash_bench_algo_once, algo, buf, size, chunk,
+			      min_us, res);
+}
+
+int hash_bench_dev(struct udevice *dev, const char *algo_name,
+		   const void *buf, uint size, uint chunk, ulong min_us,
+		   struct hash_bench_result *res)
+{
+	struct hash_bench_dev_priv dpriv;
+
+	if (!IS_ENABLED(CONFIG_DM_HASH))
+		return -ENOSYS;
+
+	dpriv.dev = dev;
+	dpriv.algo = hash_algo_lookup_by_name(algo_name);
+	if (dpriv.algo == HASH_ALGO_INVALID)
+		return -EPROTONOSUPPORT;
+
+	return hash_bench_run(hash_bench_dev_once, &dpriv, buf, size, chunk,
+			      min_us, res);
+}
+
+ulong hash_bench_rate(const struct hash_bench_result *res)
+{
+	/* Bytes per microsecond is MB/s */
+	return div64_u64(res->bytes * 10, max(res->time_us, 1UL));
+}
+
+ulong hash_bench_cpb(const struct hash_bench_result *res, ulong cpu_hz)
+{
+	if (!res->bytes)
+		return 0;
+
+	return div64_u64((u64)res->time_us * (cpu_hz / 10000), res->bytes);
+}
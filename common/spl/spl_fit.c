@@ -5,9 +5,11 @@
  */
 
 #include <common.h>
+#include <bootstage.h>
 #include <errno.h>
 #include <fpga.h>
 #include <gzip.h>
+#include <hash.h>
 #include <image.h>
 #include <log.h>
 #include <malloc.h>
@@ -28,6 +30,19 @@ DECLARE_GLOBAL_DATA_PTR;
 #define CONFIG_SYS_BOOTM_LEN	(64 << 20)
 #endif
 
+#ifndef CONFIG_SPL_FIT_STREAM_HASH_CHUNK_SIZE
+#define CONFIG_SPL_FIT_STREAM_HASH_CHUNK_SIZE	(128 * 1024)
+#endif
+
+/* Maximum number of hash nodes verified while streaming one image */
+#define SPL_FIT_MAX_STREAM_HASHES	4
+
+struct spl_fit_stream_hash {
+	struct hash_algo *algo;	/* Progressive hash algorithm */
+	void *ctx;		/* Context returned by algo->hash_init() */
+	int node;		/* FDT offset to the "hash-N" node */
+};
+
 struct spl_fit_info {
 	const void *fit;	/* Pointer to a valid FIT blob */
 	size_t ext_data_offset;	/* Offset to FIT external data (end of FIT) */
@@ -222,6 +237,212 @@ static int get_aligned_image_size(struct spl_load_info *info, int data_size,
 	return (data_size + info->bl_len - 1) / info->bl_len;
 }
 
+/**
+ * spl_fit_stream_hash_abort() - release the contexts set up for streaming
+ * @hashes:	hash contexts to release
+ * @count:	number of valid entries in @hashes
+ */
+static void spl_fit_stream_hash_abort(struct spl_fit_stream_hash *hashes,
+				      int count)
+{
+	uint8_t value[FIT_MAX_HASH_LEN];
+	int i;
+
+	/* hash_finish() is the only way to free a progressive context */
+	for (i = 0; i < count; i++)
+		hashes[i].algo->hash_finish(hashes[i].algo, hashes[i].ctx,
+					    value, sizeof(value));
+}
+
+/**
+ * spl_fit_stream_hash_init() - prepare streaming verification of an image
+ * @fit:	Pointer to the FDT blob
+ * @node:	offset of the DT node describing the image
+ * @hashes:	filled with one context per hash node of the image
+ *
+ * Streaming is only possible when every check on the image is a plain hash
+ * with a progressive implementation. Signature nodes need the complete data
+ * and are left to fit_image_verify_with_data().
+ *
+ * Return:	number of hash contexts set up, 0 if the image must be verified
+ *		after loading instead
+ */
+static int spl_fit_stream_hash_init(const void *fit, int node,
+				    struct spl_fit_stream_hash *hashes)
+{
+	struct hash_algo *algo;
+	const char *algo_name;
+	int noffset, count = 0;
+	int ignore;
+
+	if (!CONFIG_IS_ENABLED(FIT_STREAM_HASH))
+		return 0;
+
+	fdt_for_each_subnode(noffset, fit, node) {
+		const char *name = fit_get_name(fit, noffset, NULL);
+
+		if (!strncmp(name, FIT_SIG_NODENAME,
+			     strlen(FIT_SIG_NODENAME)))
+			goto fallback;
+		if (strncmp(name, FIT_HASH_NODENAME,
+			    strlen(FIT_HASH_NODENAME)))
+			continue;
+
+		fit_image_hash_get_ignore(fit, noffset, &ignore);
+		if (ignore)
+			continue;
+
+		if (count == SPL_FIT_MAX_STREAM_HASHES ||
+		    fit_image_hash_get_algo(fit, noffset, &algo_name) ||
+		    hash_progressive_lookup_algo(algo_name, &algo) ||
+		    algo->hash_init(algo, &hashes[count].ctx))
+			goto fallback;
+
+		hashes[count].algo = algo;
+		hashes[count].node = noffset;
+		count++;
+	}
+
+	if (noffset == -FDT_ERR_TRUNCATED || noffset == -FDT_ERR_BADSTRUCTURE)
+		goto fallback;
+
+	return count;
+
+fallback:
+	spl_fit_stream_hash_abort(hashes, count);
+
+	return 0;
+}
+
+/**
+ * spl_fit_stream_hash_update() - feed newly read data to all hash contexts
+ * @hashes:	hash contexts set up by spl_fit_stream_hash_init()
+ * @count:	number of valid entries in @hashes
+ * @buf:	data to hash
+ * @size:	size of @buf in bytes
+ * @is_last:	true if this is the final part of the image data
+ *
+ * Return:	0 on success, -EIO if a hash update failed (all contexts are
+ *		released in that case)
+ */
+static int spl_fit_stream_hash_update(struct spl_fit_stream_hash *hashes,
+				      int count, const void *buf, uint size,
+				      bool is_last)
+{
+	int i;
+
+	bootstage_start(BOOTSTAGE_ID_ACCUM_FIT_HASH, "fit_hash");
+	for (i = 0; i < count; i++) {
+		if (hashes[i].algo->hash_update(hashes[i].algo, hashes[i].ctx,
+						buf, size, is_last)) {
+			/* A failed update has already freed its context */
+			spl_fit_stream_hash_abort(hashes, i);
+			spl_fit_stream_hash_abort(&hashes[i + 1],
+						  count - i - 1);
+			return -EIO;
+		}
+	}
+	bootstage_accum(BOOTSTAGE_ID_ACCUM_FIT_HASH);
+
+	return 0;
+}
+
+/**
+ * spl_fit_stream_hash_check() - finish streamed hashes and compare them
+ * @fit:	Pointer to the FDT blob
+ * @hashes:	hash contexts set up by spl_fit_stream_hash_init()
+ * @count:	number of valid entries in @hashes
+ *
+ * Return:	0 if all hashes match, -EPERM otherwise
+ */
+static int spl_fit_stream_hash_check(const void *fit,
+				     struct spl_fit_stream_hash *hashes,
+				     int count)
+{
+	uint8_t value[FIT_MAX_HASH_LEN];
+	uint8_t *fit_value;
+	int fit_value_len;
+	int i, ret = 0;
+
+	for (i = 0; i < count; i++) {
+		struct hash_algo *algo = hashes[i].algo;
+
+		printf("%s", algo->name);
+		if (algo->hash_finish(algo, hashes[i].ctx, value,
+				      sizeof(value)) ||
+		    fit_image_hash_get_value(fit, hashes[i].node, &fit_value,
+					     &fit_value_len) ||
+		    fit_value_len != algo->digest_size ||
+		    memcmp(value, fit_value, fit_value_len)) {
+			printf(" error!\nBad hash value for '%s' hash node\n",
+			       fit_get_name(fit, hashes[i].node, NULL));
+			ret = -EPERM;
+			continue;
+		}
+		puts("+ ");
+	}
+
+	return ret;
+}
+
+/**
+ * spl_fit_read_hashed() - read external image data and hash it on the fly
+ * @info:	points to information about the device to load data from
+ * @sector:	the start sector of the FIT image on the device
+ * @offset:	offset of the image data from the start of the FIT
+ * @length:	size of the image data in bytes
+ * @dst:	buffer to read into, as for a single info->read() call
+ * @hashes:	hash contexts set up by spl_fit_stream_hash_init()
+ * @count:	number of valid entries in @hashes
+ *
+ * The data ends up in @dst exactly as a single info->read() would leave it,
+ * but it is read in CONFIG_SPL_FIT_STREAM_HASH_CHUNK_SIZE pieces and each
+ * piece is hashed while it is still hot in the cache.
+ *
+ * Return:	0 on success, -EIO on a read or hash failure
+ */
+static int spl_fit_read_hashed(struct spl_load_info *info, ulong sector,
+			       int offset, size_t length, void *dst,
+			       struct spl_fit_stream_hash *hashes, int count)
+{
+	ulong unit = info->filename ? 1 : info->bl_len;
+	ulong total = get_aligned_image_size(info, length, offset);
+	ulong start = sector + get_aligned_image_offset(info, offset);
+	ulong overhead = get_aligned_image_overhead(info, offset);
+	ulong chunk = max_t(ulong, CONFIG_SPL_FIT_STREAM_HASH_CHUNK_SIZE / unit,
+			    1);
+	ulong hashed = overhead;
+	ulong done = 0;
+	int ret;
+
+	while (done < total) {
+		ulong n = min(chunk, total - done);
+		ulong end;
+
+		if (info->read(info, start + done, n, dst + done * unit) != n)
+			goto err;
+		done += n;
+
+		/* Skip the alignment overhead and anything beyond the image */
+		end = min_t(ulong, done * unit, overhead + length);
+		if (end <= hashed)
+			continue;
+		ret = spl_fit_stream_hash_update(hashes, count, dst + hashed,
+						 end - hashed,
+						 end == overhead + length);
+		if (ret)
+			return ret;
+		hashed = end;
+	}
+
+	return 0;
+
+err:
+	spl_fit_stream_hash_abort(hashes, count);
+
+	return -EIO;
+}
+
 #if defined(CONFIG_DUAL_BOOTLOADER) && defined(CONFIG_IMX_TRUSTY_OS)
 __weak int get_tee_load(ulong *load)
 {
@@ -262,6 +483,8 @@ static int spl_load_fit_image(struct spl_load_info *info, ulong sector,
 	const void *data;
 	const void *fit = ctx->fit;
 	bool external_data = false;
+	struct spl_fit_stream_hash hashes[SPL_FIT_MAX_STREAM_HASHES];
+	int nr_hashes = 0;
 
 	if (IS_ENABLED(CONFIG_SPL_FPGA) ||
 	    (IS_ENABLED(CONFIG_SPL_OS_BOOT) && IS_ENABLED(CONFIG_SPL_GZIP))) {
@@ -327,10 +550,16 @@ static int spl_load_fit_image(struct spl_load_info *info, ulong sector,
 		overhead = get_aligned_image_overhead(info, offset);
 		nr_sectors = get_aligned_image_size(info, length, offset);
 
-		if (info->read(info,
-			       sector + get_aligned_image_offset(info, offset),
-			       nr_sectors, src_ptr) != nr_sectors)
+		nr_hashes = spl_fit_stream_hash_init(fit, node, hashes);
+		if (nr_hashes) {
+			if (spl_fit_read_hashed(info, sector, offset, length,
+						src_ptr, hashes, nr_hashes))
+				return -EIO;
+		} else if (info->read(info, sector +
+				      get_aligned_image_offset(info, offset),
+				      nr_sectors, src_ptr) != nr_sectors) {
 			return -EIO;
+		}
 
 		debug("External data: dst=%p, offset=%x, size=%lx\n",
 		      src_ptr, offset, (unsigned long)length);
@@ -347,11 +576,32 @@ static int spl_load_fit_image(struct spl_load_info *info, ulong sector,
 	}
 
 	if (CONFIG_IS_ENABLED(FIT_SIGNATURE)) {
+		int verify_all = 1;
+
 		printf("## Checking hash(es) for Image %s ... ",
 		       fit_get_name(fit, node, NULL));
-		if (!fit_image_verify_with_data(fit, node, gd_fdt_blob(), src,
-						length))
-			return -EPERM;
+		if (nr_hashes) {
+			/* Keys marked 'required' still need their signature */
+			if (FIT_IMAGE_ENABLE_VERIFY &&
+			    fit_image_verify_required_sigs(fit, node, src,
+							   length,
+							   gd_fdt_blob(),
+							   &verify_all)) {
+				spl_fit_stream_hash_abort(hashes, nr_hashes);
+				puts(" error!\nUnable to verify required signature\n");
+				return -EPERM;
+			}
+			if (spl_fit_stream_hash_check(fit, hashes, nr_hashes))
+				return -EPERM;
+		} else {
+			bootstage_start(BOOTSTAGE_ID_ACCUM_FIT_HASH,
+					"fit_hash");
+			if (!fit_image_verify_with_data(fit, node,
+							gd_fdt_blob(), src,
+							length))
+				return -EPERM;
+			bootstage_accum(BOOTSTAGE_ID_ACCUM_FIT_HASH);
+		}
 		puts("OK\n");
 	}
 
@@ -393,6 +393,15 @@ int __weak spl_mmc_emmc_boot_partition(struct mmc *mmc)
 	return default_spl_mmc_emmc_boot_partition(mmc);
 }
 
+static int spl_mmc_save_handoff(struct mmc *mmc)
+{
+	/* U-Boot proper just initialises the card again if this fails */
+	if (IS_ENABLED(CONFIG_MMC_HANDOFF) && mmc_save_handoff(mmc))
+		debug("spl: cannot save mmc state\n");
+
+	return 0;
+}
+
 int spl_mmc_load(struct spl_image_info *spl_image,
 		 struct spl_boot_device *bootdev,
 		 const char *filename,
@@ -456,7 +465,7 @@ int spl_mmc_load(struct spl_image_info *spl_image,
 						   mmc, raw_part,
 						   raw_sect);
 		if (!err)
-			return err;
+			return spl_mmc_save_handoff(mmc);
 #endif
 #ifdef CONFIG_SYS_MMCSD_RAW_MODE_U_BOOT_USE_SECTOR
 #ifdef CONFIG_DUAL_BOOTLOADER
@@ -466,7 +475,7 @@ int spl_mmc_load(struct spl_image_info *spl_image,
 				raw_sect + spl_mmc_raw_uboot_offset(part));
 #endif
 		if (!err)
-			return err;
+			return spl_mmc_save_handoff(mmc);
 #endif
 		/* If RAW mode fails, try FS mode. */
 	case MMCSD_MODE_FS:
@@ -474,7 +483,7 @@ int spl_mmc_load(struct spl_image_info *spl_image,
 
 		err = spl_mmc_do_fs_boot(spl_image, bootdev, mmc, filename);
 		if (!err)
-			return err;
+			return spl_mmc_save_handoff(mmc);
 
 		break;
 #ifdef CONFIG_SPL_LIBCOMMON_SUPPORT
@@ -12,6 +12,7 @@
 #include <log.h>
 #include <malloc.h>
 #include <part.h>
+#include <watchdog.h>
 #include <dm/device-internal.h>
 #include <dm/lists.h>
 #include <dm/uclass-internal.h>
@@ -436,12 +437,28 @@ int blk_get_device(int if_type, int devnum, struct udevice **devp)
 	return device_probe(*devp);
 }
 
+/* Bumped by blk_changed() */
+static unsigned long blk_changes;
+
+void blk_changed(struct blk_desc *block_dev)
+{
+	blkcache_invalidate(block_dev->if_type, block_dev->devnum);
+	blk_changes++;
+}
+
+unsigned long blk_change_count(void)
+{
+	return blk_changes;
+}
+
 unsigned long blk_dread(struct blk_desc *block_dev, lbaint_t start,
 			lbaint_t blkcnt, void *buffer)
 {
 	struct udevice *dev = block_dev->bdev;
 	const struct blk_ops *ops = blk_get_ops(dev);
+	lbaint_t ra_cnt;
 	ulong blks_read;
+	void *ra_buf;
 
 	if (!ops->read)
 		return -ENOSYS;
@@ -449,6 +466,18 @@ unsigned long blk_dread(struct blk_desc *block_dev, lbaint_t start,
 	if (blkcache_read(block_dev->if_type, block_dev->devnum,
 			  start, blkcnt, block_dev->blksz, buffer))
 		return blkcnt;
+
+	/* Read a stream ahead into the cache, with a single request */
+	ra_buf = blkcache_readahead(block_dev->if_type, block_dev->devnum,
+				    start, blkcnt, block_dev->blksz,
+				    block_dev->lba - start, &ra_cnt);
+	if (ra_buf && ops->read(dev, start, ra_cnt, ra_buf) == ra_cnt) {
+		blkcache_fill(block_dev->if_type, block_dev->devnum,
+			      start, ra_cnt, block_dev->blksz, ra_buf);
+		memcpy(buffer, ra_buf, blkcnt * block_dev->blksz);
+		return blkcnt;
+	}
+
 	blks_read = ops->read(dev, start, blkcnt, buffer);
 	if (blks_read == blkcnt)
 		blkcache_fill(block_dev->if_type, block_dev->devnum,
@@ -466,7 +495,7 @@ unsigned long blk_dwrite(struct blk_desc *block_dev, lbaint_t start,
 	if (!ops->write)
 		return -ENOSYS;
 
-	blkcache_invalidate(block_dev->if_type, block_dev->devnum);
+	blk_changed(block_dev);
 	return ops->write(dev, start, blkcnt, buffer);
 }
 
@@ -479,10 +508,63 @@ unsigned long blk_derase(struct blk_desc *block_dev, lbaint_t start,
 	if (!ops->erase)
 		return -ENOSYS;
 
-	blkcache_invalidate(block_dev->if_type, block_dev->devnum);
+	blk_changed(block_dev);
 	return ops->erase(dev, start, blkcnt);
 }
 
+int blk_submit(struct blk_desc *block_dev, struct blk_req *req)
+{
+	struct udevice *dev = block_dev->bdev;
+	const struct blk_ops *ops = blk_get_ops(dev);
+
+	if (req->write ? !ops->write : !ops->read)
+		return -ENOSYS;
+
+	req->result = 0;
+	req->done = false;
+	if (req->write)
+		blk_changed(block_dev);
+	if (ops->submit)
+		return ops->submit(dev, req);
+
+	/* Without asynchronous support, do the whole request now */
+	if (req->write)
+		req->result = ops->write(dev, req->start, req->blkcnt,
+					 req->buffer);
+	else
+		req->result = blk_dread(block_dev, req->start, req->blkcnt,
+					req->buffer);
+	req->done = true;
+
+	return 0;
+}
+
+int blk_poll(struct blk_desc *block_dev, struct blk_req *req)
+{
+	struct udevice *dev = block_dev->bdev;
+	int ret;
+
+	if (req->done)
+		return 0;
+
+	ret = blk_get_ops(dev)->poll(dev, req);
+	if (ret == -EAGAIN)
+		return ret;
+	if (ret)
+		req->result = ret;
+	req->done = true;
+
+	return 0;
+}
+
+long blk_wait(struct blk_desc *block_dev, struct blk_req *req)
+{
+	while (blk_poll(block_dev, req) == -EAGAIN)
+		WATCHDOG_RESET();
+
+	return req->result;
+}
+
 int blk_get_from_parent(struct udevice *parent, struct udevice **devp)
 {
 	struct udevice *dev;
@@ -722,9 +804,20 @@ static int blk_post_probe(struct udevice *dev)
 	return 0;
 }
 
+static int blk_pre_remove(struct udevice *dev)
+{
+	struct blk_desc *desc = dev_get_uclass_plat(dev);
+
+	/* Another device may get the same number, or this one a new medium */
+	blk_changed(desc);
+
+	return 0;
+}
+
 UCLASS_DRIVER(blk) = {
 	.id		= UCLASS_BLK,
 	.name		= "blk",
 	.post_probe	= blk_post_probe,
+	.pre_remove	= blk_pre_remove,
 	.per_device_plat_auto	= sizeof(struct blk_desc),
 };
@@ -3,35 +3,85 @@
  * Copyright (C) Nelson Integration, LLC 2016
  * Author: Eric Nelson<eric@nelint.com>
  *
+ * The cache is made of lines of max_blocks_per_entry blocks, aligned to
+ * that size on the device. Lines are found through a hash table and evicted
+ * in least-recently-used order, either from the whole cache or, once a
+ * device uses more than its share, from that device only.
  */
 #include <common.h>
 #include <blk.h>
 #include <log.h>
 #include <malloc.h>
+#include <memalign.h>
 #include <part.h>
 #include <asm/global_data.h>
 #include <linux/ctype.h>
 #include <linux/list.h>
+#include <linux/log2.h>
 
 #ifdef CONFIG_NEEDS_MANUAL_RELOC
 DECLARE_GLOBAL_DATA_PTR;
 #endif
 
-struct block_cache_node {
+/**
+ * struct block_cache_dev - cache state of one block device
+ *
+ * @lh:		Entry in the list of devices
+ * @lru:	Lines of this device, most recently used first
+ * @iftype:	IF_TYPE_x for type of device
+ * @devnum:	Device index of particular type
+ * @entries:	Number of lines held for this device
+ * @next:	Block after the last one read, to detect streaming
+ * @ra_blocks:	Current readahead window, 0 if not streaming
+ */
+struct block_cache_dev {
 	struct list_head lh;
+	struct list_head lru;
 	int iftype;
 	int devnum;
-	lbaint_t start;
-	lbaint_t blkcnt;
+	unsigned entries;
+	lbaint_t next;
+	lbaint_t ra_blocks;
+};
+
+/**
+ * struct block_cache_node - one cache line
+ *
+ * @lh:		Entry in the global LRU list, most recently used first
+ * @dev_lh:	Entry in the LRU list of the device
+ * @hash_lh:	Entry in the hash bucket
+ * @bdev:	Device the line belongs to
+ * @line:	Line number, i.e. first block / max_blocks_per_entry
+ * @blksz:	Size in bytes of each block
+ * @first:	Offset of the first valid block in the line
+ * @end:	Offset after the last valid block in the line
+ * @cache:	Data for the whole line
+ */
+struct block_cache_node {
+	struct list_head lh;
+	struct list_head dev_lh;
+	struct list_head hash_lh;
+	struct block_cache_dev *bdev;
+	lbaint_t line;
 	unsigned long blksz;
+	lbaint_t first;
+	lbaint_t end;
 	char *cache;
 };
 
 static LIST_HEAD(block_cache);
+static LIST_HEAD(block_cache_devs);
+
+static struct list_head *block_cache_hash;
+static unsigned block_cache_hash_size;
+
+/* Buffer for reads widened by readahead */
+static char *block_cache_ra_buf;
+static unsigned long block_cache_ra_size;
 
 static struct block_cache_stats _stats = {
-	.max_blocks_per_entry = 8,
-	.max_entries = 32
+	.max_blocks_per_entry = 16,
+	.max_entries = 64
 };
 
 #ifdef CONFIG_NEEDS_MANUAL_RELOC
@@ -39,6 +89,9 @@ int blkcache_init(void)
 {
 	struct list_head *head = &block_cache;
 
+	head->next = (uintptr_t)head->next + gd->reloc_off;
+	head->prev = (uintptr_t)head->prev + gd->reloc_off;
+	head = &block_cache_devs;
 	head->next = (uintptr_t)head->next + gd->reloc_off;
 	head->prev = (uintptr_t)head->prev + gd->reloc_off;
 
@@ -46,132 +99,351 @@ int blkcache_init(void)
 }
 #endif
 
-static struct block_cache_node *cache_find(int iftype, int devnum,
-					   lbaint_t start, lbaint_t blkcnt,
-					   unsigned long blksz)
+/* The largest read which is cached, and also the largest readahead */
+static lbaint_t cache_max_read(void)
+{
+	return max(_stats.max_entries / 4, 1U) * _stats.max_blocks_per_entry;
+}
+
+/* The number of lines a device may keep when others need room */
+static unsigned cache_dev_budget(void)
+{
+	return _stats.max_entries - _stats.max_entries / 4;
+}
+
+static struct list_head *cache_bucket(struct block_cache_dev *bdev,
+				      lbaint_t line)
+{
+	ulong hash = ((ulong)line * 0x9e3779b1) ^ (bdev->devnum << 8) ^
+		     bdev->iftype;
+
+	return &block_cache_hash[hash & (block_cache_hash_size - 1)];
+}
+
+static int cache_setup(void)
+{
+	unsigned i;
+
+	if (block_cache_hash)
+		return 0;
+
+	block_cache_hash_size = roundup_pow_of_two(max(_stats.max_entries,
+						       1U));
+	block_cache_hash = malloc(block_cache_hash_size *
+				  sizeof(*block_cache_hash));
+	if (!block_cache_hash)
+		return -ENOMEM;
+	for (i = 0; i < block_cache_hash_size; i++)
+		INIT_LIST_HEAD(&block_cache_hash[i]);
+
+	return 0;
+}
+
+static struct block_cache_dev *cache_dev(int iftype, int devnum, bool create)
+{
+	struct block_cache_dev *bdev;
+
+	list_for_each_entry(bdev, &block_cache_devs, lh)
+		if (bdev->iftype == iftype && bdev->devnum == devnum)
+			return bdev;
+	if (!create)
+		return NULL;
+
+	bdev = calloc(1, sizeof(*bdev));
+	if (!bdev)
+		return NULL;
+	bdev->iftype = iftype;
+	bdev->devnum = devnum;
+	INIT_LIST_HEAD(&bdev->lru);
+	list_add(&bdev->lh, &block_cache_devs);
+
+	return bdev;
+}
+
+static struct block_cache_node *cache_find(struct block_cache_dev *bdev,
+					   lbaint_t line, unsigned long blksz)
 {
 	struct block_cache_node *node;
 
-	list_for_each_entry(node, &block_cache, lh)
-		if ((node->iftype == iftype) &&
-		    (node->devnum == devnum) &&
-		    (node->blksz == blksz) &&
-		    (node->start <= start) &&
-		    (node->start + node->blkcnt >= start + blkcnt)) {
-			if (block_cache.next != &node->lh) {
-				/* maintain MRU ordering */
-				list_del(&node->lh);
-				list_add(&node->lh, &block_cache);
-			}
+	if (!block_cache_hash)
+		return NULL;
+
+	list_for_each_entry(node, cache_bucket(bdev, line), hash_lh)
+		if (node->bdev == bdev && node->line == line &&
+		    node->blksz == blksz)
 			return node;
+
+	return NULL;
+}
+
+static void cache_touch(struct block_cache_node *node)
+{
+	/* maintain MRU ordering */
+	list_move(&node->lh, &block_cache);
+	list_move(&node->dev_lh, &node->bdev->lru);
+}
+
+static void cache_unlink(struct block_cache_node *node)
+{
+	list_del(&node->lh);
+	list_del(&node->dev_lh);
+	list_del(&node->hash_lh);
+	node->bdev->entries--;
+	_stats.entries--;
+}
+
+static void cache_free(struct block_cache_node *node)
+{
+	cache_unlink(node);
+	free(node->cache);
+	free(node);
+}
+
+/*
+ * Get a node for a new line of @bdev, reusing the least-recently-used one
+ * if the cache is full
+ */
+static struct block_cache_node *cache_get_node(struct block_cache_dev *bdev,
+					       unsigned long blksz)
+{
+	unsigned long bytes = _stats.max_blocks_per_entry * blksz;
+	struct block_cache_node *node;
+
+	if (_stats.entries < _stats.max_entries) {
+		node = calloc(1, sizeof(*node));
+		if (!node)
+			return NULL;
+	} else {
+		/* A device over its budget may only evict its own lines */
+		if (bdev->entries >= cache_dev_budget())
+			node = list_last_entry(&bdev->lru,
+					       struct block_cache_node, dev_lh);
+		else
+			node = list_last_entry(&block_cache,
+					       struct block_cache_node, lh);
+		debug("drop: line " LBAF "\n", node->line);
+		cache_unlink(node);
+		if (node->blksz != blksz) {
+			free(node->cache);
+			node->cache = NULL;
 		}
-	return 0;
+	}
+
+	if (!node->cache) {
+		node->cache = malloc(bytes);
+		if (!node->cache) {
+			free(node);
+			return NULL;
+		}
+	}
+
+	return node;
 }
 
 int blkcache_read(int iftype, int devnum,
 		  lbaint_t start, lbaint_t blkcnt,
 		  unsigned long blksz, void *buffer)
 {
-	struct block_cache_node *node = cache_find(iftype, devnum, start,
-						   blkcnt, blksz);
-	if (node) {
-		const char *src = node->cache + (start - node->start) * blksz;
-		memcpy(buffer, src, blksz * blkcnt);
-		debug("hit: start " LBAF ", count " LBAFU "\n",
-		      start, blkcnt);
-		++_stats.hits;
-		return 1;
+	lbaint_t per_line = _stats.max_blocks_per_entry;
+	struct block_cache_node *node;
+	struct block_cache_dev *bdev;
+	lbaint_t blk, end, first, cnt;
+
+	bdev = cache_dev(iftype, devnum, false);
+	if (!bdev || !blkcnt || blkcnt > cache_max_read())
+		goto miss;
+
+	/* Only a hit if every line holds all the blocks needed from it */
+	end = start + blkcnt;
+	for (blk = start; blk < end; blk += cnt) {
+		first = blk % per_line;
+		cnt = min(per_line - first, end - blk);
+		node = cache_find(bdev, blk / per_line, blksz);
+		if (!node || node->first > first || node->end < first + cnt)
+			goto miss;
+	}
+
+	for (blk = start; blk < end; blk += cnt) {
+		first = blk % per_line;
+		cnt = min(per_line - first, end - blk);
+		node = cache_find(bdev, blk / per_line, blksz);
+		memcpy(buffer, node->cache + first * blksz, cnt * blksz);
+		buffer += cnt * blksz;
+		cache_touch(node);
 	}
+	bdev->next = end;
 
+	debug("hit: start " LBAF ", count " LBAFU "\n",
+	      start, blkcnt);
+	++_stats.hits;
+	return 1;
+
+miss:
 	debug("miss: start " LBAF ", count " LBAFU "\n",
 	      start, blkcnt);
 	++_stats.misses;
 	return 0;
 }
 
+void *blkcache_readahead(int iftype, int devnum,
+			 lbaint_t start, lbaint_t blkcnt,
+			 unsigned long blksz, lbaint_t avail,
+			 lbaint_t *cntp)
+{
+	lbaint_t per_line = _stats.max_blocks_per_entry;
+	lbaint_t max_ra = cache_max_read();
+	struct block_cache_dev *bdev;
+	unsigned long bytes;
+	lbaint_t cnt;
+	bool seq;
+
+	if (!_stats.max_entries || !per_line)
+		return NULL;
+
+	bdev = cache_dev(iftype, devnum, true);
+	if (!bdev)
+		return NULL;
+
+	seq = start == bdev->next;
+	bdev->next = start + blkcnt;
+	if (!seq) {
+		bdev->ra_blocks = 0;
+		return NULL;
+	}
+
+	/* Streaming, so read further ahead each time */
+	if (bdev->ra_blocks)
+		bdev->ra_blocks = min(bdev->ra_blocks * 2, max_ra);
+	else
+		bdev->ra_blocks = min(2 * per_line, max_ra);
+	if (blkcnt >= bdev->ra_blocks)
+		return NULL;
+
+	/* End on a line boundary so the next read starts a fresh line */
+	cnt = roundup(start + bdev->ra_blocks, per_line) - start;
+	cnt = min(cnt, max_ra);
+	cnt = min(cnt, avail);
+	if (cnt <= blkcnt)
+		return NULL;
+
+	bytes = cnt * blksz;
+	if (block_cache_ra_size < bytes) {
+		free(block_cache_ra_buf);
+		block_cache_ra_buf = malloc_cache_aligned(bytes);
+		if (!block_cache_ra_buf) {
+			block_cache_ra_size = 0;
+			return NULL;
+		}
+		block_cache_ra_size = bytes;
+	}
+
+	debug("readahead: start " LBAF ", count " LBAFU "\n", start, cnt);
+	bdev->next = start + cnt;
+	++_stats.readaheads;
+	_stats.ra_blocks += cnt - blkcnt;
+	*cntp = cnt;
+
+	return block_cache_ra_buf;
+}
+
 void blkcache_fill(int iftype, int devnum,
 		   lbaint_t start, lbaint_t blkcnt,
 		   unsigned long blksz, void const *buffer)
 {
-	lbaint_t bytes;
+	lbaint_t per_line = _stats.max_blocks_per_entry;
 	struct block_cache_node *node;
+	struct block_cache_dev *bdev;
+	lbaint_t blk, end, first, cnt;
 
 	/* don't cache big stuff */
-	if (blkcnt > _stats.max_blocks_per_entry)
+	if (blkcnt > cache_max_read())
 		return;
 
-	if (_stats.max_entries == 0)
+	if (_stats.max_entries == 0 || !per_line)
 		return;
 
-	bytes = blksz * blkcnt;
-	if (_stats.max_entries <= _stats.entries) {
-		/* pop LRU */
-		node = (struct block_cache_node *)block_cache.prev;
-		list_del(&node->lh);
-		_stats.entries--;
-		debug("drop: start " LBAF ", count " LBAFU "\n",
-		      node->start, node->blkcnt);
-		if (node->blkcnt * node->blksz < bytes) {
-			free(node->cache);
-			node->cache = 0;
-		}
-	} else {
-		node = malloc(sizeof(*node));
-		if (!node)
-			return;
-		node->cache = 0;
-	}
-
-	if (!node->cache) {
-		node->cache = malloc(bytes);
-		if (!node->cache) {
-			free(node);
-			return;
-		}
-	}
+	bdev = cache_dev(iftype, devnum, true);
+	if (!bdev || cache_setup())
+		return;
 
 	debug("fill: start " LBAF ", count " LBAFU "\n",
 	      start, blkcnt);
 
-	node->iftype = iftype;
-	node->devnum = devnum;
-	node->start = start;
-	node->blkcnt = blkcnt;
-	node->blksz = blksz;
-	memcpy(node->cache, buffer, bytes);
-	list_add(&node->lh, &block_cache);
-	_stats.entries++;
+	end = start + blkcnt;
+	for (blk = start; blk < end; blk += cnt) {
+		first = blk % per_line;
+		cnt = min(per_line - first, end - blk);
+		node = cache_find(bdev, blk / per_line, blksz);
+		if (node) {
+			/* Extend the valid blocks if they stay contiguous */
+			if (first <= node->end && first + cnt >= node->first) {
+				node->first = min(node->first, first);
+				node->end = max(node->end, first + cnt);
+			} else {
+				node->first = first;
+				node->end = first + cnt;
+			}
+			cache_touch(node);
+		} else {
+			node = cache_get_node(bdev, blksz);
+			if (!node)
+				return;
+			node->bdev = bdev;
+			node->line = blk / per_line;
+			node->blksz = blksz;
+			node->first = first;
+			node->end = first + cnt;
+			list_add(&node->lh, &block_cache);
+			list_add(&node->dev_lh, &bdev->lru);
+			list_add(&node->hash_lh,
+				 cache_bucket(bdev, node->line));
+			bdev->entries++;
+			_stats.entries++;
+		}
+		memcpy(node->cache + first * blksz, buffer, cnt * blksz);
+		buffer += cnt * blksz;
+	}
 }
 
 void blkcache_invalidate(int iftype, int devnum)
 {
-	struct list_head *entry, *n;
-	struct block_cache_node *node;
+	struct block_cache_node *node, *n;
+	struct block_cache_dev *bdev;
 
-	list_for_each_safe(entry, n, &block_cache) {
-		node = (struct block_cache_node *)entry;
-		if ((node->iftype == iftype) &&
-		    (node->devnum == devnum)) {
-			list_del(entry);
-			free(node->cache);
-			free(node);
-			--_stats.entries;
-		}
-	}
+	bdev = cache_dev(iftype, devnum, false);
+	if (!bdev)
+		return;
+
+	list_for_each_entry_safe(node, n, &bdev->lru, dev_lh)
+		cache_free(node);
+	bdev->next = 0;
+	bdev->ra_blocks = 0;
 }
 
 void blkcache_configure(unsigned blocks, unsigned entries)
 {
 	struct block_cache_node *node;
+	struct block_cache_dev *bdev;
+
 	if ((blocks != _stats.max_blocks_per_entry) ||
 	    (entries != _stats.max_entries)) {
 		/* invalidate cache */
 		while (!list_empty(&block_cache)) {
-			node = (struct block_cache_node *)block_cache.next;
-			list_del(&node->lh);
-			free(node->cache);
-			free(node);
+			node = list_first_entry(&block_cache,
+						struct block_cache_node, lh);
+			cache_free(node);
+		}
+		while (!list_empty(&block_cache_devs)) {
+			bdev = list_first_entry(&block_cache_devs,
+						struct block_cache_dev, lh);
+			list_del(&bdev->lh);
+			free(bdev);
 		}
+		free(block_cache_hash);
+		block_cache_hash = NULL;
+		free(block_cache_ra_buf);
+		block_cache_ra_buf = NULL;
+		block_cache_ra_size = 0;
 		_stats.entries = 0;
 	}
 
@@ -180,6 +452,8 @@ void blkcache_configure(unsigned blocks, unsigned entries)
 
 	_stats.hits = 0;
 	_stats.misses = 0;
+	_stats.readaheads = 0;
+	_stats.ra_blocks = 0;
 }
 
 void blkcache_stats(struct block_cache_stats *stats)
@@ -187,4 +461,6 @@ void blkcache_stats(struct block_cache_stats *stats)
 	memcpy(stats, &_stats, sizeof(*stats));
 	_stats.hits = 0;
 	_stats.misses = 0;
+	_stats.readaheads = 0;
+	_stats.ra_blocks = 0;
 }
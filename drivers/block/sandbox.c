@@ -243,9 +243,57 @@ int sandbox_host_unbind(struct udevice *dev)
 	return 0;
 }
 
+/*
+ * Asynchronous requests are queued and carried out when they are polled for
+ * the second time, so that callers see them in progress first
+ */
+static int host_block_submit(struct udevice *dev, struct blk_req *req)
+{
+	struct host_block_dev *host_dev = dev_get_plat(dev);
+	int i;
+
+	for (i = 0; i < SANDBOX_HOST_QUEUE_DEPTH; i++) {
+		if (!host_dev->queue[i].req) {
+			host_dev->queue[i].req = req;
+			host_dev->queue[i].polls = 2;
+			return 0;
+		}
+	}
+
+	return -EBUSY;
+}
+
+static int host_block_poll(struct udevice *dev, struct blk_req *req)
+{
+	struct host_block_dev *host_dev = dev_get_plat(dev);
+	struct host_async_req *areq = NULL;
+	int i;
+
+	for (i = 0; i < SANDBOX_HOST_QUEUE_DEPTH; i++) {
+		if (host_dev->queue[i].req == req)
+			areq = &host_dev->queue[i];
+	}
+	if (!areq)
+		return -ENOENT;
+	if (--areq->polls)
+		return -EAGAIN;
+
+	if (req->write)
+		req->result = host_block_write(dev, req->start, req->blkcnt,
+					       req->buffer);
+	else
+		req->result = host_block_read(dev, req->start, req->blkcnt,
+					      req->buffer);
+	areq->req = NULL;
+
+	return 0;
+}
+
 static const struct blk_ops sandbox_host_blk_ops = {
 	.read	= host_block_read,
 	.write	= host_block_write,
+	.submit	= host_block_submit,
+	.poll	= host_block_poll,
 };
 
 U_BOOT_DRIVER(sandbox_host_blk) = {
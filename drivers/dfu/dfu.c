@@ -181,11 +181,19 @@ done:
 static unsigned char *dfu_buf;
 static unsigned long dfu_buf_size;
 static enum dfu_device_type dfu_buf_device_type;
+/* Second buffer, which is written or read in the background */
+static unsigned char *dfu_buf_alt;
+/* Entity with a buffer waiting for dfu_pending_io() */
+static struct dfu_entity *dfu_pending;
+static bool dfu_pending_read;
 
 unsigned char *dfu_free_buf(void)
 {
 	free(dfu_buf);
 	dfu_buf = NULL;
+	free(dfu_buf_alt);
+	dfu_buf_alt = NULL;
+	dfu_pending = NULL;
 	return dfu_buf;
 }
 
@@ -220,6 +228,11 @@ unsigned char *dfu_get_buf(struct dfu_entity *dfu)
 		printf("%s: Could not memalign 0x%lx bytes\n",
 		       __func__, dfu_buf_size);
 
+	/* Without it, each buffer is written before taking more data */
+	if (CONFIG_IS_ENABLED(DFU_DOUBLE_BUFFER) && dfu_buf)
+		dfu_buf_alt = memalign(CONFIG_SYS_CACHELINE_SIZE,
+				       dfu_buf_size);
+
 	dfu_buf_device_type = dfu->dev_type;
 	return dfu_buf;
 }
@@ -241,33 +254,130 @@ static char *dfu_get_hash_algo(void)
 	return NULL;
 }
 
+static int dfu_write_buffer(struct dfu_entity *dfu, u8 *buf, long w_size)
+{
+	int ret;
+
+	ret = dfu->write_medium(dfu, dfu->offset, buf, &w_size);
+	if (ret)
+		debug("%s: Write error!\n", __func__);
+
+	/* update offset */
+	dfu->offset += w_size;
+
+	puts("#");
+
+	return ret;
+}
+
+/* Write the buffer which is waiting to be written in the background */
+static int dfu_write_pending(struct dfu_entity *dfu)
+{
+	long w_size = dfu->p_len;
+
+	if (dfu_pending == dfu)
+		dfu_pending = NULL;
+	if (!w_size)
+		return dfu->p_err;
+
+	dfu->p_len = 0;
+	dfu->p_err = dfu_write_buffer(dfu, dfu->p_buf, w_size);
+
+	return dfu->p_err;
+}
+
+static void dfu_swap_buffers(struct dfu_entity *dfu)
+{
+	u8 *buf = dfu->p_buf;
+
+	dfu->p_buf = dfu->i_buf_start;
+	dfu->i_buf_start = buf;
+	dfu->i_buf_end = buf + dfu_get_buf_size();
+	dfu->i_buf = buf;
+}
+
 static int dfu_write_buffer_drain(struct dfu_entity *dfu)
 {
 	long w_size;
 	int ret;
 
+	/* The buffer before this one must be written first */
+	ret = dfu_write_pending(dfu);
+	if (ret)
+		return ret;
+
 	/* flush size? */
 	w_size = dfu->i_buf - dfu->i_buf_start;
 	if (w_size == 0)
 		return 0;
 
-	if (dfu_hash_algo)
-		dfu_hash_algo->hash_update(dfu_hash_algo, &dfu->crc,
-					   dfu->i_buf_start, w_size, 0);
+	/* Leave the write to dfu_pending_io() and go on in the other buffer */
+	if (dfu->p_buf) {
+		dfu_swap_buffers(dfu);
+		dfu->p_len = w_size;
+		dfu_pending = dfu;
+		dfu_pending_read = false;
+		return 0;
+	}
 
-	ret = dfu->write_medium(dfu, dfu->offset, dfu->i_buf_start, &w_size);
-	if (ret)
-		debug("%s: Write error!\n", __func__);
+	ret = dfu_write_buffer(dfu, dfu->i_buf_start, w_size);
 
 	/* point back */
 	dfu->i_buf = dfu->i_buf_start;
 
-	/* update offset */
-	dfu->offset += w_size;
+	return ret;
+}
 
-	puts("#");
+/* Read the next part of the medium into a buffer */
+static int dfu_read_buffer(struct dfu_entity *dfu, u8 *buf, long *len)
+{
+	int ret;
 
-	return ret;
+	*len = dfu_get_buf_size();
+	if (*len > dfu->r_left)
+		*len = dfu->r_left;
+	ret = dfu->read_medium(dfu, dfu->offset, buf, len);
+	if (ret != 0) {
+		debug("%s: Read error!\n", __func__);
+		return ret;
+	}
+	dfu->offset += *len;
+	dfu->r_left -= *len;
+
+	if (*len)
+		puts("#");
+
+	return 0;
+}
+
+/*
+ * Read ahead into the other buffer. A failure is not reported here: the
+ * same part is read again, and the error reported, when it is needed.
+ */
+static void dfu_read_pending(struct dfu_entity *dfu)
+{
+	long len;
+
+	if (dfu->p_len || !dfu->r_left)
+		return;
+	if (!dfu_read_buffer(dfu, dfu->p_buf, &len))
+		dfu->p_len = len;
+}
+
+int dfu_pending_io(void)
+{
+	struct dfu_entity *dfu = dfu_pending;
+
+	if (!dfu)
+		return 0;
+
+	dfu_pending = NULL;
+	if (dfu_pending_read) {
+		dfu_read_pending(dfu);
+		return 0;
+	}
+
+	return dfu_write_pending(dfu);
 }
 
 void dfu_transaction_cleanup(struct dfu_entity *dfu)
@@ -282,6 +392,11 @@ void dfu_transaction_cleanup(struct dfu_entity *dfu)
 	dfu->r_left = 0;
 	dfu->b_left = 0;
 	dfu->bad_skip = 0;
+	dfu->p_buf = dfu_buf_alt;
+	dfu->p_len = 0;
+	dfu->p_err = 0;
+	if (dfu_pending == dfu)
+		dfu_pending = NULL;
 
 	dfu->inited = 0;
 }
@@ -318,6 +433,8 @@ int dfu_flush(struct dfu_entity *dfu, void *buf, int size, int blk_seq_num)
 	int ret = 0;
 
 	ret = dfu_write_buffer_drain(dfu);
+	if (!ret)
+		ret = dfu_write_pending(dfu);
 	if (ret)
 		return ret;
 
@@ -371,6 +488,14 @@ int dfu_write(struct dfu_entity *dfu, void *buf, int size, int blk_seq_num)
 	/* handle rollover */
 	dfu->i_blk_seq_num = (dfu->i_blk_seq_num + 1) & 0xffff;
 
+	/* a buffer written in the background may have failed */
+	if (dfu->p_err) {
+		ret = dfu->p_err;
+		dfu_transaction_cleanup(dfu);
+		dfu_error_callback(dfu, "DFU write error");
+		return ret;
+	}
+
 	/* flush buffer if overflow */
 	if ((dfu->i_buf + size) > dfu->i_buf_end) {
 		ret = dfu_write_buffer_drain(dfu);
@@ -391,6 +516,9 @@ int dfu_write(struct dfu_entity *dfu, void *buf, int size, int blk_seq_num)
 	}
 
 	memcpy(dfu->i_buf, buf, size);
+	if (dfu_hash_algo)
+		dfu_hash_algo->hash_update(dfu_hash_algo, &dfu->crc,
+					   dfu->i_buf, size, 0);
 	dfu->i_buf += size;
 
 	/* if end or if buffer full flush */
@@ -432,28 +560,31 @@ static int dfu_read_buffer_fill(struct dfu_entity *dfu, void *buf, int size)
 
 		/* all done */
 		if (size > 0) {
-			/* no more to read */
-			if (dfu->r_left == 0)
-				break;
-
 			dfu->i_buf = dfu->i_buf_start;
-			dfu->b_left = dfu->i_buf_end - dfu->i_buf_start;
-
-			/* got to read, but buffer is empty */
-			if (dfu->b_left > dfu->r_left)
-				dfu->b_left = dfu->r_left;
-			ret = dfu->read_medium(dfu, dfu->offset, dfu->i_buf,
-					&dfu->b_left);
-			if (ret != 0) {
-				debug("%s: Read error!\n", __func__);
-				return ret;
+			if (dfu->p_len) {
+				/* use what was read ahead */
+				dfu_swap_buffers(dfu);
+				dfu->b_left = dfu->p_len;
+				dfu->p_len = 0;
+			} else {
+				/* no more to read */
+				if (dfu->r_left == 0)
+					break;
+
+				/* got to read, but buffer is empty */
+				ret = dfu_read_buffer(dfu, dfu->i_buf,
+						      &dfu->b_left);
+				if (ret != 0)
+					return ret;
 			}
 			if (dfu->b_left == 0)
 				break;
-			dfu->offset += dfu->b_left;
-			dfu->r_left -= dfu->b_left;
 
-			puts("#");
+			/* read the next part while this one is sent */
+			if (dfu->p_buf && dfu->r_left) {
+				dfu_pending = dfu;
+				dfu_pending_read = true;
+			}
 		}
 	}
 
@@ -29,6 +29,42 @@ static u32 fastboot_bytes_received;
  */
 static u32 fastboot_bytes_expected;
 
+#if CONFIG_IS_ENABLED(FASTBOOT_STREAM)
+/**
+ * fastboot_stream_part - partition given by the last "oem stream" command
+ */
+static char fastboot_stream_part[PART_NAME_LEN];
+
+/**
+ * fastboot_stream_armed - the next download is written to
+ * fastboot_stream_part while it arrives
+ */
+static bool fastboot_stream_armed;
+
+/**
+ * fastboot_streaming - the current download is written to storage while it
+ * arrives, with fastboot_buf_addr used as a ring of buffers
+ */
+static bool fastboot_streaming;
+
+/**
+ * fastboot_streamed - the last download was written to fastboot_stream_part
+ */
+static bool fastboot_streamed;
+
+/**
+ * fastboot_bytes_written - number of bytes of a streamed download written to
+ * storage
+ */
+static u32 fastboot_bytes_written;
+
+/**
+ * fastboot_stream_response - response for writing a streamed download, set
+ * to a failure as soon as one happens
+ */
+static char fastboot_stream_response[FASTBOOT_RESPONSE_LEN];
+#endif
+
 static void okay(char *, char *);
 static void getvar(char *, char *);
 static void download(char *, char *);
@@ -48,6 +84,9 @@ static void oem_partconf(char *, char *);
 #if CONFIG_IS_ENABLED(FASTBOOT_CMD_OEM_BOOTBUS)
 static void oem_bootbus(char *, char *);
 #endif
+#if CONFIG_IS_ENABLED(FASTBOOT_STREAM)
+static void oem_stream(char *, char *);
+#endif
 
 #if CONFIG_IS_ENABLED(FASTBOOT_UUU_SUPPORT)
 static void run_ucmd(char *, char *);
@@ -122,6 +161,12 @@ static const struct {
 		.dispatch = oem_bootbus,
 	},
 #endif
+#if CONFIG_IS_ENABLED(FASTBOOT_STREAM)
+	[FASTBOOT_COMMAND_OEM_STREAM] = {
+		.command = "oem stream",
+		.dispatch = oem_stream,
+	},
+#endif
 #if CONFIG_IS_ENABLED(FASTBOOT_UUU_SUPPORT)
 	[FASTBOOT_COMMAND_UCMD] = {
 		.command = "UCmd",
@@ -193,6 +238,110 @@ static void getvar(char *cmd_parameter, char *response)
 	fastboot_getvar(cmd_parameter, response);
 }
 
+#if CONFIG_IS_ENABLED(FASTBOOT_STREAM)
+/* Size of the ring of buffers which a streamed download goes through */
+static u32 fastboot_stream_ring_size(void)
+{
+	return rounddown(fastboot_buf_size, CONFIG_FASTBOOT_STREAM_BUF_SIZE);
+}
+
+/**
+ * fastboot_stream_start() - Start a download which is written while it arrives
+ *
+ * @response: Pointer to fastboot response buffer
+ */
+static void fastboot_stream_start(char *response)
+{
+	if (fastboot_stream_ring_size() < 2 * CONFIG_FASTBOOT_STREAM_BUF_SIZE) {
+		fastboot_fail("buffer too small for streaming", response);
+		return;
+	}
+	if (fastboot_mmc_stream_start(fastboot_stream_part, response))
+		return;
+
+	fastboot_streaming = true;
+	fastboot_bytes_written = 0;
+	fastboot_okay(NULL, fastboot_stream_response);
+	printf("Starting download of %d bytes to '%s'\n",
+	       fastboot_bytes_expected, fastboot_stream_part);
+	fastboot_response("DATA", response, "%08x", fastboot_bytes_expected);
+}
+
+/**
+ * fastboot_stream_flush() - Write received data of a streamed download
+ *
+ * @all: true to write everything, false to write only full buffers
+ */
+static void fastboot_stream_flush(bool all)
+{
+	u32 ring_size = fastboot_stream_ring_size();
+	u32 len;
+
+	while (fastboot_bytes_written != fastboot_bytes_received) {
+		len = min(fastboot_bytes_received - fastboot_bytes_written,
+			  (u32)CONFIG_FASTBOOT_STREAM_BUF_SIZE);
+		if (len < CONFIG_FASTBOOT_STREAM_BUF_SIZE && !all)
+			break;
+
+		/* After a failure the rest of the download is dropped */
+		if (!strncmp(fastboot_stream_response, "OKAY", 4) &&
+		    fastboot_mmc_stream_write(fastboot_buf_addr +
+					      fastboot_bytes_written %
+					      ring_size, len,
+					      fastboot_bytes_expected,
+					      fastboot_stream_response))
+			printf("\nstreaming failed: %s\n",
+			       fastboot_stream_response + 4);
+		fastboot_bytes_written += len;
+	}
+}
+
+/**
+ * fastboot_stream_copy() - Copy data of a streamed download into the ring
+ *
+ * @data: Pointer to received data
+ * @len: Length of received data
+ */
+static void fastboot_stream_copy(const void *data, unsigned int len)
+{
+	u32 ring_size = fastboot_stream_ring_size();
+	u32 pos = fastboot_bytes_received % ring_size;
+	u32 n = min(len, ring_size - pos);
+
+	/* Make room if the transport did not call fastboot_data_stream() */
+	if (fastboot_bytes_received + len - fastboot_bytes_written > ring_size)
+		fastboot_stream_flush(false);
+
+	memcpy(fastboot_buf_addr + pos, data, n);
+	memcpy(fastboot_buf_addr, data + n, len - n);
+}
+
+/**
+ * fastboot_stream_finish() - Write the rest of a streamed download
+ *
+ * @response: Pointer to fastboot response buffer
+ */
+static void fastboot_stream_finish(char *response)
+{
+	char dummy[FASTBOOT_RESPONSE_LEN];
+
+	fastboot_stream_flush(true);
+	if (!strncmp(fastboot_stream_response, "OKAY", 4))
+		fastboot_mmc_stream_finish(fastboot_stream_response);
+	else
+		fastboot_mmc_stream_finish(dummy);
+	fastboot_streaming = false;
+	fastboot_streamed = true;
+	strcpy(response, fastboot_stream_response);
+}
+
+void fastboot_data_stream(void)
+{
+	if (fastboot_streaming)
+		fastboot_stream_flush(false);
+}
+#endif
+
 /**
  * fastboot_download() - Start a download transfer from the client
  *
@@ -213,6 +362,14 @@ static void download(char *cmd_parameter, char *response)
 		fastboot_fail("Expected nonzero image size", response);
 		return;
 	}
+#if CONFIG_IS_ENABLED(FASTBOOT_STREAM)
+	fastboot_streamed = false;
+	if (fastboot_stream_armed) {
+		fastboot_stream_armed = false;
+		fastboot_stream_start(response);
+		return;
+	}
+#endif
 	/*
 	 * Nothing to download yet. Response is of the form:
 	 * [DATA|FAIL]$cmd_parameter
@@ -266,9 +423,16 @@ void fastboot_data_download(const void *fastboot_data,
 			      response);
 		return;
 	}
-	/* Download data to fastboot_buf_addr */
-	memcpy(fastboot_buf_addr + fastboot_bytes_received,
-	       fastboot_data, fastboot_data_len);
+#if CONFIG_IS_ENABLED(FASTBOOT_STREAM)
+	if (fastboot_streaming) {
+		fastboot_stream_copy(fastboot_data, fastboot_data_len);
+	} else
+#endif
+	{
+		/* Download data to fastboot_buf_addr */
+		memcpy(fastboot_buf_addr + fastboot_bytes_received,
+		       fastboot_data, fastboot_data_len);
+	}
 
 	pre_dot_num = fastboot_bytes_received / BYTES_PER_DOT;
 	fastboot_bytes_received += fastboot_data_len;
@@ -295,6 +459,13 @@ void fastboot_data_complete(char *response)
 	fastboot_okay(NULL, response);
 	printf("\ndownloading of %d bytes finished\n", fastboot_bytes_received);
 	image_size = fastboot_bytes_received;
+#if CONFIG_IS_ENABLED(FASTBOOT_STREAM)
+	if (fastboot_streaming) {
+		fastboot_stream_finish(response);
+		/* The buffer does not hold the image */
+		image_size = 0;
+	}
+#endif
 	env_set_hex("filesize", image_size);
 	fastboot_bytes_expected = 0;
 	fastboot_bytes_received = 0;
@@ -312,6 +483,17 @@ void fastboot_data_complete(char *response)
  */
 static void flash(char *cmd_parameter, char *response)
 {
+#if CONFIG_IS_ENABLED(FASTBOOT_STREAM)
+	if (fastboot_streamed) {
+		fastboot_streamed = false;
+		if (strcmp(cmd_parameter, fastboot_stream_part))
+			fastboot_fail("image was streamed to another partition",
+				      response);
+		else
+			strcpy(response, fastboot_stream_response);
+		return;
+	}
+#endif
 #if CONFIG_IS_ENABLED(FASTBOOT_FLASH_MMC)
 	fastboot_mmc_flash_write(cmd_parameter, fastboot_buf_addr, image_size,
 				 response);
@@ -488,6 +670,33 @@ static void oem_partconf(char *cmd_parameter, char *response)
 }
 #endif
 
+#if CONFIG_IS_ENABLED(FASTBOOT_STREAM)
+/**
+ * oem_stream() - Write the next download to a partition while it arrives
+ *
+ * @cmd_parameter: Pointer to partition name
+ * @response: Pointer to fastboot response buffer
+ *
+ * Only the next download is streamed. A "flash" of the same partition after
+ * it reports the result of the write, without writing anything.
+ */
+static void oem_stream(char *cmd_parameter, char *response)
+{
+	if (!cmd_parameter || !*cmd_parameter) {
+		fastboot_fail("Expected command parameter", response);
+		return;
+	}
+	if (strlen(cmd_parameter) >= sizeof(fastboot_stream_part)) {
+		fastboot_fail("partition name too long", response);
+		return;
+	}
+
+	strcpy(fastboot_stream_part, cmd_parameter);
+	fastboot_stream_armed = true;
+	fastboot_okay(NULL, response);
+}
+#endif
+
 #if CONFIG_IS_ENABLED(FASTBOOT_CMD_OEM_BOOTBUS)
 /**
  * oem_bootbus() - Execute the OEM bootbus command
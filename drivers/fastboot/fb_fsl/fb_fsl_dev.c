@@ -174,7 +174,7 @@ static void process_flash_blkdev(const char *cmdbuf, void *download_buffer,
 				struct mmc *mmc;
 				struct blk_desc *dev_desc;
 				struct disk_partition info;
-				struct sparse_storage sparse;
+				struct sparse_storage sparse = { };
 				int err;
 
 				dev_no = fastboot_devinfo.dev_id;
@@ -14,11 +14,13 @@
 #include <image-sparse.h>
 #include <image.h>
 #include <log.h>
+#include <malloc.h>
 #include <part.h>
 #include <mmc.h>
 #include <div64.h>
 #include <linux/compat.h>
 #include <android_image.h>
+#include <asm/cache.h>
 
 #define FASTBOOT_MAX_BLK_WRITE 16384
 
@@ -168,6 +170,39 @@ static lbaint_t fb_mmc_sparse_reserve(struct sparse_storage *info,
 	return blkcnt;
 }
 
+static lbaint_t fb_mmc_sparse_erase(struct sparse_storage *info,
+		lbaint_t blk, lbaint_t blkcnt)
+{
+	struct fb_mmc_sparse *sparse = info->priv;
+
+	return blk_derase(sparse->dev_desc, blk, blkcnt);
+}
+
+/*
+ * Let zero FILL chunks be erased rather than written, if the card reads
+ * erased blocks as zeroes
+ */
+static void fb_mmc_sparse_set_erase(struct sparse_storage *sparse,
+				    struct blk_desc *dev_desc)
+{
+	struct mmc *mmc;
+
+	if (dev_desc->if_type != IF_TYPE_MMC)
+		return;
+	mmc = find_mmc_device(dev_desc->devnum);
+	if (!mmc || !mmc->erase_grp_size)
+		return;
+	if (IS_SD(mmc)) {
+		if (mmc->scr[0] & SD_DATA_STAT_AFTER_ERASE)
+			return;
+	} else if (!mmc->ext_csd || mmc->ext_csd[EXT_CSD_ERASED_MEM_CONT]) {
+		return;
+	}
+
+	sparse->erase_size = mmc->erase_grp_size;
+	sparse->erase = fb_mmc_sparse_erase;
+}
+
 static void write_raw_image(struct blk_desc *dev_desc,
 			    struct disk_partition *info, const char *part_name,
 			    void *buffer, u32 download_bytes, char *response)
@@ -607,7 +642,7 @@ void fastboot_mmc_flash_write(const char *cmd, void *download_buffer,
 
 	if (is_sparse_image(download_buffer)) {
 		struct fb_mmc_sparse sparse_priv;
-		struct sparse_storage sparse;
+		struct sparse_storage sparse = { };
 		int err;
 
 		sparse_priv.dev_desc = dev_desc;
@@ -618,6 +653,7 @@ void fastboot_mmc_flash_write(const char *cmd, void *download_buffer,
 		sparse.write = fb_mmc_sparse_write;
 		sparse.reserve = fb_mmc_sparse_reserve;
 		sparse.mssg = fastboot_fail;
+		fb_mmc_sparse_set_erase(&sparse, dev_desc);
 
 		printf("Flashing sparse image at offset " LBAFU "\n",
 		       sparse.start);
@@ -633,6 +669,146 @@ void fastboot_mmc_flash_write(const char *cmd, void *download_buffer,
 	}
 }
 
+#if CONFIG_IS_ENABLED(FASTBOOT_STREAM)
+/**
+ * struct fb_mmc_stream - an image being written to eMMC as it is downloaded
+ *
+ * @dev_desc: Device the partition is on
+ * @info: Partition the image is written to
+ * @sparse_priv: Private data of @sparse
+ * @sparse: Storage for a sparse image
+ * @ss: State of a sparse image
+ * @is_sparse: true if the image is a sparse image
+ * @offset: Number of bytes of the image written so far
+ */
+struct fb_mmc_stream {
+	struct blk_desc *dev_desc;
+	struct disk_partition info;
+	struct fb_mmc_sparse sparse_priv;
+	struct sparse_storage sparse;
+	struct sparse_stream ss;
+	bool is_sparse;
+	u32 offset;
+};
+
+static struct fb_mmc_stream fb_mmc_stream;
+
+int fastboot_mmc_stream_start(const char *cmd, char *response)
+{
+	struct fb_mmc_stream *st = &fb_mmc_stream;
+
+	memset(st, '\0', sizeof(*st));
+	if (fastboot_mmc_get_part_info(cmd, &st->dev_desc, &st->info,
+				       response) < 0)
+		return -ENOENT;
+
+	return 0;
+}
+
+/* Set up for a sparse or raw image, once its first bytes are known */
+static int fb_mmc_stream_begin(struct fb_mmc_stream *st, const void *buffer,
+			       u32 len, u32 image_size, char *response)
+{
+	lbaint_t blkcnt;
+
+	if (len >= sizeof(sparse_header_t) && is_sparse_image((void *)buffer)) {
+		st->is_sparse = true;
+		st->sparse_priv.dev_desc = st->dev_desc;
+		st->sparse.blksz = st->info.blksz;
+		st->sparse.start = st->info.start;
+		st->sparse.size = st->info.size;
+		st->sparse.write = fb_mmc_sparse_write;
+		st->sparse.reserve = fb_mmc_sparse_reserve;
+		st->sparse.mssg = fastboot_fail;
+		fb_mmc_sparse_set_erase(&st->sparse, st->dev_desc);
+		st->sparse.priv = &st->sparse_priv;
+
+		printf("Flashing sparse image at offset " LBAFU "\n",
+		       st->sparse.start);
+		if (sparse_stream_init(&st->ss, &st->sparse)) {
+			fastboot_fail("out of memory", response);
+			return -ENOMEM;
+		}
+		return 0;
+	}
+
+	blkcnt = DIV_ROUND_UP(image_size, st->info.blksz);
+	if (blkcnt > st->info.size) {
+		pr_err("too large for partition: '%s'\n", st->info.name);
+		fastboot_fail("too large for partition", response);
+		return -EFBIG;
+	}
+	puts("Flashing Raw Image\n");
+
+	return 0;
+}
+
+int fastboot_mmc_stream_write(const void *buffer, u32 len, u32 image_size,
+			      char *response)
+{
+	struct fb_mmc_stream *st = &fb_mmc_stream;
+	lbaint_t blk, blkcnt;
+	void *tail;
+	u32 rem;
+	int ret;
+
+	if (!st->offset) {
+		ret = fb_mmc_stream_begin(st, buffer, len, image_size,
+					  response);
+		if (ret)
+			return ret;
+	}
+	st->offset += len;
+
+	if (st->is_sparse)
+		return sparse_stream_write(&st->ss, buffer, len, response) ?
+		       -EIO : 0;
+
+	/* Only the last piece of a raw image may end within a block */
+	blk = st->info.start + (st->offset - len) / st->info.blksz;
+	blkcnt = len / st->info.blksz;
+	rem = len % st->info.blksz;
+	if (fb_mmc_blk_write(st->dev_desc, blk, blkcnt, buffer) != blkcnt)
+		goto err;
+	if (rem) {
+		tail = memalign(ARCH_DMA_MINALIGN, st->info.blksz);
+		if (!tail) {
+			fastboot_fail("out of memory", response);
+			return -ENOMEM;
+		}
+		memset(tail, '\0', st->info.blksz);
+		memcpy(tail, buffer + blkcnt * st->info.blksz, rem);
+		ret = fb_mmc_blk_write(st->dev_desc, blk + blkcnt, 1, tail);
+		free(tail);
+		if (ret != 1)
+			goto err;
+	}
+
+	return 0;
+
+err:
+	pr_err("failed writing to device %d\n", st->dev_desc->devnum);
+	fastboot_fail("failed writing to device", response);
+	return -EIO;
+}
+
+int fastboot_mmc_stream_finish(char *response)
+{
+	struct fb_mmc_stream *st = &fb_mmc_stream;
+
+	if (st->is_sparse) {
+		if (sparse_stream_finish(&st->ss, (char *)st->info.name,
+					 response))
+			return -EIO;
+	} else {
+		printf("........ wrote %u bytes to '%s'\n", st->offset,
+		       st->info.name);
+	}
+
+	return 0;
+}
+#endif
+
 /**
  * fastboot_mmc_flash_erase() - Erase eMMC for fastboot
  *
@@ -39,6 +39,7 @@
 #include <dm/ofnode.h>
 #include <linux/iopoll.h>
 #include <linux/dma-mapping.h>
+#include <sdhci.h>
 #if CONFIG_IS_ENABLED(IMX_MODULE_FUSE)
 #include <asm/mach-imx/sys_proto.h>
 #endif
@@ -56,9 +57,29 @@ DECLARE_GLOBAL_DATA_PTR;
 				IRQSTATEN_CTOE | IRQSTATEN_CCE | IRQSTATEN_CEBE | \
 				IRQSTATEN_CIE | IRQSTATEN_DTOE | IRQSTATEN_DCE | \
 				IRQSTATEN_DEBE | IRQSTATEN_BRR | IRQSTATEN_BWR | \
-				IRQSTATEN_DINT)
+				IRQSTATEN_DINT | IRQSTATEN_DMAE)
 #define MAX_TUNING_LOOP 40
 
+/*
+ * The uSDHC only has a 32-bit ADMA system address register and uses the
+ * 32-bit ADMA2 descriptor format, whatever the size of dma_addr_t is.
+ */
+struct esdhc_adma_desc {
+	u8 attr;
+	u8 reserved;
+	__le16 len;
+	__le32 addr;
+} __packed;
+
+#define ESDHC_ADMA_TABLE_LEN	DIV_ROUND_UP(CONFIG_SYS_MMC_MAX_BLK_COUNT * \
+					     MMC_MAX_BLOCK_LEN, ADMA_MAX_LEN)
+#define ESDHC_ADMA_TABLE_SZ	(ESDHC_ADMA_TABLE_LEN * \
+				 sizeof(struct esdhc_adma_desc))
+
+/* Blocks moved at most per transfer when the data is above 4 GiB */
+#define ESDHC_BOUNCE_BLKS	1024
+#define ESDHC_BOUNCE_SZ		(ESDHC_BOUNCE_BLKS * MMC_MAX_BLOCK_LEN)
+
 struct fsl_esdhc {
 	uint    dsaddr;		/* SDMA system address register */
 	uint    blkattr;	/* Block attributes register */
@@ -176,6 +197,11 @@ struct fsl_esdhc_priv {
 	struct gpio_desc wp_gpio;
 #endif
 	dma_addr_t dma_addr;
+	void *bounce_buf;
+	bool bounced;
+#if CONFIG_IS_ENABLED(FSL_ESDHC_IMX_ADMA2)
+	struct esdhc_adma_desc *adma_desc_table;
+#endif
 };
 
 /* Return the XFERTYP flags for a given command and data packet */
@@ -300,11 +326,82 @@ static void esdhc_setup_watermark_level(struct fsl_esdhc_priv *priv,
 	}
 }
 
-static void esdhc_setup_dma(struct fsl_esdhc_priv *priv, struct mmc_data *data)
+#if CONFIG_IS_ENABLED(FSL_ESDHC_IMX_ADMA2)
+/*
+ * Describe the whole transfer in the ADMA2 descriptor table, so that it runs
+ * as one DMA without stopping at SDMA buffer boundaries
+ */
+static void esdhc_prepare_adma_table(struct fsl_esdhc_priv *priv, uint len)
+{
+	struct esdhc_adma_desc *desc = priv->adma_desc_table;
+	dma_addr_t addr = priv->dma_addr;
+	uint chunk;
+
+	do {
+		chunk = min_t(uint, len, ADMA_MAX_LEN);
+		desc->attr = ADMA_DESC_ATTR_VALID | ADMA_DESC_TRANSFER_DATA;
+		desc->reserved = 0;
+		desc->len = cpu_to_le16(chunk);
+		desc->addr = cpu_to_le32(lower_32_bits(addr));
+		addr += chunk;
+		len -= chunk;
+		if (!len)
+			desc->attr |= ADMA_DESC_ATTR_END;
+		desc++;
+	} while (len);
+
+	flush_dcache_range((ulong)priv->adma_desc_table,
+			   ALIGN((ulong)desc, ARCH_DMA_MINALIGN));
+}
+#endif
+
+/*
+ * The controller can only address the first 4 GiB. Move the data of a buffer
+ * above that through the bounce buffer, which is allocated below 4 GiB at
+ * init. esdhc_get_b_max_common() keeps such transfers small enough for it.
+ */
+static int esdhc_map_bounce_buf(struct fsl_esdhc_priv *priv,
+				struct mmc_data *data, uint trans_bytes)
+{
+	dma_unmap_single(priv->dma_addr, trans_bytes, mmc_get_dma_dir(data));
+
+	if (!priv->bounce_buf || trans_bytes > ESDHC_BOUNCE_SZ) {
+		printf("Cannot use 64 bit addresses for DMA\n");
+		return -EFAULT;
+	}
+	if (data->flags & MMC_DATA_WRITE)
+		memcpy(priv->bounce_buf, data->src, trans_bytes);
+
+	priv->dma_addr = dma_map_single(priv->bounce_buf, trans_bytes,
+					mmc_get_dma_dir(data));
+	priv->bounced = true;
+
+	return 0;
+}
+
+/*
+ * Copy data read through the bounce buffer to where it was asked for. The
+ * DMA mapping must already be undone.
+ */
+static void esdhc_unmap_bounce_buf(struct fsl_esdhc_priv *priv,
+				   struct mmc_data *data)
+{
+	if (!priv->bounced)
+		return;
+
+	if (data->flags & MMC_DATA_READ)
+		memcpy(data->dest, priv->bounce_buf,
+		       data->blocks * data->blocksize);
+	priv->bounced = false;
+}
+
+static int esdhc_setup_dma(struct fsl_esdhc_priv *priv, struct mmc_data *data)
 {
 	uint trans_bytes = data->blocksize * data->blocks;
 	struct fsl_esdhc *regs = priv->esdhc_regs;
+	__maybe_unused phys_addr_t adma_addr;
 	void *buf;
+	int ret;
 
 	if (data->flags & MMC_DATA_WRITE)
 		buf = (void *)data->src;
@@ -313,16 +410,35 @@ static void esdhc_setup_dma(struct fsl_esdhc_priv *priv, struct mmc_data *data)
 
 	priv->dma_addr = dma_map_single(buf, trans_bytes,
 					mmc_get_dma_dir(data));
-	if (upper_32_bits(priv->dma_addr))
-		printf("Cannot use 64 bit addresses with SDMA\n");
-	esdhc_write32(&regs->dsaddr, lower_32_bits(priv->dma_addr));
+	if (upper_32_bits(priv->dma_addr + trans_bytes - 1)) {
+		ret = esdhc_map_bounce_buf(priv, data, trans_bytes);
+		if (ret)
+			return ret;
+	}
+
+#if CONFIG_IS_ENABLED(FSL_ESDHC_IMX_ADMA2)
+	if (priv->adma_desc_table) {
+		esdhc_prepare_adma_table(priv, trans_bytes);
+		adma_addr = virt_to_phys(priv->adma_desc_table);
+		esdhc_write32(&regs->adsaddr, lower_32_bits(adma_addr));
+		esdhc_clrsetbits32(&regs->proctl, PROCTL_DMAS_MASK,
+				   PROCTL_DMAS_ADMA2);
+	} else
+#endif
+	{
+		esdhc_write32(&regs->dsaddr, lower_32_bits(priv->dma_addr));
+		esdhc_clrsetbits32(&regs->proctl, PROCTL_DMAS_MASK,
+				   PROCTL_DMAS_SDMA);
+	}
 	esdhc_write32(&regs->blkattr, data->blocks << 16 | data->blocksize);
+
+	return 0;
 }
 
 static int esdhc_setup_data(struct fsl_esdhc_priv *priv, struct mmc *mmc,
 			    struct mmc_data *data)
 {
-	int timeout;
+	int timeout, ret;
 	bool is_write = data->flags & MMC_DATA_WRITE;
 	struct fsl_esdhc *regs = priv->esdhc_regs;
 
@@ -342,8 +458,11 @@ static int esdhc_setup_data(struct fsl_esdhc_priv *priv, struct mmc *mmc,
 	}
 
 	esdhc_setup_watermark_level(priv, data);
-	if (!IS_ENABLED(CONFIG_SYS_FSL_ESDHC_USE_PIO))
-		esdhc_setup_dma(priv, data);
+	if (!IS_ENABLED(CONFIG_SYS_FSL_ESDHC_USE_PIO)) {
+		ret = esdhc_setup_dma(priv, data);
+		if (ret)
+			return ret;
+	}
 
 	/* Calculate the timeout period for data transactions */
 	/*
@@ -558,6 +677,7 @@ static int esdhc_send_cmd_common(struct fsl_esdhc_priv *priv, struct mmc *mmc,
 			dma_unmap_single(priv->dma_addr,
 					 data->blocks * data->blocksize,
 					 mmc_get_dma_dir(data));
+			esdhc_unmap_bounce_buf(priv, data);
 			if (IS_ENABLED(CONFIG_MCF5441x) &&
 			    (data->flags & MMC_DATA_READ))
 				sd_swap_dma_buff(data);
@@ -578,6 +698,14 @@ out:
 				      SYSCTL_RSTD);
 			while ((esdhc_read32(&regs->sysctl) & SYSCTL_RSTD))
 				;
+
+			/* The DMA has stopped, so the bounce buffer is free */
+			if (priv->bounced) {
+				dma_unmap_single(priv->dma_addr,
+						 data->blocks * data->blocksize,
+						 mmc_get_dma_dir(data));
+				priv->bounced = false;
+			}
 		}
 
 		/* If this was CMD11, then notify that power cycle is needed */
@@ -677,6 +805,10 @@ static void esdhc_reset_tuning(struct mmc *mmc)
 			esdhc_clrbits32(&regs->autoc12err,
 					MIX_CTRL_SMPCLK_SEL |
 					MIX_CTRL_EXE_TUNE);
+			/* Drop a delay cell set by fsl_esdhc_set_tuning() */
+			esdhc_write32(&regs->clktunectrlstatus, 0);
+			esdhc_setbits32(&regs->tuning_ctrl,
+					ESDHC_STD_TUNING_EN);
 		}
 	}
 }
@@ -844,6 +976,10 @@ static int fsl_esdhc_execute_tuning(struct udevice *dev, uint32_t opcode)
 
 	/* This is readw/writew SDHCI_HOST_CONTROL2 when tuning */
 	if (priv->flags & ESDHC_FLAG_STD_TUNING) {
+		/* fsl_esdhc_set_tuning() may have turned standard tuning off */
+		esdhc_write32(&regs->clktunectrlstatus, 0);
+		esdhc_setbits32(&regs->tuning_ctrl, ESDHC_STD_TUNING_EN);
+
 		val = esdhc_read32(&regs->autoc12err);
 		mixctrl = esdhc_read32(&regs->mixctrl);
 		val &= ~MIX_CTRL_SMPCLK_SEL;
@@ -1089,6 +1225,21 @@ static int esdhc_reset(struct fsl_esdhc *regs)
 	return 0;
 }
 
+/*
+ * Split only transfers which reach above 4 GiB, into pieces which fit the
+ * bounce buffer. The rest still go out as a single DMA.
+ */
+static int esdhc_get_b_max_common(struct fsl_esdhc_priv *priv,
+				  struct mmc *mmc, void *dst, lbaint_t blkcnt)
+{
+	u64 end = (u64)virt_to_phys(dst) + (u64)blkcnt * MMC_MAX_BLOCK_LEN - 1;
+
+	if (priv->bounce_buf && upper_32_bits(end))
+		return min_t(uint, mmc->cfg->b_max, ESDHC_BOUNCE_BLKS);
+
+	return mmc->cfg->b_max;
+}
+
 #if !CONFIG_IS_ENABLED(DM_MMC)
 static int esdhc_getcd(struct mmc *mmc)
 {
@@ -1119,11 +1270,19 @@ static int esdhc_set_ios(struct mmc *mmc)
 	return esdhc_set_ios_common(priv, mmc);
 }
 
+static int esdhc_get_b_max(struct mmc *mmc, void *dst, lbaint_t blkcnt)
+{
+	struct fsl_esdhc_priv *priv = mmc->priv;
+
+	return esdhc_get_b_max_common(priv, mmc, dst, blkcnt);
+}
+
 static const struct mmc_ops esdhc_ops = {
 	.getcd		= esdhc_getcd,
 	.init		= esdhc_init,
 	.send_cmd	= esdhc_send_cmd,
 	.set_ios	= esdhc_set_ios,
+	.get_b_max	= esdhc_get_b_max,
 };
 #endif
 
@@ -1204,11 +1363,45 @@ static int fsl_esdhc_init(struct fsl_esdhc_priv *priv,
 
 	cfg->host_caps |= priv->caps;
 
+	/* Auto CMD12 would follow every transfer, even one sized by CMD23 */
+	if (!IS_ENABLED(CONFIG_SYS_FSL_ERRATUM_ESDHC111))
+		cfg->host_caps |= MMC_CAP_CMD23;
+
 	cfg->f_min = 400000;
 	cfg->f_max = min(priv->sdhc_clk, (u32)200000000);
 
 	cfg->b_max = CONFIG_SYS_MMC_MAX_BLK_COUNT;
 
+#if CONFIG_IS_ENABLED(FSL_ESDHC_IMX_ADMA2)
+	/* The descriptor table must be below 4 GiB like the data */
+	if (caps & HOSTCAPBLT_DMAS && !priv->adma_desc_table) {
+		priv->adma_desc_table = memalign(ARCH_DMA_MINALIGN,
+						 ESDHC_ADMA_TABLE_SZ);
+		if (priv->adma_desc_table &&
+		    upper_32_bits(virt_to_phys(priv->adma_desc_table))) {
+			free(priv->adma_desc_table);
+			priv->adma_desc_table = NULL;
+		}
+		if (!priv->adma_desc_table)
+			debug("No ADMA table, falling back to SDMA\n");
+	}
+#endif
+
+	/* With DRAM above 4 GiB, keep a bounce buffer below it */
+	if (!IS_ENABLED(CONFIG_SYS_FSL_ESDHC_USE_PIO) &&
+	    upper_32_bits((u64)gd->ram_base + gd->ram_size - 1) &&
+	    !priv->bounce_buf) {
+		priv->bounce_buf = memalign(ARCH_DMA_MINALIGN, ESDHC_BOUNCE_SZ);
+		if (priv->bounce_buf &&
+		    upper_32_bits(virt_to_phys(priv->bounce_buf) +
+				  ESDHC_BOUNCE_SZ - 1)) {
+			free(priv->bounce_buf);
+			priv->bounce_buf = NULL;
+		}
+		if (!priv->bounce_buf)
+			printf("No bounce buffer, DRAM above 4 GiB unusable\n");
+	}
+
 	esdhc_write32(&regs->dllctrl, 0);
 	if (priv->flags & ESDHC_FLAG_USDHC) {
 		if (priv->flags & ESDHC_FLAG_STD_TUNING) {
@@ -1603,6 +1796,15 @@ static int fsl_esdhc_set_ios(struct udevice *dev)
 	return esdhc_set_ios_common(priv, &plat->mmc);
 }
 
+static int fsl_esdhc_get_b_max(struct udevice *dev, void *dst,
+			       lbaint_t blkcnt)
+{
+	struct fsl_esdhc_plat *plat = dev_get_plat(dev);
+	struct fsl_esdhc_priv *priv = dev_get_priv(dev);
+
+	return esdhc_get_b_max_common(priv, &plat->mmc, dst, blkcnt);
+}
+
 static int __maybe_unused fsl_esdhc_set_enhanced_strobe(struct udevice *dev)
 {
 	struct fsl_esdhc_priv *priv = dev_get_priv(dev);
@@ -1640,6 +1842,46 @@ static int fsl_esdhc_wait_dat0(struct udevice *dev, int state,
 	return ret;
 }
 
+static int fsl_esdhc_get_tuning(struct udevice *dev, u32 *tuning)
+{
+	struct fsl_esdhc_priv *priv = dev_get_priv(dev);
+	struct fsl_esdhc *regs = priv->esdhc_regs;
+	u32 val;
+
+	if (!(priv->flags & ESDHC_FLAG_STD_TUNING))
+		return -ENOSYS;
+
+	/* The delay cell selected by the last standard tuning */
+	val = esdhc_read32(&regs->clktunectrlstatus);
+	*tuning = (val & ESDHC_TUNE_CTRL_TAP_SEL_PRE_MASK) >>
+		  ESDHC_TUNE_CTRL_TAP_SEL_PRE_SHIFT;
+
+	return 0;
+}
+
+static int fsl_esdhc_set_tuning(struct udevice *dev, u32 tuning)
+{
+	struct fsl_esdhc_priv *priv = dev_get_priv(dev);
+	struct fsl_esdhc *regs = priv->esdhc_regs;
+
+	if (!(priv->flags & ESDHC_FLAG_STD_TUNING))
+		return -ENOSYS;
+
+	/*
+	 * Select the delay cell by hand, as manual tuning would. Standard
+	 * tuning is turned back on by esdhc_reset_tuning() and before the
+	 * next fsl_esdhc_execute_tuning().
+	 */
+	esdhc_clrbits32(&regs->tuning_ctrl, ESDHC_STD_TUNING_EN);
+	esdhc_setbits32(&regs->mixctrl, MIX_CTRL_FBCLK_SEL);
+	esdhc_write32(&regs->clktunectrlstatus,
+		      (tuning << ESDHC_TUNE_CTRL_DLY_CELL_SET_PRE_SHIFT) &
+		      ESDHC_TUNE_CTRL_DLY_CELL_SET_PRE_MASK);
+	esdhc_setbits32(&regs->autoc12err, MIX_CTRL_SMPCLK_SEL);
+
+	return 0;
+}
+
 static int fsl_esdhc_reinit(struct udevice *dev)
 {
 	struct fsl_esdhc_plat *plat = dev_get_plat(dev);
@@ -1654,12 +1896,15 @@ static const struct dm_mmc_ops fsl_esdhc_ops = {
 	.set_ios	= fsl_esdhc_set_ios,
 #ifdef MMC_SUPPORTS_TUNING
 	.execute_tuning	= fsl_esdhc_execute_tuning,
+	.get_tuning	= fsl_esdhc_get_tuning,
+	.set_tuning	= fsl_esdhc_set_tuning,
 #endif
 #if CONFIG_IS_ENABLED(MMC_HS400_ES_SUPPORT)
 	.set_enhanced_strobe = fsl_esdhc_set_enhanced_strobe,
 #endif
 	.wait_dat0 = fsl_esdhc_wait_dat0,
 	.reinit = fsl_esdhc_reinit,
+	.get_b_max = fsl_esdhc_get_b_max,
 };
 
 static struct esdhc_soc_data usdhc_imx7d_data = {
@@ -10,6 +10,7 @@
 #include <config.h>
 #include <common.h>
 #include <blk.h>
+#include <bloblist.h>
 #include <command.h>
 #include <dm.h>
 #include <log.h>
@@ -395,11 +396,29 @@ int mmc_send_tuning(struct mmc *mmc, u32 opcode, int *cmd_error)
 }
 #endif
 
+int mmc_set_blockcount(struct mmc *mmc, unsigned int blockcount,
+		       bool is_rel_write)
+{
+	struct mmc_cmd cmd = {0};
+
+	cmd.cmdidx = MMC_CMD_SET_BLOCK_COUNT;
+	cmd.cmdarg = blockcount & 0x0000FFFF;
+	if (is_rel_write)
+		cmd.cmdarg |= 1 << 31;
+	cmd.resp_type = MMC_RSP_R1;
+
+	return mmc_send_cmd(mmc, &cmd, NULL);
+}
+
 static int mmc_read_blocks(struct mmc *mmc, void *dst, lbaint_t start,
 			   lbaint_t blkcnt)
 {
 	struct mmc_cmd cmd;
 	struct mmc_data data;
+	bool cmd23 = mmc_use_cmd23(mmc, blkcnt);
+
+	if (cmd23 && mmc_set_blockcount(mmc, blkcnt, false))
+		return 0;
 
 	if (blkcnt > 1)
 		cmd.cmdidx = MMC_CMD_READ_MULTIPLE_BLOCK;
@@ -421,7 +440,7 @@ static int mmc_read_blocks(struct mmc *mmc, void *dst, lbaint_t start,
 	if (mmc_send_cmd(mmc, &cmd, &data))
 		return 0;
 
-	if (blkcnt > 1) {
+	if (blkcnt > 1 && !cmd23) {
 		cmd.cmdidx = MMC_CMD_STOP_TRANSMISSION;
 		cmd.cmdarg = 0;
 		cmd.resp_type = MMC_RSP_R1b;
@@ -437,7 +456,7 @@ static int mmc_read_blocks(struct mmc *mmc, void *dst, lbaint_t start,
 }
 
 #if !CONFIG_IS_ENABLED(DM_MMC)
-static int mmc_get_b_max(struct mmc *mmc, void *dst, lbaint_t blkcnt)
+int mmc_get_b_max(struct mmc *mmc, void *dst, lbaint_t blkcnt)
 {
 	if (mmc->cfg->ops->get_b_max)
 		return mmc->cfg->ops->get_b_max(mmc, dst, blkcnt);
@@ -2413,13 +2432,46 @@ error:
 	return err;
 }
 
+/* Fill in the block device description from the card registers */
+static void mmc_fill_blk_desc(struct mmc *mmc)
+{
+	struct blk_desc *bdesc = mmc_get_blk_desc(mmc);
+
+	bdesc->lun = 0;
+	bdesc->hwpart = 0;
+	bdesc->type = 0;
+	bdesc->blksz = mmc->read_bl_len;
+	bdesc->log2blksz = LOG2(bdesc->blksz);
+	bdesc->lba = lldiv(mmc->capacity, mmc->read_bl_len);
+#if !defined(CONFIG_SPL_BUILD) || \
+		(defined(CONFIG_SPL_LIBCOMMON_SUPPORT) && \
+		!CONFIG_IS_ENABLED(USE_TINY_PRINTF))
+	sprintf(bdesc->vendor, "Man %06x Snr %04x%04x",
+		mmc->cid[0] >> 24, (mmc->cid[2] & 0xffff),
+		(mmc->cid[3] >> 16) & 0xffff);
+	sprintf(bdesc->product, "%c%c%c%c%c%c", mmc->cid[0] & 0xff,
+		(mmc->cid[1] >> 24), (mmc->cid[1] >> 16) & 0xff,
+		(mmc->cid[1] >> 8) & 0xff, mmc->cid[1] & 0xff,
+		(mmc->cid[2] >> 24) & 0xff);
+	sprintf(bdesc->revision, "%d.%d", (mmc->cid[2] >> 20) & 0xf,
+		(mmc->cid[2] >> 16) & 0xf);
+#else
+	bdesc->vendor[0] = 0;
+	bdesc->product[0] = 0;
+	bdesc->revision[0] = 0;
+#endif
+
+#if !defined(CONFIG_DM_MMC) && (!defined(CONFIG_SPL_BUILD) || defined(CONFIG_SPL_LIBDISK_SUPPORT))
+	part_init(bdesc);
+#endif
+}
+
 static int mmc_startup(struct mmc *mmc)
 {
 	int err, i;
 	uint mult, freq;
 	u64 cmult, csize;
 	struct mmc_cmd cmd;
-	struct blk_desc *bdesc;
 
 #ifdef CONFIG_MMC_SPI_CRC_ON
 	if (mmc_host_is_spi(mmc)) { /* enable CRC check for spi */
@@ -2610,35 +2662,7 @@ static int mmc_startup(struct mmc *mmc)
 #endif
 	}
 
-	/* fill in device description */
-	bdesc = mmc_get_blk_desc(mmc);
-	bdesc->lun = 0;
-	bdesc->hwpart = 0;
-	bdesc->type = 0;
-	bdesc->blksz = mmc->read_bl_len;
-	bdesc->log2blksz = LOG2(bdesc->blksz);
-	bdesc->lba = lldiv(mmc->capacity, mmc->read_bl_len);
-#if !defined(CONFIG_SPL_BUILD) || \
-		(defined(CONFIG_SPL_LIBCOMMON_SUPPORT) && \
-		!CONFIG_IS_ENABLED(USE_TINY_PRINTF))
-	sprintf(bdesc->vendor, "Man %06x Snr %04x%04x",
-		mmc->cid[0] >> 24, (mmc->cid[2] & 0xffff),
-		(mmc->cid[3] >> 16) & 0xffff);
-	sprintf(bdesc->product, "%c%c%c%c%c%c", mmc->cid[0] & 0xff,
-		(mmc->cid[1] >> 24), (mmc->cid[1] >> 16) & 0xff,
-		(mmc->cid[1] >> 8) & 0xff, mmc->cid[1] & 0xff,
-		(mmc->cid[2] >> 24) & 0xff);
-	sprintf(bdesc->revision, "%d.%d", (mmc->cid[2] >> 20) & 0xf,
-		(mmc->cid[2] >> 16) & 0xf);
-#else
-	bdesc->vendor[0] = 0;
-	bdesc->product[0] = 0;
-	bdesc->revision[0] = 0;
-#endif
-
-#if !defined(CONFIG_DM_MMC) && (!defined(CONFIG_SPL_BUILD) || defined(CONFIG_SPL_LIBDISK_SUPPORT))
-	part_init(bdesc);
-#endif
+	mmc_fill_blk_desc(mmc);
 
 	return 0;
 }
@@ -2857,6 +2881,232 @@ retry:
 	return err;
 }
 
+#if IS_ENABLED(CONFIG_MMC_HANDOFF)
+/* Check whether the host was tuned for a mode, so must be tuned again */
+static bool mmc_mode_needs_tuning(enum bus_mode mode)
+{
+	return mode == MMC_HS_200 || mode == MMC_HS_400 ||
+	       mode == UHS_SDR50 || mode == UHS_SDR104;
+}
+
+#ifdef CONFIG_SPL_BUILD
+int mmc_save_handoff(struct mmc *mmc)
+{
+	struct mmc_handoff *ho;
+
+	ho = bloblist_ensure(BLOBLISTT_U_BOOT_MMC_HANDOFF, sizeof(*ho));
+	if (!ho)
+		return -ENOSPC;
+
+	memset(ho, '\0', sizeof(*ho));
+#ifdef MMC_SUPPORTS_TUNING
+	if (mmc_mode_needs_tuning(mmc->selected_mode)) {
+		int ret = mmc_get_tuning(mmc, &ho->tuning);
+
+		if (ret)
+			return ret;
+	}
+#endif
+	ho->version = mmc->version;
+	ho->high_capacity = mmc->high_capacity;
+	ho->ocr = mmc->ocr;
+	ho->rca = mmc->rca;
+	memcpy(ho->cid, mmc->cid, sizeof(ho->cid));
+	memcpy(ho->csd, mmc->csd, sizeof(ho->csd));
+	memcpy(ho->scr, mmc->scr, sizeof(ho->scr));
+	ho->card_caps = mmc->card_caps;
+	ho->cardtype = mmc->cardtype;
+	ho->selected_mode = mmc->selected_mode;
+	ho->best_mode = mmc->best_mode;
+	ho->legacy_speed = mmc->legacy_speed;
+	ho->bus_width = mmc->bus_width;
+	ho->clock = mmc->clock;
+	ho->signal_voltage = mmc->signal_voltage;
+	ho->read_bl_len = mmc->read_bl_len;
+	ho->capacity_user = mmc->capacity_user;
+	if (mmc->ext_csd)
+		memcpy(ho->ext_csd, mmc->ext_csd, MMC_MAX_BLOCK_LEN);
+
+	/* Set this last, since it marks the state as valid */
+	ho->base = dev_read_addr(mmc->dev);
+
+	return 0;
+}
+#else
+/*
+ * Work out the bus mode a full initialisation here would pick for the card.
+ * SPL is often built without the faster modes, so the mode it left the card
+ * in may be slower than the one U-Boot proper can use.
+ */
+static int mmc_handoff_best_mode(struct mmc *mmc, enum bus_mode *modep)
+{
+	const struct mode_width_tuning *mwt;
+	uint caps;
+	int err;
+
+	if (IS_SD(mmc)) {
+		/* UHS needs the signal voltage switch during identification */
+		if (CONFIG_IS_ENABLED(MMC_UHS_SUPPORT) &&
+		    !(mmc->ocr & OCR_S18R) && (mmc->host_caps & UHS_CAPS))
+			return -EAGAIN;
+		err = sd_get_capabilities(mmc);
+		if (err)
+			return err;
+		caps = mmc->card_caps & mmc->host_caps;
+		if (!(mmc->ocr & OCR_S18R))
+			caps &= ~UHS_CAPS;
+		for_each_sd_mode_by_pref(caps, mwt) {
+			if (caps & mwt->widths) {
+				*modep = mwt->mode;
+				return 0;
+			}
+		}
+	} else {
+		err = mmc_get_capabilities(mmc);
+		if (err)
+			return err;
+		caps = mmc->card_caps & mmc->host_caps;
+		for_each_mmc_mode_by_pref(caps, mwt) {
+			if (caps & mwt->widths) {
+				*modep = mwt->mode;
+				return 0;
+			}
+		}
+	}
+
+	return -EINVAL;
+}
+
+/*
+ * Carry on with the card in the state SPL left it in. The host is set up for
+ * the same bus mode and tuning, then the card is checked to still be selected
+ * and to respond at that speed. If a full initialisation would pick a faster
+ * mode, the state is not used. The EXT_CSD is read again, since SPL may have
+ * changed the partition in use.
+ */
+static int mmc_resume_handoff(struct mmc *mmc)
+{
+	struct mmc_handoff *ho;
+	uint status, hwpart;
+	enum bus_mode best;
+	int err;
+
+	ho = bloblist_find(BLOBLISTT_U_BOOT_MMC_HANDOFF, sizeof(*ho));
+	if (!ho || !ho->base || ho->base != dev_read_addr(mmc->dev))
+		return -ENOENT;
+	/* The state is only valid until the card is first initialised */
+	ho->base = 0;
+
+	if (!(mmc->host_caps & MMC_CAP(ho->selected_mode)))
+		return -EINVAL;
+
+	err = mmc_power_init(mmc);
+	if (!err)
+		err = mmc_reinit(mmc);
+	if (err)
+		return err;
+
+	mmc->version = ho->version;
+	mmc->high_capacity = ho->high_capacity;
+	mmc->ocr = ho->ocr;
+	mmc->rca = ho->rca;
+	memcpy(mmc->cid, ho->cid, sizeof(mmc->cid));
+	memcpy(mmc->csd, ho->csd, sizeof(mmc->csd));
+	memcpy(mmc->scr, ho->scr, sizeof(mmc->scr));
+	mmc->card_caps = ho->card_caps;
+	mmc->cardtype = ho->cardtype;
+	mmc->legacy_speed = ho->legacy_speed;
+	mmc->read_bl_len = ho->read_bl_len;
+	mmc->capacity_user = ho->capacity_user;
+	mmc->part_config = MMCPART_NOAVAILABLE;
+#if CONFIG_IS_ENABLED(MMC_WRITE)
+	if (IS_SD(mmc))
+		mmc->write_bl_len = mmc->read_bl_len;
+	else
+		mmc->write_bl_len = 1 << ((mmc->csd[3] >> 22) & 0xf);
+	mmc->write_bl_len = min_t(uint, mmc->write_bl_len, MMC_MAX_BLOCK_LEN);
+	mmc->erase_grp_size = 1;
+#endif
+
+	mmc_select_mode(mmc, ho->selected_mode);
+	mmc->best_mode = ho->best_mode;
+	if (mmc->ddr_mode) {
+		mmc->read_bl_len = MMC_MAX_BLOCK_LEN;
+#if CONFIG_IS_ENABLED(MMC_WRITE)
+		mmc->write_bl_len = MMC_MAX_BLOCK_LEN;
+#endif
+	}
+
+	err = mmc_set_signal_voltage(mmc, ho->signal_voltage);
+	if (!err)
+		err = mmc_set_bus_width(mmc, ho->bus_width);
+	if (!err)
+		err = mmc_set_clock(mmc, ho->clock, MMC_CLK_ENABLE);
+	if (!err && mmc_mode_needs_tuning(mmc->selected_mode)) {
+#ifdef MMC_SUPPORTS_TUNING
+		err = mmc_set_tuning(mmc, ho->tuning);
+#else
+		err = -ENOSYS;
+#endif
+	}
+#if CONFIG_IS_ENABLED(MMC_HS400_ES_SUPPORT)
+	if (!err && mmc->selected_mode == MMC_HS_400_ES)
+		err = mmc_set_enhanced_strobe(mmc);
+#endif
+	if (err)
+		goto err;
+
+	err = mmc_send_status(mmc, &status);
+	if (err)
+		goto err;
+	if ((status & MMC_STATUS_CURR_STATE) != MMC_STATE_TRANS) {
+		err = -EIO;
+		goto err;
+	}
+
+	err = mmc_startup_v4(mmc);
+	if (err)
+		goto err;
+
+	/* Only keep the mode from SPL if there is no faster one to use */
+	err = mmc_handoff_best_mode(mmc, &best);
+	if (err)
+		goto err;
+	if (best != ho->selected_mode) {
+		pr_debug("%s: %s from SPL, %s is faster\n", __func__,
+			 mmc_mode_name(ho->selected_mode), mmc_mode_name(best));
+		err = -EAGAIN;
+		goto err;
+	}
+
+	hwpart = 0;
+	if (mmc->ext_csd) {
+		if (memcmp(&mmc->ext_csd[EXT_CSD_SEC_CNT],
+			   &ho->ext_csd[EXT_CSD_SEC_CNT], 4)) {
+			err = -ENODEV;
+			goto err;
+		}
+		hwpart = mmc->ext_csd[EXT_CSD_PART_CONF] & PART_ACCESS_MASK;
+	}
+#if CONFIG_IS_ENABLED(MMC_WRITE)
+	if (IS_SD(mmc) && sd_read_ssr(mmc))
+		pr_warn("unable to read ssr\n");
+#endif
+
+	err = mmc_set_capacity(mmc, hwpart);
+	if (err)
+		goto err;
+	mmc_fill_blk_desc(mmc);
+	mmc_get_blk_desc(mmc)->hwpart = hwpart;
+
+	return 0;
+err:
+	pr_debug("%s: cannot use the state from SPL: %d\n", __func__, err);
+	return err;
+}
+#endif /* CONFIG_SPL_BUILD */
+#endif /* CONFIG_MMC_HANDOFF */
+
 int mmc_start_init(struct mmc *mmc)
 {
 	bool no_card;
@@ -2906,6 +3156,12 @@ int mmc_start_init(struct mmc *mmc)
 		return -ENOMEDIUM;
 	}
 
+#if IS_ENABLED(CONFIG_MMC_HANDOFF) && !defined(CONFIG_SPL_BUILD)
+	if (!mmc_resume_handoff(mmc)) {
+		mmc->has_init = 1;
+		return 0;
+	}
+#endif
 	err = mmc_get_op_cond(mmc, false);
 
 	if (!err)
@@ -2948,7 +3204,7 @@ int mmc_init(struct mmc *mmc)
 	if (!mmc->init_in_progress)
 		err = mmc_start_init(mmc);
 
-	if (!err)
+	if (!err && !mmc->has_init)
 		err = mmc_complete_init(mmc);
 	if (err)
 		pr_info("%s: %d, time %lu\n", __func__, err, get_timer(start));
@@ -17,6 +17,39 @@ int mmc_poll_for_busy(struct mmc *mmc, int timeout);
 
 int mmc_set_blocklen(struct mmc *mmc, int len);
 
+/**
+ * mmc_set_blockcount() - Send CMD23 to set the length of the next transfer
+ *
+ * @mmc:	MMC device
+ * @blockcount:	Number of blocks of the next multi-block read or write
+ * @is_rel_write: true to request a reliable write
+ * Return: 0 if OK, -ve on error
+ */
+int mmc_set_blockcount(struct mmc *mmc, unsigned int blockcount,
+		       bool is_rel_write);
+
+/**
+ * mmc_use_cmd23() - Check whether a transfer can be sized with CMD23
+ *
+ * A multi-block transfer sized with CMD23 ends by itself, so no CMD12 is
+ * needed after it. The host has to support this and, for SD, the card has
+ * to announce it in its SCR. It is mandatory for eMMC.
+ *
+ * @mmc:	MMC device
+ * @blkcnt:	Number of blocks to transfer
+ * Return: true to use CMD23 rather than CMD12 for the transfer
+ */
+static inline bool mmc_use_cmd23(struct mmc *mmc, lbaint_t blkcnt)
+{
+	if (blkcnt < 2 || blkcnt > 0xffff || mmc_host_is_spi(mmc) ||
+	    !(mmc->cfg->host_caps & MMC_CAP_CMD23))
+		return false;
+	if (IS_SD(mmc))
+		return mmc->scr[0] & SD_SCR_CMD23_SUPPORT;
+
+	return mmc->version >= MMC_VERSION_3;
+}
+
 #if CONFIG_IS_ENABLED(BLK)
 ulong mmc_bread(struct udevice *dev, lbaint_t start, lbaint_t blkcnt,
 		void *dst);
@@ -77,6 +77,11 @@ DECLARE_GLOBAL_DATA_PTR;
 #error "PKTALIGN must be multiple of ARCH_DMA_MINALIGN!"
 #endif
 
+/* Receive descriptors are given back to the DMA a cacheline at a time */
+#if (FEC_RBD_NUM % (ARCH_DMA_MINALIGN / 8) != 0)
+#error "FEC_MXC_RX_RING_SIZE must be multiple of ARCH_DMA_MINALIGN / 8!"
+#endif
+
 #undef DEBUG
 
 #ifdef CONFIG_FEC_MXC_SWAP_PACKET
@@ -851,10 +856,58 @@ out:
 	return ret;
 }
 
+/**
+ * Give the current receive buffer back to the DMA and move on to the next
+ * @param[in] fec all we know about the device
+ * @param[in] len number of bytes of the buffer which may be dirty in the cache
+ */
+static void fec_rx_recycle(struct fec_priv *fec, int len)
+{
+	struct fec_bd *rbd = &fec->rbd_base[fec->rbd_index];
+	ulong addr, size;
+	int i;
+
+	/*
+	 * The received frame may have been changed in place, e.g. to answer a
+	 * ping. Write back what was touched, so that no dirty cache line can
+	 * be evicted over the next frame the DMA puts in this buffer.
+	 */
+	if (len > 0) {
+		addr = readl(&rbd->data_pointer);
+		flush_dcache_range(addr,
+				   roundup(addr + len, ARCH_DMA_MINALIGN));
+	}
+
+	/*
+	 * Free the current buffer, restart the engine and move forward
+	 * to the next buffer. Here we check if the whole cacheline of
+	 * descriptors was already processed and if so, we mark it free
+	 * as whole.
+	 */
+	size = RXDESC_PER_CACHELINE - 1;
+	if ((fec->rbd_index & size) == size) {
+		i = fec->rbd_index - size;
+		addr = (ulong)&fec->rbd_base[i];
+		for (; i <= fec->rbd_index ; i++) {
+			fec_rbd_clean(i == (FEC_RBD_NUM - 1),
+				      &fec->rbd_base[i]);
+		}
+		flush_dcache_range(addr,
+				   addr + ARCH_DMA_MINALIGN);
+	}
+
+	fec_rx_task_enable(fec);
+	fec->rbd_index = (fec->rbd_index + 1) % FEC_RBD_NUM;
+}
+
 /**
  * Pull one frame from the card
  * @param[in] dev Our ethernet device to handle
  * Return: Length of packet read
+ *
+ * The frame is not copied: it is passed on in the receive buffer it was
+ * written to. With driver model, the buffer is given back to the DMA by
+ * fecmxc_free_pkt().
  */
 #ifdef CONFIG_DM_ETH
 static int fecmxc_recv(struct udevice *dev, int flags, uchar **packetp)
@@ -872,16 +925,10 @@ static int fec_recv(struct eth_device *dev)
 	int frame_length, len = 0;
 	uint16_t bd_status;
 	ulong addr, size, end;
-	int i;
+	uchar *packet;
 
 #ifdef CONFIG_DM_ETH
-	*packetp = memalign(ARCH_DMA_MINALIGN, FEC_MAX_PKT_SIZE);
-	if (*packetp == 0) {
-		printf("%s: error allocating packetp\n", __func__);
-		return -ENOMEM;
-	}
-#else
-	ALLOC_CACHE_ALIGN_BUFFER(uchar, buff, FEC_MAX_PKT_SIZE);
+	*packetp = NULL;
 #endif
 
 	if (!(readl(&fec->eth->ecntrl) & FEC_ECNTRL_ETHER_EN))
@@ -950,23 +997,24 @@ static int fec_recv(struct eth_device *dev)
 		if ((bd_status & FEC_RBD_LAST) && !(bd_status & FEC_RBD_ERR) &&
 		    ((readw(&rbd->data_length) - 4) > 14)) {
 			/* Get buffer address and size */
-			addr = readl(&rbd->data_pointer);
+			packet = (uchar *)(ulong)readl(&rbd->data_pointer);
 			frame_length = readw(&rbd->data_length) - 4;
-			/* Invalidate data cache over the buffer */
-			end = roundup(addr + frame_length, ARCH_DMA_MINALIGN);
-			addr &= ~(ARCH_DMA_MINALIGN - 1);
+			/* Invalidate data cache over the received frame */
+			addr = (ulong)packet & ~(ARCH_DMA_MINALIGN - 1);
+			end = roundup((ulong)packet + frame_length,
+				      ARCH_DMA_MINALIGN);
 			invalidate_dcache_range(addr, end);
 
-			/* Fill the buffer and pass it to upper layers */
+			/* Pass the buffer to upper layers */
 #ifdef CONFIG_FEC_MXC_SWAP_PACKET
-			swap_packet((uint32_t *)addr, frame_length);
+			swap_packet((uint32_t *)packet, frame_length);
 #endif
 
 #ifdef CONFIG_DM_ETH
-			memcpy(*packetp, (char *)addr, frame_length);
+			*packetp = packet;
+			return frame_length;
 #else
-			memcpy(buff, (char *)addr, frame_length);
-			net_process_received_packet(buff, frame_length);
+			net_process_received_packet(packet, frame_length);
 #endif
 			len = frame_length;
 		} else {
@@ -975,26 +1023,7 @@ static int fec_recv(struct eth_device *dev)
 				      addr, bd_status);
 		}
 
-		/*
-		 * Free the current buffer, restart the engine and move forward
-		 * to the next buffer. Here we check if the whole cacheline of
-		 * descriptors was already processed and if so, we mark it free
-		 * as whole.
-		 */
-		size = RXDESC_PER_CACHELINE - 1;
-		if ((fec->rbd_index & size) == size) {
-			i = fec->rbd_index - size;
-			addr = (ulong)&fec->rbd_base[i];
-			for (; i <= fec->rbd_index ; i++) {
-				fec_rbd_clean(i == (FEC_RBD_NUM - 1),
-					      &fec->rbd_base[i]);
-			}
-			flush_dcache_range(addr,
-					   addr + ARCH_DMA_MINALIGN);
-		}
-
-		fec_rx_task_enable(fec);
-		fec->rbd_index = (fec->rbd_index + 1) % FEC_RBD_NUM;
+		fec_rx_recycle(fec, len);
 	}
 	debug("fec_recv: stop\n");
 
@@ -1300,8 +1329,12 @@ static int fecmxc_set_promisc(struct udevice *dev, bool enable)
 
 static int fecmxc_free_pkt(struct udevice *dev, uchar *packet, int length)
 {
-	if (packet)
-		free(packet);
+	struct fec_priv *fec = dev_get_priv(dev);
+	struct fec_bd *rbd = &fec->rbd_base[fec->rbd_index];
+
+	/* Only the frame returned by the last fecmxc_recv() is held */
+	if (packet && (ulong)packet == readl(&rbd->data_pointer))
+		fec_rx_recycle(fec, length);
 
 	return 0;
 }
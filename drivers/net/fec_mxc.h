@@ -279,9 +279,8 @@ struct fec_priv {
  * @brief Numbers of buffer descriptors for receiving
  *
  * The number defines the stocked memory buffers for the receiving task.
- * Larger values makes no sense in this limited environment.
  */
-#define FEC_RBD_NUM		64
+#define FEC_RBD_NUM		CONFIG_FEC_MXC_RX_RING_SIZE
 
 /**
  * @brief Define the ethernet packet size limit in memory
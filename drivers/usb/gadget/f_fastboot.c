@@ -579,6 +579,10 @@ static void rx_handler_dl_image(struct usb_ep *ep, struct usb_request *req)
 
 	req->actual = 0;
 	usb_ep_queue(ep, req, 0);
+
+	/* Write out streamed data while the next transfer is received */
+	if (CONFIG_IS_ENABLED(FASTBOOT_STREAM))
+		fastboot_data_stream();
 }
 
 static void do_exit_on_complete(struct usb_ep *ep, struct usb_request *req)
@@ -819,7 +819,7 @@ static int do_write(struct fsg_common *common)
 {
 	struct fsg_lun		*curlun = &common->luns[common->lun];
 	u32			lba;
-	struct fsg_buffhd	*bh;
+	struct fsg_buffhd	*bh, *last;
 	int			get_some_more;
 	u32			amount_left_to_req, amount_left_to_write;
 	loff_t			usb_offset, file_offset;
@@ -935,6 +935,18 @@ static int do_write(struct fsg_common *common)
 
 			amount = bh->outreq->actual;
 
+			/* Write the full buffers which follow in the same go */
+			last = bh;
+			while (last->outreq->actual == FSG_BUFLEN &&
+			       last->next->state == BUF_STATE_FULL &&
+			       last->next->buf == last->buf + FSG_BUFLEN &&
+			       last->next->outreq->status == 0) {
+				last = last->next;
+				common->next_buffhd_to_drain = last->next;
+				last->state = BUF_STATE_EMPTY;
+				amount += last->outreq->actual;
+			}
+
 			/* Perform the write */
 			rc = ums[common->lun].write_sector(&ums[common->lun],
 					       file_offset / SECTOR_SIZE,
@@ -972,7 +984,7 @@ static int do_write(struct fsg_common *common)
 			}
 
 			/* Did the host decide to stop early? */
-			if (bh->outreq->actual != bh->outreq->length) {
+			if (last->outreq->actual != last->outreq->length) {
 				common->short_packet_received = 1;
 				break;
 			}
@@ -2444,6 +2456,7 @@ static struct fsg_common *fsg_common_init(struct fsg_common *common,
 	struct fsg_buffhd *bh;
 	struct fsg_lun *curlun;
 	int nluns, i, rc;
+	u8 *buf;
 
 	/* Find out how many LUNs there should be */
 	nluns = ums_count;
@@ -2497,7 +2510,13 @@ static struct fsg_common *fsg_common_init(struct fsg_common *common,
 	}
 	common->lun = 0;
 
-	/* Data buffers cyclic list */
+	/* Data buffers cyclic list, in one block so that neighbours can be
+	 * written to the backing file together */
+	buf = memalign(CONFIG_SYS_CACHELINE_SIZE, FSG_NUM_BUFFERS * FSG_BUFLEN);
+	if (unlikely(!buf)) {
+		rc = -ENOMEM;
+		goto error_release;
+	}
 	bh = common->buffhds;
 
 	i = FSG_NUM_BUFFERS;
@@ -2508,11 +2527,8 @@ static struct fsg_common *fsg_common_init(struct fsg_common *common,
 buffhds_first_it:
 		bh->inreq_busy = 0;
 		bh->outreq_busy = 0;
-		bh->buf = memalign(CONFIG_SYS_CACHELINE_SIZE, FSG_BUFLEN);
-		if (unlikely(!bh->buf)) {
-			rc = -ENOMEM;
-			goto error_release;
-		}
+		bh->buf = buf;
+		buf += FSG_BUFLEN;
 	} while (--i);
 	bh->next = common->buffhds;
 
@@ -2574,13 +2590,8 @@ static void fsg_common_release(struct kref *ref)
 		kfree(common->luns);
 	}
 
-	{
-		struct fsg_buffhd *bh = common->buffhds;
-		unsigned i = FSG_NUM_BUFFERS;
-		do {
-			kfree(bh->buf);
-		} while (++bh, --i);
-	}
+	/* All buffers are in the block of the first one */
+	kfree(common->buffhds[0].buf);
 
 	if (common->free_storage_on_release)
 		kfree(common);
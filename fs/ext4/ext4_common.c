@@ -44,6 +44,8 @@ int ext4fs_indir2_blkno = -1;
 __le32 *ext4fs_indir3_block;
 int ext4fs_indir3_size;
 int ext4fs_indir3_blkno = -1;
+/* Extent tree blocks, kept until the filesystem is closed or written */
+static struct ext_block_cache ext4fs_extent_cache;
 struct ext2_inode *g_parent_inode;
 static int symlinknest;
 
@@ -202,6 +204,9 @@ void put_ext4(uint64_t off, const void *buf, uint32_t size)
 	int log2blksz = fs->dev_desc->log2blksz;
 	ALLOC_CACHE_ALIGN_BUFFER(unsigned char, sec_buf, fs->dev_desc->blksz);
 
+	/* This may be an extent tree block */
+	ext_cache_fini(&ext4fs_extent_cache);
+
 	startblock = off >> log2blksz;
 	startblock += part_offset;
 	remainder = off & (uint64_t)(fs->dev_desc->blksz - 1);
@@ -1566,6 +1571,74 @@ static struct ext4_extent_header *ext4fs_get_extent_block
 	}
 }
 
+/**
+ * ext4fs_map_extent() - look up a file block in the extent tree of an inode
+ *
+ * @inode:	Inode using extents
+ * @fileblock:	File block to look up
+ * @cache:	Cache for the extent tree blocks
+ * @countp:	Returns the number of blocks starting at @fileblock which are
+ *		contiguous on the device, or all sparse
+ * Return: device block holding @fileblock, 0 if it is sparse, or -EINVAL if
+ * the extent tree is invalid
+ */
+static long int ext4fs_map_extent(struct ext2_inode *inode, int fileblock,
+				  struct ext_block_cache *cache, int *countp)
+{
+	struct ext4_extent_header *ext_block;
+	struct ext4_extent *extent;
+	long int startblock, endblock;
+	unsigned long long start;
+	int lo, hi, mid, entries;
+	int log2_blksz;
+
+	log2_blksz = LOG2_BLOCK_SIZE(ext4fs_root) -
+		get_fs()->dev_desc->log2blksz;
+	ext_block = ext4fs_get_extent_block(ext4fs_root, cache,
+					    (struct ext4_extent_header *)
+					    inode->b.blocks.dir_blocks,
+					    fileblock, log2_blksz);
+	if (!ext_block) {
+		printf("invalid extent block\n");
+		return -EINVAL;
+	}
+
+	extent = (struct ext4_extent *)(ext_block + 1);
+	entries = le16_to_cpu(ext_block->eh_entries);
+
+	/* Extents are sorted, find the first one starting after fileblock */
+	lo = 0;
+	hi = entries;
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (le32_to_cpu(extent[mid].ee_block) <= fileblock)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	/*
+	 * A hole runs up to the next extent. The end of a hole after the
+	 * last extent of this leaf is not known here, so report one block.
+	 */
+	*countp = 1;
+	if (lo < entries)
+		*countp = le32_to_cpu(extent[lo].ee_block) - fileblock;
+	if (!lo)
+		return 0;
+
+	startblock = le32_to_cpu(extent[lo - 1].ee_block);
+	endblock = startblock + le16_to_cpu(extent[lo - 1].ee_len);
+	if (fileblock >= endblock)
+		return 0;
+
+	*countp = endblock - fileblock;
+	start = le16_to_cpu(extent[lo - 1].ee_start_hi);
+	start = (start << 32) + le32_to_cpu(extent[lo - 1].ee_start_lo);
+
+	return (fileblock - startblock) + start;
+}
+
 static int ext4fs_blockgroup
 	(struct ext2_data *data, int group, struct ext2_block_group *blkgrp)
 {
@@ -1652,62 +1725,17 @@ long int read_allocated_block(struct ext2_inode *inode, int fileblock,
 	long int rblock;
 	long int perblock_parent;
 	long int perblock_child;
-	unsigned long long start;
 	/* get the blocksize of the filesystem */
 	blksz = EXT2_BLOCK_SIZE(ext4fs_root);
 	log2_blksz = LOG2_BLOCK_SIZE(ext4fs_root)
 		- get_fs()->dev_desc->log2blksz;
 
 	if (le32_to_cpu(inode->flags) & EXT4_EXTENTS_FL) {
-		long int startblock, endblock;
-		struct ext_block_cache *c, cd;
-		struct ext4_extent_header *ext_block;
-		struct ext4_extent *extent;
-		int i;
-
-		if (cache) {
-			c = cache;
-		} else {
-			c = &cd;
-			ext_cache_init(c);
-		}
-		ext_block =
-			ext4fs_get_extent_block(ext4fs_root, c,
-						(struct ext4_extent_header *)
-						inode->b.blocks.dir_blocks,
-						fileblock, log2_blksz);
-		if (!ext_block) {
-			printf("invalid extent block\n");
-			if (!cache)
-				ext_cache_fini(c);
-			return -EINVAL;
-		}
-
-		extent = (struct ext4_extent *)(ext_block + 1);
-
-		for (i = 0; i < le16_to_cpu(ext_block->eh_entries); i++) {
-			startblock = le32_to_cpu(extent[i].ee_block);
-			endblock = startblock + le16_to_cpu(extent[i].ee_len);
-
-			if (startblock > fileblock) {
-				/* Sparse file */
-				if (!cache)
-					ext_cache_fini(c);
-				return 0;
+		int count;
 
-			} else if (fileblock < endblock) {
-				start = le16_to_cpu(extent[i].ee_start_hi);
-				start = (start << 32) +
-					le32_to_cpu(extent[i].ee_start_lo);
-				if (!cache)
-					ext_cache_fini(c);
-				return (fileblock - startblock) + start;
-			}
-		}
-
-		if (!cache)
-			ext_cache_fini(c);
-		return 0;
+		return ext4fs_map_extent(inode, fileblock,
+					 cache ? cache : &ext4fs_extent_cache,
+					 &count);
 	}
 
 	/* Direct blocks. */
@@ -1995,6 +2023,54 @@ long int read_allocated_block(struct ext2_inode *inode, int fileblock,
 	return blknr;
 }
 
+/**
+ * read_allocated_run() - map a run of file blocks to the device
+ *
+ * This finds how many blocks starting at @fileblock can be read with a single
+ * device access, so that large files are not read one block at a time.
+ *
+ * @inode:	Inode of the file
+ * @fileblock:	First file block to map
+ * @maxblocks:	Maximum number of blocks to map, at least 1
+ * @countp:	Returns the number of blocks in the run, which are either
+ *		contiguous on the device or all sparse
+ * Return: device block holding @fileblock, 0 if the run is sparse, or -ve on
+ * error
+ */
+long int read_allocated_run(struct ext2_inode *inode, int fileblock,
+			    int maxblocks, int *countp)
+{
+	bool extents = le32_to_cpu(inode->flags) & EXT4_EXTENTS_FL;
+	long int blknr, next;
+	int count, n = 1;
+
+	if (extents)
+		blknr = ext4fs_map_extent(inode, fileblock,
+					  &ext4fs_extent_cache, &count);
+	else
+		blknr = read_allocated_block(inode, fileblock, NULL);
+	if (blknr < 0)
+		return blknr;
+	if (!extents)
+		count = 1;
+
+	/* Adjacent extents or indirect blocks may continue the run */
+	while (count < maxblocks) {
+		if (extents)
+			next = ext4fs_map_extent(inode, fileblock + count,
+						 &ext4fs_extent_cache, &n);
+		else
+			next = read_allocated_block(inode, fileblock + count,
+						    NULL);
+		if (next < 0 || next != (blknr ? blknr + count : 0))
+			break;
+		count += n;
+	}
+	*countp = min(count, maxblocks);
+
+	return blknr;
+}
+
 /**
  * ext4fs_reinit_global() - Reinitialize values of ext4 write implementation's
  *			    global pointers
@@ -2027,6 +2103,7 @@ void ext4fs_reinit_global(void)
 		ext4fs_indir3_size = 0;
 		ext4fs_indir3_blkno = -1;
 	}
+	ext_cache_fini(&ext4fs_extent_cache);
 }
 void ext4fs_close(void)
 {
@@ -53,133 +53,58 @@ int ext4fs_read_file(struct ext2fs_node *node, loff_t pos,
 		loff_t len, char *buf, loff_t *actread)
 {
 	struct ext_filesystem *fs = get_fs();
-	int i;
-	lbaint_t blockcnt;
 	int log2blksz = fs->dev_desc->log2blksz;
 	int log2_fs_blocksize = LOG2_BLOCK_SIZE(node->data) - log2blksz;
 	int blocksize = (1 << (log2_fs_blocksize + log2blksz));
 	unsigned int filesize = le32_to_cpu(node->inode.size);
-	lbaint_t previous_block_number = -1;
-	lbaint_t delayed_start = 0;
-	lbaint_t delayed_extent = 0;
-	lbaint_t delayed_skipfirst = 0;
-	lbaint_t delayed_next = 0;
-	char *delayed_buf = NULL;
-	char *start_buf = buf;
-	short status;
-	struct ext_block_cache cache;
-
-	ext_cache_init(&cache);
+	lbaint_t blockcnt;
+	loff_t left;
+	int maxrun;
+	int skip;
+	int i;
 
 	/* Adjust len so it we can't read past the end of the file. */
 	if (len + pos > filesize)
 		len = (filesize - pos);
 
-	if (blocksize <= 0 || len <= 0) {
-		ext_cache_fini(&cache);
+	if (blocksize <= 0 || len <= 0)
 		return -1;
-	}
 
 	blockcnt = lldiv(((len + pos) + blocksize - 1), blocksize);
-
-	for (i = lldiv(pos, blocksize); i < blockcnt; i++) {
+	/* A single device read is limited to INT_MAX bytes */
+	maxrun = INT_MAX / blocksize;
+
+	/*
+	 * Read a run of blocks which are contiguous on the device, or all
+	 * sparse, at a time. Only the first run can start part-way into a
+	 * block and only the last one can end before the end of a block.
+	 */
+	i = lldiv(pos, blocksize);
+	skip = pos - (loff_t)blocksize * i;
+	for (left = len; left > 0; skip = 0) {
+		lbaint_t sector;
 		long int blknr;
-		int blockoff = pos - (blocksize * i);
-		int blockend = blocksize;
-		int skipfirst = 0;
-		blknr = read_allocated_block(&node->inode, i, &cache);
-		if (blknr < 0) {
-			ext_cache_fini(&cache);
-			return -1;
-		}
-
-		blknr = blknr << log2_fs_blocksize;
+		int count, n;
 
-		/* Last block.  */
-		if (i == blockcnt - 1) {
-			blockend = (len + pos) - (blocksize * i);
-
-			/* The last portion is exactly blocksize. */
-			if (!blockend)
-				blockend = blocksize;
-		}
+		n = min_t(lbaint_t, blockcnt - i, maxrun);
+		blknr = read_allocated_run(&node->inode, i, n, &count);
+		if (blknr < 0)
+			return -1;
 
-		/* First block. */
-		if (i == lldiv(pos, blocksize)) {
-			skipfirst = blockoff;
-			blockend -= skipfirst;
-		}
+		n = min_t(loff_t, (loff_t)count * blocksize - skip, left);
 		if (blknr) {
-			int status;
-
-			if (previous_block_number != -1) {
-				if (delayed_next == blknr) {
-					delayed_extent += blockend;
-					delayed_next += blockend >> log2blksz;
-				} else {	/* spill */
-					status = ext4fs_devread(delayed_start,
-							delayed_skipfirst,
-							delayed_extent,
-							delayed_buf);
-					if (status == 0) {
-						ext_cache_fini(&cache);
-						return -1;
-					}
-					previous_block_number = blknr;
-					delayed_start = blknr;
-					delayed_extent = blockend;
-					delayed_skipfirst = skipfirst;
-					delayed_buf = buf;
-					delayed_next = blknr +
-						(blockend >> log2blksz);
-				}
-			} else {
-				previous_block_number = blknr;
-				delayed_start = blknr;
-				delayed_extent = blockend;
-				delayed_skipfirst = skipfirst;
-				delayed_buf = buf;
-				delayed_next = blknr +
-					(blockend >> log2blksz);
-			}
+			sector = (lbaint_t)blknr << log2_fs_blocksize;
+			if (!ext4fs_devread(sector, skip, n, buf))
+				return -1;
 		} else {
-			int n;
-			int n_left;
-			if (previous_block_number != -1) {
-				/* spill */
-				status = ext4fs_devread(delayed_start,
-							delayed_skipfirst,
-							delayed_extent,
-							delayed_buf);
-				if (status == 0) {
-					ext_cache_fini(&cache);
-					return -1;
-				}
-				previous_block_number = -1;
-			}
-			/* Zero no more than `len' bytes. */
-			n = blocksize - skipfirst;
-			n_left = len - ( buf - start_buf );
-			if (n > n_left)
-				n = n_left;
 			memset(buf, 0, n);
 		}
-		buf += blocksize - skipfirst;
-	}
-	if (previous_block_number != -1) {
-		/* spill */
-		status = ext4fs_devread(delayed_start,
-					delayed_skipfirst, delayed_extent,
-					delayed_buf);
-		if (status == 0) {
-			ext_cache_fini(&cache);
-			return -1;
-		}
-		previous_block_number = -1;
+		buf += n;
+		left -= n;
+		i += count;
 	}
 
 	*actread  = len;
-	ext_cache_fini(&cache);
 	return 0;
 }
 
@@ -281,24 +206,51 @@ void ext_cache_init(struct ext_block_cache *cache)
 
 void ext_cache_fini(struct ext_block_cache *cache)
 {
-	free(cache->buf);
+	int i;
+
+	for (i = 0; i < EXT_CACHE_BLOCKS; i++)
+		free(cache->blocks[i].buf);
 	ext_cache_init(cache);
 }
 
 int ext_cache_read(struct ext_block_cache *cache, lbaint_t block, int size)
 {
-	/* This could be more lenient, but this is simple and enough for now */
-	if (cache->buf && cache->block == block && cache->size == size)
-		return 1;
-	ext_cache_fini(cache);
-	cache->buf = memalign(ARCH_DMA_MINALIGN, size);
-	if (!cache->buf)
-		return 0;
-	if (!ext4fs_devread(block, 0, size, cache->buf)) {
-		ext_cache_fini(cache);
+	struct ext_cache_block *cb, *victim = NULL;
+	int i;
+
+	cache->clock++;
+	for (i = 0; i < EXT_CACHE_BLOCKS; i++) {
+		cb = &cache->blocks[i];
+		if (cb->buf && cb->block == block && cb->size == size) {
+			cb->used = cache->clock;
+			cache->buf = cb->buf;
+			return 1;
+		}
+		if (!victim || !cb->buf ||
+		    (victim->buf && cache->clock - cb->used >
+				    cache->clock - victim->used))
+			victim = cb;
+	}
+
+	cache->buf = NULL;
+	if (victim->buf && victim->size != size) {
+		free(victim->buf);
+		victim->buf = NULL;
+	}
+	if (!victim->buf) {
+		victim->buf = memalign(ARCH_DMA_MINALIGN, size);
+		if (!victim->buf)
+			return 0;
+	}
+	if (!ext4fs_devread(block, 0, size, victim->buf)) {
+		free(victim->buf);
+		victim->buf = NULL;
 		return 0;
 	}
-	cache->block = block;
-	cache->size = size;
+	victim->block = block;
+	victim->size = size;
+	victim->used = cache->clock;
+	cache->buf = victim->buf;
+
 	return 1;
 }
@@ -58,6 +58,9 @@ static int disk_read(__u32 block, __u32 nr_blocks, void *buf)
 	return ret;
 }
 
+static void fat_chain_revalidate(struct blk_desc *dev_desc,
+				 struct disk_partition *info);
+
 int fat_set_blk_dev(struct blk_desc *dev_desc, struct disk_partition *info)
 {
 	ALLOC_CACHE_ALIGN_BUFFER(unsigned char, buffer, dev_desc->blksz);
@@ -78,13 +81,14 @@ int fat_set_blk_dev(struct blk_desc *dev_desc, struct disk_partition *info)
 	}
 
 	/* Check for FAT12/FAT16/FAT32 filesystem */
-	if (!memcmp(buffer + DOS_FS_TYPE_OFFSET, "FAT", 3))
-		return 0;
-	if (!memcmp(buffer + DOS_FS32_TYPE_OFFSET, "FAT32", 5))
-		return 0;
+	if (memcmp(buffer + DOS_FS_TYPE_OFFSET, "FAT", 3) &&
+	    memcmp(buffer + DOS_FS32_TYPE_OFFSET, "FAT32", 5)) {
+		cur_dev = NULL;
+		return -1;
+	}
+	fat_chain_revalidate(dev_desc, info);
 
-	cur_dev = NULL;
-	return -1;
+	return 0;
 }
 
 int fat_register_device(struct blk_desc *dev_desc, int part_no)
@@ -241,6 +245,279 @@ static __u32 get_fatent(fsdata *mydata, __u32 entry)
 	return ret;
 }
 
+/*
+ * Cluster chains are followed once and remembered as runs of consecutive
+ * clusters, so that reading a file takes one disk_read() per run and
+ * reading it again, e.g. in chunks, needs no FAT lookups.
+ *
+ * The chain of a file is kept across operations on the same partition for
+ * as long as its directory entry is unchanged and nothing has been written
+ * to a block device or replaced behind one, see blk_changed(). Directory
+ * chains are only kept until the filesystem is set up again. Writing the
+ * FAT drops all.
+ */
+
+/* Number of cluster chains remembered */
+#define FAT_CHAIN_CACHE_SIZE	4
+
+/**
+ * struct fat_extent - run of consecutive clusters in a cluster chain
+ *
+ * @clust:	First cluster of the run
+ * @count:	Number of clusters in the run
+ * @index:	Position of @clust in the chain
+ */
+struct fat_extent {
+	__u32 clust;
+	__u32 count;
+	__u32 index;
+};
+
+/**
+ * struct fat_chain - the part of a cluster chain followed so far
+ *
+ * @start:	First cluster of the chain, 0 if the entry is unused
+ * @size:	Size of the file, 0 for a directory
+ * @stamp:	Modification date and time of the file, 0 for a directory
+ * @ext:	Extents of the chain, in chain order
+ * @cnt:	Number of extents
+ * @max:	Size of the @ext array
+ * @hint:	Extent used last, to speed up sequential lookups
+ * @done:	true if the end of the chain has been reached
+ */
+struct fat_chain {
+	__u32 start;
+	__u32 size;
+	__u32 stamp;
+	struct fat_extent *ext;
+	__u32 cnt;
+	__u32 max;
+	__u32 hint;
+	bool done;
+};
+
+static struct fat_chain fat_chains[FAT_CHAIN_CACHE_SIZE];
+static int fat_chain_next_free;
+static struct blk_desc *fat_chain_dev;
+static lbaint_t fat_chain_part;
+static unsigned long fat_chain_changes;
+
+static void fat_chain_drop(struct fat_chain *chain)
+{
+	free(chain->ext);
+	memset(chain, '\0', sizeof(*chain));
+}
+
+/* Forget all chains, needed whenever the FAT is changed */
+static void fat_chain_invalidate(void)
+{
+	int i;
+
+	for (i = 0; i < FAT_CHAIN_CACHE_SIZE; i++)
+		fat_chain_drop(&fat_chains[i]);
+}
+
+/*
+ * Drop what cannot be trusted once the filesystem is set up again. Changes
+ * to block devices are not counted without driver model, so then drop all.
+ */
+static void fat_chain_revalidate(struct blk_desc *dev_desc,
+				 struct disk_partition *info)
+{
+	int i;
+
+	if (!CONFIG_IS_ENABLED(BLK) || dev_desc != fat_chain_dev ||
+	    info->start != fat_chain_part ||
+	    blk_change_count() != fat_chain_changes) {
+		fat_chain_invalidate();
+		fat_chain_dev = dev_desc;
+		fat_chain_part = info->start;
+		fat_chain_changes = blk_change_count();
+		return;
+	}
+
+	for (i = 0; i < FAT_CHAIN_CACHE_SIZE; i++) {
+		if (!fat_chains[i].size)
+			fat_chain_drop(&fat_chains[i]);
+	}
+}
+
+/*
+ * Get the chain starting at 'start', replacing the oldest one if it is not
+ * known yet. 'dentptr' is the directory entry of a file, NULL for a
+ * directory. Returns NULL if out of memory.
+ */
+static struct fat_chain *fat_chain_find(__u32 start, dir_entry *dentptr)
+{
+	struct fat_chain *chain;
+	__u32 size = 0, stamp = 0;
+	int i;
+
+	if (dentptr) {
+		size = FAT2CPU32(dentptr->size);
+		stamp = FAT2CPU16(dentptr->date) << 16 |
+			FAT2CPU16(dentptr->time);
+	}
+
+	for (i = 0; i < FAT_CHAIN_CACHE_SIZE; i++) {
+		chain = &fat_chains[i];
+		if (chain->start == start && chain->size == size &&
+		    chain->stamp == stamp)
+			return chain;
+	}
+
+	chain = &fat_chains[fat_chain_next_free];
+	fat_chain_next_free = (fat_chain_next_free + 1) % FAT_CHAIN_CACHE_SIZE;
+	fat_chain_drop(chain);
+
+	chain->ext = malloc(16 * sizeof(*chain->ext));
+	if (!chain->ext)
+		return NULL;
+	chain->max = 16;
+	chain->start = start;
+	chain->size = size;
+	chain->stamp = stamp;
+	chain->ext[0].clust = start;
+	chain->ext[0].count = 1;
+	chain->ext[0].index = 0;
+	chain->cnt = 1;
+
+	return chain;
+}
+
+/*
+ * Follow a chain for one more cluster.
+ * Return 0 on success, -1 at the end of the chain or on error.
+ */
+static int fat_chain_extend(fsdata *mydata, struct fat_chain *chain)
+{
+	struct fat_extent *ext;
+	__u32 next, index;
+
+	if (chain->done)
+		return -1;
+
+	ext = &chain->ext[chain->cnt - 1];
+	next = get_fatent(mydata, ext->clust + ext->count - 1);
+	if (CHECK_CLUST(next, mydata->fatsize)) {
+		chain->done = true;
+		return -1;
+	}
+	if (next == ext->clust + ext->count) {
+		ext->count++;
+		return 0;
+	}
+
+	index = ext->index + ext->count;
+	if (chain->cnt == chain->max) {
+		ext = realloc(chain->ext, 2 * chain->max * sizeof(*ext));
+		if (!ext)
+			return -1;
+		chain->ext = ext;
+		chain->max *= 2;
+	}
+	ext = &chain->ext[chain->cnt++];
+	ext->clust = next;
+	ext->count = 1;
+	ext->index = index;
+
+	return 0;
+}
+
+/**
+ * fat_chain_get() - find a cluster in the cluster chain of a file
+ *
+ * @mydata:	filesystem description
+ * @dentptr:	directory entry of the file
+ * @index:	position of the wanted cluster in the chain
+ * @last:	position of the last cluster needed by the caller
+ * @clustp:	returns the cluster at @index
+ * Return:	number of consecutive clusters from *@clustp on, at most
+ *		@last - @index + 1, or 0 if the chain is too short
+ */
+static __u32 fat_chain_get(fsdata *mydata, dir_entry *dentptr, __u32 index,
+			   __u32 last, __u32 *clustp)
+{
+	struct fat_chain *chain;
+	struct fat_extent *ext;
+	__u32 lo, hi, mid, cnt;
+
+	chain = fat_chain_find(START(dentptr), dentptr);
+	if (!chain)
+		return 0;
+
+	/* Walk until the run holding the cluster is complete or long enough */
+	for (;;) {
+		ext = &chain->ext[chain->cnt - 1];
+		if (ext->index + ext->count > last || ext->index > index)
+			break;
+		if (fat_chain_extend(mydata, chain))
+			break;
+	}
+
+	lo = 0;
+	hi = chain->cnt;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (chain->ext[mid].index <= index)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	ext = &chain->ext[lo - 1];
+	if (ext->index + ext->count <= index)
+		return 0;
+
+	*clustp = ext->clust + index - ext->index;
+	cnt = ext->index + ext->count - index;
+
+	return min(cnt, last - index + 1);
+}
+
+/*
+ * Get the cluster following 'clust' in the directory starting at 'start'.
+ * Like get_fatent(), a value failing CHECK_CLUST() marks the end.
+ */
+static __u32 fat_chain_next(fsdata *mydata, __u32 start, __u32 clust)
+{
+	struct fat_chain *chain;
+	struct fat_extent *ext;
+	__u32 i, n;
+
+	chain = fat_chain_find(start, NULL);
+	if (!chain)
+		return get_fatent(mydata, clust);
+
+	/* Start with the extent used last, iterating mostly stays there */
+	for (n = 0; n < chain->cnt; n++) {
+		i = (chain->hint + n) % chain->cnt;
+		ext = &chain->ext[i];
+		if (clust >= ext->clust && clust < ext->clust + ext->count)
+			goto found;
+	}
+	/* Not followed that far yet */
+	while (!fat_chain_extend(mydata, chain)) {
+		i = chain->cnt - 1;
+		ext = &chain->ext[i];
+		if (clust >= ext->clust && clust < ext->clust + ext->count)
+			goto found;
+	}
+	/* Not part of the chain, or out of memory */
+	return get_fatent(mydata, clust);
+
+found:
+	chain->hint = i;
+	if (clust + 1 == ext->clust + ext->count && i + 1 == chain->cnt &&
+	    fat_chain_extend(mydata, chain))
+		return chain->done ? ~0 : get_fatent(mydata, clust);
+
+	ext = &chain->ext[i];
+	if (clust + 1 < ext->clust + ext->count)
+		return clust + 1;
+
+	return chain->ext[i + 1].clust;
+}
+
 /*
  * Read at most 'size' bytes from the specified cluster into 'buffer'.
  * Return 0 on success, -1 otherwise.
@@ -324,8 +601,7 @@ static int get_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos,
 {
 	loff_t filesize = FAT2CPU32(dentptr->size);
 	unsigned int bytesperclust = mydata->clust_size * mydata->sect_size;
-	__u32 curclust = START(dentptr);
-	__u32 endclust, newclust;
+	__u32 index, last, skip, clust, run;
 	loff_t actsize;
 
 	*gotsize = 0;
@@ -341,101 +617,62 @@ static int get_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos,
 
 	debug("%llu bytes\n", filesize);
 
-	actsize = bytesperclust;
+	/* The file size is 32-bit, so are all positions in the file */
+	index = (__u32)pos / bytesperclust;
+	skip = (__u32)pos % bytesperclust;
+	last = ((__u32)filesize - 1) / bytesperclust;
+	filesize -= pos;
 
-	/* go to cluster at pos */
-	while (actsize <= pos) {
-		curclust = get_fatent(mydata, curclust);
-		if (CHECK_CLUST(curclust, mydata->fatsize)) {
-			debug("curclust: 0x%x\n", curclust);
+	/* align to beginning of next cluster if any */
+	if (skip) {
+		__u8 *tmp_buffer;
+
+		if (!fat_chain_get(mydata, dentptr, index, last, &clust)) {
 			printf("Invalid FAT entry\n");
 			return -1;
 		}
-		actsize += bytesperclust;
-	}
 
-	/* actsize > pos */
-	actsize -= bytesperclust;
-	filesize -= actsize;
-	pos -= actsize;
-
-	/* align to beginning of next cluster if any */
-	if (pos) {
-		__u8 *tmp_buffer;
-
-		actsize = min(filesize, (loff_t)bytesperclust);
+		actsize = min(filesize + skip, (loff_t)bytesperclust);
 		tmp_buffer = malloc_cache_aligned(actsize);
 		if (!tmp_buffer) {
 			debug("Error: allocating buffer\n");
 			return -1;
 		}
 
-		if (get_cluster(mydata, curclust, tmp_buffer, actsize) != 0) {
+		if (get_cluster(mydata, clust, tmp_buffer, actsize) != 0) {
 			printf("Error reading cluster\n");
 			free(tmp_buffer);
 			return -1;
 		}
-		filesize -= actsize;
-		actsize -= pos;
-		memcpy(buffer, tmp_buffer + pos, actsize);
+		actsize -= skip;
+		memcpy(buffer, tmp_buffer + skip, actsize);
 		free(tmp_buffer);
 		*gotsize += actsize;
-		if (!filesize)
-			return 0;
+		filesize -= actsize;
 		buffer += actsize;
+		index++;
+	}
 
-		curclust = get_fatent(mydata, curclust);
-		if (CHECK_CLUST(curclust, mydata->fatsize)) {
-			debug("curclust: 0x%x\n", curclust);
+	/* Read each run of consecutive clusters in one go */
+	while (filesize) {
+		run = fat_chain_get(mydata, dentptr, index, last, &clust);
+		if (!run) {
 			printf("Invalid FAT entry\n");
 			return -1;
 		}
-	}
-
-	actsize = bytesperclust;
-	endclust = curclust;
-
-	do {
-		/* search for consecutive clusters */
-		while (actsize < filesize) {
-			newclust = get_fatent(mydata, endclust);
-			if ((newclust - 1) != endclust)
-				goto getit;
-			if (CHECK_CLUST(newclust, mydata->fatsize)) {
-				debug("curclust: 0x%x\n", newclust);
-				printf("Invalid FAT entry\n");
-				return -1;
-			}
-			endclust = newclust;
-			actsize += bytesperclust;
-		}
 
-		/* get remaining bytes */
-		actsize = filesize;
-		if (get_cluster(mydata, curclust, buffer, (int)actsize) != 0) {
+		actsize = min(filesize, (loff_t)run * bytesperclust);
+		if (get_cluster(mydata, clust, buffer, actsize) != 0) {
 			printf("Error reading cluster\n");
 			return -1;
 		}
 		*gotsize += actsize;
-		return 0;
-getit:
-		if (get_cluster(mydata, curclust, buffer, (int)actsize) != 0) {
-			printf("Error reading cluster\n");
-			return -1;
-		}
-		*gotsize += (int)actsize;
 		filesize -= actsize;
 		buffer += actsize;
+		index += run;
+	}
 
-		curclust = get_fatent(mydata, endclust);
-		if (CHECK_CLUST(curclust, mydata->fatsize)) {
-			debug("curclust: 0x%x\n", curclust);
-			printf("Invalid FAT entry\n");
-			return -1;
-		}
-		actsize = bytesperclust;
-		endclust = curclust;
-	} while (1);
+	return 0;
 }
 
 /*
@@ -862,7 +1099,8 @@ void *fat_next_cluster(fat_itr *itr, unsigned int *nbytes)
 			itr->last_cluster = 1;
 		}
 	} else {
-		itr->next_clust = get_fatent(itr->fsdata, itr->next_clust);
+		itr->next_clust = fat_chain_next(itr->fsdata, itr->start_clust,
+						 itr->next_clust);
 		if (CHECK_CLUST(itr->next_clust, itr->fsdata->fatsize)) {
 			debug("nextclust: 0x%x\n", itr->next_clust);
 			itr->last_cluster = 1;
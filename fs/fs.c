@@ -516,10 +516,14 @@ static int fs_read_lmb_check(const char *filename, ulong addr, loff_t offset,
 	lmb_dump_all(&lmb);
 
 	if (lmb_alloc_addr(&lmb, addr, read_len) == addr)
-		return 0;
+		ret = 0;
+	else
+		ret = -ENOSPC;
+	lmb_uninit(&lmb);
+	if (ret)
+		log_err("** Reading file would overwrite reserved memory **\n");
 
-	log_err("** Reading file would overwrite reserved memory **\n");
-	return -ENOSPC;
+	return ret;
 }
 #endif
 
@@ -142,6 +142,29 @@ int blkcache_read(int iftype, int dev,
 		  lbaint_t start, lbaint_t blkcnt,
 		  unsigned long blksz, void *buffer);
 
+/**
+ * blkcache_readahead() - widen a read which is part of a sequential stream
+ *
+ * This is called after a cache miss. If the reads of the device look like a
+ * stream, it returns a buffer which the caller should read more blocks into
+ * and then pass to blkcache_fill(). The readahead window grows with every
+ * read which continues the stream.
+ *
+ * @param iftype - IF_TYPE_x for type of device
+ * @param dev - device index of particular type
+ * @param start - starting block number
+ * @param blkcnt - number of blocks requested
+ * @param blksz - size in bytes of each block
+ * @param avail - number of blocks on the device from @start onwards
+ * @param cntp - returns the number of blocks to read into the buffer
+ *
+ * Return: - buffer for @cntp blocks, or NULL to read just @blkcnt blocks
+ */
+void *blkcache_readahead(int iftype, int dev,
+			 lbaint_t start, lbaint_t blkcnt,
+			 unsigned long blksz, lbaint_t avail,
+			 lbaint_t *cntp);
+
 /**
  * blkcache_fill() - make data read from a block device available
  * to the block cache
@@ -170,6 +193,9 @@ void blkcache_invalidate(int iftype, int dev);
 /**
  * blkcache_configure() - configure block cache
  *
+ * Reads of up to a quarter of the cache are kept, split into entries of
+ * @blocks aligned blocks each.
+ *
  * @param blocks - maximum blocks per entry
  * @param entries - maximum entries in cache
  */
@@ -184,6 +210,8 @@ struct block_cache_stats {
 	unsigned entries; /* current entry count */
 	unsigned max_blocks_per_entry;
 	unsigned max_entries;
+	unsigned readaheads; /* reads widened by readahead */
+	unsigned ra_blocks; /* blocks read ahead */
 };
 
 /**
@@ -202,6 +230,14 @@ static inline int blkcache_read(int iftype, int dev,
 	return 0;
 }
 
+static inline void *blkcache_readahead(int iftype, int dev,
+				       lbaint_t start, lbaint_t blkcnt,
+				       unsigned long blksz, lbaint_t avail,
+				       lbaint_t *cntp)
+{
+	return NULL;
+}
+
 static inline void blkcache_fill(int iftype, int dev,
 				 lbaint_t start, lbaint_t blkcnt,
 				 unsigned long blksz, void const *buffer) {}
@@ -213,6 +249,29 @@ static inline void blkcache_invalidate(int iftype, int dev) {}
 #if CONFIG_IS_ENABLED(BLK)
 struct udevice;
 
+/**
+ * struct blk_req - an asynchronous read or write request
+ *
+ * The caller fills in the first four fields and then passes the request to
+ * blk_submit(). It must keep the request and the buffer until the request
+ * has completed, as reported by blk_poll() or blk_wait().
+ *
+ * @start:	Start block number (0=first)
+ * @blkcnt:	Number of blocks
+ * @buffer:	Destination buffer for a read, source buffer for a write
+ * @write:	true to write, false to read
+ * @result:	Number of blocks transferred, or -ve error number, once done
+ * @done:	true once the request has completed
+ */
+struct blk_req {
+	lbaint_t start;
+	lbaint_t blkcnt;
+	void *buffer;
+	bool write;
+	long result;
+	bool done;
+};
+
 /* Operations on block devices */
 struct blk_ops {
 	/**
@@ -271,6 +330,32 @@ struct blk_ops {
 	 * @return 0 if OK, -ve on error
 	 */
 	int (*select_hwpart)(struct udevice *dev, int hwpart);
+
+	/**
+	 * submit() - start a read or write without waiting for it
+	 *
+	 * This is optional. Devices which do not provide it complete each
+	 * request in blk_submit(), using read() or write().
+	 *
+	 * @dev:	Device to access
+	 * @req:	Request to start
+	 * @return 0 if started, -EBUSY if the device cannot take another
+	 * request until an earlier one completes, other -ve on error
+	 */
+	int (*submit)(struct udevice *dev, struct blk_req *req);
+
+	/**
+	 * poll() - check whether a submitted request has completed
+	 *
+	 * This is required if submit() is provided. When the request has
+	 * completed, this sets @req->result.
+	 *
+	 * @dev:	Device the request was submitted to
+	 * @req:	Request to check
+	 * @return 0 if completed, -EAGAIN if still in progress, other -ve if
+	 * the request failed
+	 */
+	int (*poll)(struct udevice *dev, struct blk_req *req);
 };
 
 #define blk_get_ops(dev)	((struct blk_ops *)(dev)->driver->ops)
@@ -288,6 +373,62 @@ unsigned long blk_dwrite(struct blk_desc *block_dev, lbaint_t start,
 unsigned long blk_derase(struct blk_desc *block_dev, lbaint_t start,
 			 lbaint_t blkcnt);
 
+/**
+ * blk_submit() - start an asynchronous read or write
+ *
+ * The request runs while the caller does something else, such as hashing or
+ * decompressing the data of an earlier request. On devices without
+ * asynchronous support the request has already completed when this returns.
+ *
+ * @block_dev:	Block device to access
+ * @req:	Request to start, see struct blk_req
+ * Return: 0 if started, -EBUSY if the device cannot take another request
+ * until an earlier one completes, other -ve on error
+ */
+int blk_submit(struct blk_desc *block_dev, struct blk_req *req);
+
+/**
+ * blk_poll() - check whether an asynchronous request has completed
+ *
+ * @block_dev:	Block device the request was submitted to
+ * @req:	Request to check
+ * Return: 0 if completed, in which case @req->result holds the outcome, or
+ * -EAGAIN if still in progress
+ */
+int blk_poll(struct blk_desc *block_dev, struct blk_req *req);
+
+/**
+ * blk_changed() - note that the data on a block device may have changed
+ *
+ * This drops the cached blocks of the device and bumps the count returned
+ * by blk_change_count(). It is called for writes and erases, when a device
+ * is removed and when the medium or hardware partition behind a device may
+ * have been replaced.
+ *
+ * @block_dev:	Block device which changed
+ */
+void blk_changed(struct blk_desc *block_dev);
+
+/**
+ * blk_change_count() - get the number of changes to any block device
+ *
+ * Code which keeps its own view of the data on a device across operations,
+ * like the FAT cluster chains, can compare this with an earlier value to
+ * tell that the view may be stale.
+ *
+ * Return: number of calls to blk_changed() so far
+ */
+unsigned long blk_change_count(void);
+
+/**
+ * blk_wait() - wait for an asynchronous request to complete
+ *
+ * @block_dev:	Block device the request was submitted to
+ * @req:	Request to wait for
+ * Return: number of blocks transferred, or -ve error number
+ */
+long blk_wait(struct blk_desc *block_dev, struct blk_req *req);
+
 /**
  * blk_find_device() - Find a block device
  *
@@ -471,6 +612,17 @@ static inline ulong blk_dread(struct blk_desc *block_dev, lbaint_t start,
 	return blks_read;
 }
 
+static inline void blk_changed(struct blk_desc *block_dev)
+{
+	blkcache_invalidate(block_dev->if_type, block_dev->devnum);
+}
+
+/* Changes are not counted without driver model */
+static inline unsigned long blk_change_count(void)
+{
+	return 0;
+}
+
 static inline ulong blk_dwrite(struct blk_desc *block_dev, lbaint_t start,
 			       lbaint_t blkcnt, const void *buffer)
 {
@@ -149,6 +149,11 @@ struct dfu_entity {
 	u64 r_left;
 	long b_left;
 
+	/* other buffer, written or read ahead by dfu_pending_io() */
+	u8 *p_buf;
+	long p_len;
+	int p_err;
+
 	u32 bad_skip;	/* for nand use */
 
 	unsigned int inited:1;
@@ -356,6 +361,20 @@ int dfu_write(struct dfu_entity *de, void *buf, int size, int blk_seq_num);
  */
 int dfu_flush(struct dfu_entity *de, void *buf, int size, int blk_seq_num);
 
+/**
+ * dfu_pending_io() - write or read a buffer in the background
+ *
+ * With CONFIG_DFU_DOUBLE_BUFFER, dfu_write() hands a full buffer over and
+ * goes on in a second buffer, and dfu_read() asks for the next part of the
+ * medium to be read into the second buffer. This does that I/O. It should be
+ * called between calls to usb_gadget_handle_interrupts(), so that the I/O is
+ * done outside of USB request completion. Errors of a write are also
+ * returned by the next dfu_write() or dfu_flush().
+ *
+ * Return:		0 for success, -ve on error writing
+ */
+int dfu_pending_io(void);
+
 /**
  * dfu_initiated_callback() - weak callback called on DFU transaction start
  *
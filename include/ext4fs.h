@@ -119,10 +119,39 @@ struct ext_filesystem {
 	struct blk_desc *dev_desc;
 };
 
-struct ext_block_cache {
+/* Number of extent tree blocks kept by struct ext_block_cache */
+#define EXT_CACHE_BLOCKS	8
+
+/**
+ * struct ext_cache_block - one block held by struct ext_block_cache
+ *
+ * @buf:	Block contents, NULL if this entry is unused
+ * @block:	Device sector the block was read from
+ * @size:	Size of the block in bytes
+ * @used:	Value of the cache's clock when the block was last looked up
+ */
+struct ext_cache_block {
 	char *buf;
 	lbaint_t block;
 	int size;
+	uint used;
+};
+
+/**
+ * struct ext_block_cache - the most recently used extent tree blocks
+ *
+ * Looking up a file block walks the extent tree from the inode to a leaf.
+ * Keeping a few blocks means that consecutive lookups only read the nodes
+ * that differ, rather than every level below the inode.
+ *
+ * @buf:	Contents of the block returned by the last ext_cache_read()
+ * @blocks:	Cached blocks
+ * @clock:	Incremented on each lookup, to find the least recently used
+ */
+struct ext_block_cache {
+	char *buf;
+	struct ext_cache_block blocks[EXT_CACHE_BLOCKS];
+	uint clock;
 };
 
 extern struct ext2_data *ext4fs_root;
@@ -157,6 +186,8 @@ int ext4fs_devread(lbaint_t sector, int byte_offset, int byte_len, char *buf);
 void ext4fs_set_blk_dev(struct blk_desc *rbdd, struct disk_partition *info);
 long int read_allocated_block(struct ext2_inode *inode, int fileblock,
 			      struct ext_block_cache *cache);
+long int read_allocated_run(struct ext2_inode *inode, int fileblock,
+			    int maxblocks, int *countp);
 int ext4fs_probe(struct blk_desc *fs_dev_desc,
 		 struct disk_partition *fs_partition);
 int ext4_read_file(const char *filename, void *buf, loff_t offset, loff_t len,
@@ -32,6 +32,41 @@ int fastboot_mmc_get_part_info(const char *part_name,
  */
 void fastboot_mmc_flash_write(const char *cmd, void *download_buffer,
 			      u32 download_bytes, char *response);
+
+/**
+ * fastboot_mmc_stream_start() - Start writing an image while it downloads
+ *
+ * @cmd: Named partition to write the image to
+ * @response: Pointer to fastboot response buffer
+ * Return: 0 if OK, -ve on error
+ */
+int fastboot_mmc_stream_start(const char *cmd, char *response);
+
+/**
+ * fastboot_mmc_stream_write() - Write the next piece of a streamed image
+ *
+ * The image may be raw or sparse, which is seen from its first piece. For a
+ * raw image, all pieces but the last must be a multiple of the block size.
+ *
+ * @buffer: Next bytes of the image
+ * @len: Number of bytes
+ * @image_size: Size of the whole image
+ * @response: Pointer to fastboot response buffer
+ * Return: 0 if OK, -ve on error
+ */
+int fastboot_mmc_stream_write(const void *buffer, u32 len, u32 image_size,
+			      char *response);
+
+/**
+ * fastboot_mmc_stream_finish() - Finish writing a streamed image
+ *
+ * This must be called after fastboot_mmc_stream_start(), also on errors.
+ *
+ * @response: Pointer to fastboot response buffer
+ * Return: 0 if the whole image was written, -ve on error
+ */
+int fastboot_mmc_stream_finish(char *response);
+
 /**
  * fastboot_mmc_flash_erase() - Erase eMMC for fastboot
  *
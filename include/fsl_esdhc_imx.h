@@ -106,6 +106,9 @@
 #define PROCTL_DTW_4		0x00000002
 #define PROCTL_DTW_8		0x00000004
 #define PROCTL_D3CD		0x00000008
+#define PROCTL_DMAS_MASK	0x00000300
+#define PROCTL_DMAS_SDMA	0x00000000
+#define PROCTL_DMAS_ADMA2	0x00000200
 
 #define CMDARG			0x0002e008
 
@@ -209,6 +212,12 @@
 #define ESDHC_TUNING_STEP_MASK		0x00070000
 #define ESDHC_TUNING_STEP_SHIFT		16
 
+/* Fields of clktunectrlstatus */
+#define ESDHC_TUNE_CTRL_TAP_SEL_PRE_MASK	0x7f000000
+#define ESDHC_TUNE_CTRL_TAP_SEL_PRE_SHIFT	24
+#define ESDHC_TUNE_CTRL_DLY_CELL_SET_PRE_MASK	0x00007f00
+#define ESDHC_TUNE_CTRL_DLY_CELL_SET_PRE_SHIFT	8
+
 #define	ESDHC_FLAG_MULTIBLK_NO_INT	BIT(1)
 #define	ESDHC_FLAG_ENGCM07207		BIT(2)
 #define	ESDHC_FLAG_USDHC		BIT(3)
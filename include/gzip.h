@@ -8,6 +8,7 @@
 #define __GZIP_H
 
 struct blk_desc;
+struct image_reader;
 
 /**
  * gzip_parse_header() - Parse a header from a gzip file
@@ -31,6 +32,21 @@ int gzip_parse_header(const unsigned char *src, unsigned long len);
  */
 int gunzip(void *dst, int dstlen, unsigned char *src, unsigned long *lenp);
 
+/**
+ * gunzip_stream() - Decompress gzipped data while reading it from storage
+ *
+ * The compressed data is read from @rd in IMAGE_STREAM_CHUNK_SIZE pieces,
+ * each of which is inflated before the next one is read.
+ *
+ * @dst: Destination for uncompressed data
+ * @dstlen: Size of destination buffer
+ * @rd: Reader supplying the gzipped data
+ * @lenp: Returns length of uncompressed data
+ * Return: 0 if OK, -1 on error
+ */
+int gunzip_stream(void *dst, int dstlen, struct image_reader *rd,
+		  unsigned long *lenp);
+
 /**
  * zunzip() - Uncompress blocks compressed with zlib without headers
  *
@@ -163,4 +163,89 @@ int hash_progressive_lookup_algo(const char *algo_name,
  */
 int hash_parse_string(const char *algo_name, const char *str, uint8_t *result);
 
+/**
+ * hash_lookup_algo_index() - Look up a hash algorithm by its position
+ *
+ * This allows iterating over all the algorithms that are built in.
+ *
+ * @index: Index of the algorithm, starting at 0
+ * @algop: Pointer to the hash_algo struct if found
+ *
+ * Return: 0 if ok, -ENOENT if @index is past the last algorithm
+ */
+int hash_lookup_algo_index(int index, struct hash_algo **algop);
+
+#ifndef USE_HOSTCC
+struct udevice;
+
+/**
+ * struct hash_bench_result - Result of timing a hash algorithm
+ *
+ * @bytes:	Number of bytes hashed in total
+ * @time_us:	Time this took, in microseconds
+ */
+struct hash_bench_result {
+	u64 bytes;
+	ulong time_us;
+};
+
+/**
+ * hash_bench() - Measure the throughput of a hash algorithm
+ *
+ * The digest of @buf is computed repeatedly until at least @min_us
+ * microseconds have passed.
+ *
+ * @algo:	Algorithm to time
+ * @buf:	Data to hash
+ * @size:	Number of bytes to hash for each digest
+ * @chunk:	Number of bytes to pass to each hash_update() call, or 0 to
+ *		use the one-shot hash_func_ws() instead
+ * @min_us:	Minimum time to spend, in microseconds
+ * @res:	Returns the result
+ * Return: 0 if ok, -ENOSYS if @chunk is not 0 but @algo does not support
+ * progressive hashing, -EIO if the algorithm failed
+ */
+int hash_bench(struct hash_algo *algo, const void *buf, uint size, uint chunk,
+	       ulong min_us, struct hash_bench_result *res);
+
+/**
+ * hash_bench_dev() - Measure the throughput of a hash device
+ *
+ * This is the same as hash_bench() but for a UCLASS_HASH device.
+ *
+ * @dev:	Hash device to use
+ * @algo_name:	Name of the algorithm to time
+ * @buf:	Data to hash
+ * @size:	Number of bytes to hash for each digest
+ * @chunk:	Number of bytes to pass to each hash_update() call, or 0 to
+ *		use the one-shot hash_digest_wd() instead
+ * @min_us:	Minimum time to spend, in microseconds
+ * @res:	Returns the result
+ * Return: 0 if ok, -EPROTONOSUPPORT if @algo_name is unknown, other -ve
+ * error if @dev does not support the algorithm or failed
+ */
+int hash_bench_dev(struct udevice *dev, const char *algo_name,
+		   const void *buf, uint size, uint chunk, ulong min_us,
+		   struct hash_bench_result *res);
+
+/**
+ * hash_bench_rate() - Get the throughput of a benchmark run
+ *
+ * @res:	Result of the run
+ * Return: throughput in units of 0.1 MB/s (1 MB being 10^6 bytes)
+ */
+ulong hash_bench_rate(const struct hash_bench_result *res);
+
+/**
+ * hash_bench_cpb() - Get the CPU cycles per byte of a benchmark run
+ *
+ * This assumes that the CPU ran at @cpu_hz for the whole run.
+ *
+ * @res:	Result of the run
+ * @cpu_hz:	CPU clock frequency in Hz
+ * Return: cycles per byte in units of 0.01, 0 if @res has no bytes
+ */
+ulong hash_bench_cpb(const struct hash_bench_result *res, ulong cpu_hz);
+#endif /* !USE_HOSTCC */
+
 #endif
@@ -24,6 +24,15 @@ struct sparse_storage {
 				 lbaint_t blk,
 				 lbaint_t blkcnt);
 
+	/*
+	 * Optional: erase blocks, which must then read as zeroes. Only whole
+	 * groups of erase_size blocks, aligned to erase_size, are erased.
+	 */
+	lbaint_t	erase_size;
+	lbaint_t	(*erase)(struct sparse_storage *info,
+				 lbaint_t blk,
+				 lbaint_t blkcnt);
+
 	void		(*mssg)(const char *str, char *response);
 };
 
@@ -40,3 +49,103 @@ static inline int is_sparse_image(void *buf)
 
 int write_sparse_image(struct sparse_storage *info, const char *part_name,
 		       void *data, char *response);
+
+/**
+ * struct sparse_writer - gathers consecutive chunks into large writes
+ *
+ * @info:	Storage the image is written to
+ * @buf:	Blocks waiting to be written
+ * @size:	Size of @buf in bytes, a multiple of the storage block size
+ * @len:	Number of bytes in @buf
+ * @blk:	Storage block which the start of @buf is written to
+ * @fill_val:	Value which the start of @buf is filled with
+ * @fill_len:	Number of bytes at the start of @buf holding @fill_val
+ */
+struct sparse_writer {
+	struct sparse_storage	*info;
+	u8			*buf;
+	size_t			size;
+	size_t			len;
+	lbaint_t		blk;
+	u32			fill_val;
+	size_t			fill_len;
+};
+
+enum sparse_stream_state {
+	SPARSE_STREAM_FILE_HDR,
+	SPARSE_STREAM_CHUNK_HDR,
+	SPARSE_STREAM_RAW,
+	SPARSE_STREAM_FILL,
+	SPARSE_STREAM_DONE,
+};
+
+/**
+ * struct sparse_stream - a sparse image which is written as it arrives
+ *
+ * @info:	Storage the image is written to
+ * @state:	What the next bytes of the image are
+ * @header:	Header of the image
+ * @chunk_hdr:	Header of the current chunk
+ * @chunk:	Number of chunks started
+ * @buf:	Gathers a header or fill value which may arrive in pieces
+ * @buf_len:	Number of bytes in @buf
+ * @want:	Number of bytes needed in @buf
+ * @skip:	Number of bytes to skip before going on
+ * @data_left:	Bytes of RAW data left in the current chunk
+ * @blkcnt:	Number of storage blocks the current chunk covers
+ * @w:		Writes the chunks to storage
+ * @total_blocks: Number of sparse blocks in the chunks so far
+ * @bytes_written: Number of bytes written to storage
+ */
+struct sparse_stream {
+	struct sparse_storage	*info;
+	enum sparse_stream_state state;
+	sparse_header_t		header;
+	chunk_header_t		chunk_hdr;
+	unsigned int		chunk;
+	u8			buf[sizeof(sparse_header_t)];
+	unsigned int		buf_len;
+	unsigned int		want;
+	u64			skip;
+	u64			data_left;
+	lbaint_t		blkcnt;
+	struct sparse_writer	w;
+	u32			total_blocks;
+	u64			bytes_written;
+};
+
+/**
+ * sparse_stream_init() - start writing a sparse image in pieces
+ *
+ * @ss: Stream to set up
+ * @info: Storage to write the image to
+ * Return: 0 if OK, -ENOMEM if out of memory
+ */
+int sparse_stream_init(struct sparse_stream *ss, struct sparse_storage *info);
+
+/**
+ * sparse_stream_write() - write the next piece of a sparse image
+ *
+ * The image can be split anywhere. Anything after the last chunk is ignored.
+ *
+ * @ss: Stream to write to
+ * @data: Next bytes of the image
+ * @len: Number of bytes
+ * @response: Pointer to fastboot response buffer
+ * Return: 0 if OK, -1 on error, after which the stream must be finished
+ */
+int sparse_stream_write(struct sparse_stream *ss, const void *data,
+			size_t len, char *response);
+
+/**
+ * sparse_stream_finish() - finish writing a sparse image in pieces
+ *
+ * This must be called for every stream which was set up, also on errors.
+ *
+ * @ss: Stream to finish
+ * @part_name: Name of the partition, for messages
+ * @response: Pointer to fastboot response buffer
+ * Return: 0 if the whole image was written, -1 if not
+ */
+int sparse_stream_finish(struct sparse_stream *ss, const char *part_name,
+			 char *response);
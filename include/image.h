@@ -851,6 +851,133 @@ int image_decomp(int comp, ulong load, ulong image_start, int type,
 		 void *load_buf, void *image_buf, ulong image_len,
 		 uint unc_len, ulong *load_end);
 
+#ifndef USE_HOSTCC
+struct blk_desc;
+
+/* Size of the chunks streaming decompressors read their input in */
+#ifdef CONFIG_IMAGE_DECOMP_STREAM_CHUNK_SIZE
+#define IMAGE_STREAM_CHUNK_SIZE	CONFIG_IMAGE_DECOMP_STREAM_CHUNK_SIZE
+#else
+#define IMAGE_STREAM_CHUNK_SIZE	(256 << 10)
+#endif
+
+/**
+ * struct image_reader - source of image data held on storage
+ *
+ * @read:	Read @len bytes at byte offset @pos of the image into @buf.
+ *		Callers never ask for data beyond @size. Returns the number of
+ *		bytes read, or -ve on error
+ * @size:	Size of the image in bytes
+ * @pos:	Current position, used by image_reader_read()
+ */
+struct image_reader {
+	long (*read)(struct image_reader *rd, ulong pos, void *buf, ulong len);
+	ulong size;
+	ulong pos;
+};
+
+/**
+ * struct image_blk_reader - image reader for raw data on a block device
+ *
+ * @rd:		Generic reader
+ * @desc:	Block device to read from
+ * @start:	Block number where the image starts
+ */
+struct image_blk_reader {
+	struct image_reader rd;
+	struct blk_desc *desc;
+	ulong start;
+};
+
+/**
+ * struct image_fs_reader - image reader for a file on a filesystem
+ *
+ * @rd:		Generic reader
+ * @ifname:	Interface name of the block device (e.g. "mmc")
+ * @dev_part:	Device and partition string (e.g. "0:1")
+ * @filename:	Path of the file to read
+ */
+struct image_fs_reader {
+	struct image_reader rd;
+	const char *ifname;
+	const char *dev_part;
+	const char *filename;
+};
+
+/**
+ * image_reader_pread() - read image data at a given offset
+ *
+ * @rd:		Reader to use
+ * @pos:	Byte offset in the image
+ * @buf:	Buffer to read into
+ * @len:	Number of bytes to read
+ * Return: number of bytes read, which is less than @len only at the end of
+ *	the image, or -ve on error
+ */
+long image_reader_pread(struct image_reader *rd, ulong pos, void *buf,
+			ulong len);
+
+/**
+ * image_reader_read() - read image data at the current position
+ *
+ * This works like image_reader_pread() but reads from, and then advances,
+ * @rd->pos.
+ *
+ * @rd:		Reader to use
+ * @buf:	Buffer to read into
+ * @len:	Number of bytes to read
+ * Return: number of bytes read, 0 at the end of the image, -ve on error
+ */
+long image_reader_read(struct image_reader *rd, void *buf, ulong len);
+
+/**
+ * image_blk_reader_init() - set up a reader for raw data on a block device
+ *
+ * @brd:	Reader to set up
+ * @desc:	Block device to read from
+ * @start:	Block number where the image starts
+ * @size:	Size of the image in bytes
+ */
+void image_blk_reader_init(struct image_blk_reader *brd,
+			   struct blk_desc *desc, ulong start, ulong size);
+
+/**
+ * image_fs_reader_init() - set up a reader for a file on a filesystem
+ *
+ * The strings are used for every read, so must stay valid as long as the
+ * reader is in use.
+ *
+ * @frd:	Reader to set up
+ * @ifname:	Interface name of the block device (e.g. "mmc")
+ * @dev_part:	Device and partition string (e.g. "0:1")
+ * @filename:	Path of the file to read
+ * Return: 0 if OK, -ENODEV if the filesystem cannot be accessed, -ENOENT if
+ *	the file does not exist
+ */
+int image_fs_reader_init(struct image_fs_reader *frd, const char *ifname,
+			 const char *dev_part, const char *filename);
+
+/**
+ * image_decomp_stream() - decompress an image while reading it from storage
+ *
+ * The compressed data is pulled from @rd in IMAGE_STREAM_CHUNK_SIZE pieces
+ * and decompressed as it arrives, so the compressed image never has to be
+ * in memory as a whole. gzip, lz4, lzma and zstd are supported, as well as
+ * uncompressed images, which are read straight to @load_buf.
+ *
+ * @comp:	Compression algorithm that is used (IH_COMP_...)
+ * @load:	Destination load address in U-Boot memory
+ * @load_buf:	Place to decompress to
+ * @rd:		Reader supplying the compressed image
+ * @unc_len:	Available space for decompression
+ * @load_end:	Returns the end address of the decompressed data
+ * Return: 0 if OK, -ENOSYS if @comp cannot be streamed, other -ve on error
+ */
+int image_decomp_stream(int comp, ulong load, void *load_buf,
+			struct image_reader *rd, ulong unc_len,
+			ulong *load_end);
+#endif
+
 /**
  * Set up properties in the FDT
  *
@@ -1014,6 +1141,7 @@ int fit_image_get_data_and_size(const void *fit, int noffset,
 int fit_image_hash_get_algo(const void *fit, int noffset, const char **algo);
 int fit_image_hash_get_value(const void *fit, int noffset, uint8_t **value,
 				int *value_len);
+int fit_image_hash_get_ignore(const void *fit, int noffset, int *ignore);
 
 int fit_set_timestamp(void *fit, int noffset, time_t timestamp);
 
@@ -1149,6 +1277,26 @@ int fit_conf_get_prop_node_index(const void *fit, int noffset,
 int fit_conf_get_prop_node(const void *fit, int noffset,
 		const char *prop_name);
 
+#ifndef USE_HOSTCC
+/**
+ * fit_blk_load() - Load a FIT with external data from a block device
+ * @desc:	Block device holding the FIT
+ * @start:	Block number where the FIT starts on @desc
+ * @addr:	Address to place the FIT structure at
+ * @conf_name:	Configuration to load images for (NULL to use default)
+ *
+ * Only the FIT structure and the sub-images used by @conf_name are read.
+ * Uncompressed sub-images with a load address above @addr are read straight
+ * to that address, the others are staged behind the FIT structure. The
+ * data-position properties are updated to match, so the result can be
+ * passed to bootm without any further copy of the data.
+ *
+ * Return: 0 if OK, -ve on error
+ */
+int fit_blk_load(struct blk_desc *desc, ulong start, ulong addr,
+		 const char *conf_name);
+#endif
+
 int fit_check_ramdisk(const void *fit, int os_noffset,
 		uint8_t arch, int verify);
 
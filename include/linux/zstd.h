@@ -1155,4 +1155,18 @@ struct abuf;
  */
 int zstd_decompress(struct abuf *in, struct abuf *out);
 
+struct image_reader;
+
+/**
+ * zstd_decompress_stream() - Decompress Zstandard data read from storage
+ *
+ * The compressed data is read from @rd in IMAGE_STREAM_CHUNK_SIZE pieces,
+ * each of which is decompressed before the next one is read.
+ *
+ * @rd: Reader supplying the data to decompress
+ * @out: Output buffer to hold the results (must be large enough)
+ * Return: size of the decompressed data, or -ve on error
+ */
+int zstd_decompress_stream(struct image_reader *rd, struct abuf *out);
+
 #endif  /* ZSTD_H */
@@ -74,6 +74,8 @@ struct bd_info;
 #define MMC_CAP_NONREMOVABLE	BIT(14)
 #define MMC_CAP_NEEDS_POLL	BIT(15)
 #define MMC_CAP_CD_ACTIVE_HIGH  BIT(16)
+/* Host can precede multi-block transfers with CMD23, no auto CMD12 */
+#define MMC_CAP_CMD23		BIT(17)
 
 #define MMC_MODE_8BIT		BIT(30)
 #define MMC_MODE_4BIT		BIT(29)
@@ -82,6 +84,8 @@ struct bd_info;
 
 
 #define SD_DATA_4BIT	0x00040000
+#define SD_SCR_CMD23_SUPPORT	0x00000002
+#define SD_DATA_STAT_AFTER_ERASE	0x00800000
 
 #define IS_SD(x)	((x)->version & SD_VERSION_SD)
 #define IS_MMC(x)	((x)->version & MMC_VERSION_MMC)
@@ -231,6 +235,7 @@ static inline bool mmc_is_tuning_cmd(uint cmdidx)
 #define EXT_CSD_ERASE_GROUP_DEF		175	/* R/W */
 #define EXT_CSD_BOOT_BUS_WIDTH		177
 #define EXT_CSD_PART_CONF		179	/* R/W */
+#define EXT_CSD_ERASED_MEM_CONT		181	/* RO */
 #define EXT_CSD_BUS_WIDTH		183	/* R/W */
 #define EXT_CSD_STROBE_SUPPORT		184	/* R/W */
 #define EXT_CSD_HS_TIMING		185	/* R/W */
@@ -489,6 +494,27 @@ struct dm_mmc_ops {
 	 * @return 0 if OK, -ve on error
 	 */
 	int (*execute_tuning)(struct udevice *dev, uint opcode);
+
+	/**
+	 * get_tuning() - Read the result of the last tuning
+	 *
+	 * This is optional. It is used to pass the tuning from SPL to U-Boot
+	 * proper, see CONFIG_MMC_HANDOFF.
+	 *
+	 * @dev:	Device to read from
+	 * @tuning:	Returns a host-specific value describing the tuning
+	 * @return 0 if OK, -ve on error
+	 */
+	int (*get_tuning)(struct udevice *dev, u32 *tuning);
+
+	/**
+	 * set_tuning() - Restore a tuning result without tuning again
+	 *
+	 * @dev:	Device to update
+	 * @tuning:	Value from get_tuning()
+	 * @return 0 if OK, -ve on error
+	 */
+	int (*set_tuning)(struct udevice *dev, u32 tuning);
 #endif
 
 	/**
@@ -519,12 +545,12 @@ struct dm_mmc_ops {
 
 	/**
 	 * get_b_max - get maximum length of single transfer
-	 *	       Called before reading blocks from the card,
-	 *	       useful for system which have e.g. DMA limits
-	 *	       on various memory ranges.
+	 *	       Called before reading blocks from or writing
+	 *	       blocks to the card, useful for system which have
+	 *	       e.g. DMA limits on various memory ranges.
 	 *
 	 * @dev:	Device to check
-	 * @dst:	Destination buffer in memory
+	 * @dst:	Buffer in memory
 	 * @blkcnt:	Total number of blocks in this transfer
 	 * @return maximum number of blocks for this transfer
 	 */
@@ -546,6 +572,8 @@ int mmc_set_ios(struct mmc *mmc);
 int mmc_getcd(struct mmc *mmc);
 int mmc_getwp(struct mmc *mmc);
 int mmc_execute_tuning(struct mmc *mmc, uint opcode);
+int mmc_get_tuning(struct mmc *mmc, u32 *tuning);
+int mmc_set_tuning(struct mmc *mmc, u32 tuning);
 int mmc_wait_dat0(struct mmc *mmc, int state, int timeout_us);
 int mmc_set_enhanced_strobe(struct mmc *mmc);
 int mmc_host_power_cycle(struct mmc *mmc);
@@ -565,6 +593,8 @@ struct mmc_ops {
 	int (*get_b_max)(struct mmc *mmc, void *dst, lbaint_t blkcnt);
 };
 
+int mmc_get_b_max(struct mmc *mmc, void *dst, lbaint_t blkcnt);
+
 static inline int mmc_hs400_prepare_ddr(struct mmc *mmc)
 {
 	return 0;
@@ -1006,6 +1036,70 @@ int mmc_send_ext_csd(struct mmc *mmc, u8 *ext_csd);
  */
 int mmc_boot_wp(struct mmc *mmc);
 
+/**
+ * struct mmc_handoff - MMC card state passed from SPL to U-Boot proper
+ *
+ * This is stored in the bloblist with tag BLOBLISTT_U_BOOT_MMC_HANDOFF by
+ * SPL, once it has loaded U-Boot from the card. U-Boot proper then carries
+ * on with the card in the same state, rather than resetting and identifying
+ * it and selecting and tuning the bus mode again. See CONFIG_MMC_HANDOFF.
+ *
+ * @base:	Register address of the host controller, 0 if not valid
+ * @version:	Card version, SD_VERSION_... or MMC_VERSION_...
+ * @high_capacity: 1 if the card is block-addressed
+ * @ocr:	Operating conditions register
+ * @rca:	Relative card address
+ * @cid:	Card identification register
+ * @csd:	Card-specific data register
+ * @scr:	SD configuration register
+ * @card_caps:	Modes and widths supported by both the card and the host
+ * @cardtype:	Device type from the EXT_CSD
+ * @selected_mode: Bus mode in use, enum bus_mode
+ * @best_mode:	Best bus mode of the card, enum bus_mode
+ * @legacy_speed: Clock rate of the legacy mode
+ * @bus_width:	Bus width in use
+ * @clock:	Clock rate in use
+ * @signal_voltage: Signalling voltage in use, enum mmc_voltage
+ * @tuning:	Host-specific tuning result, see get_tuning() in
+ *		struct dm_mmc_ops
+ * @read_bl_len: Read block length
+ * @capacity_user: Size of the user area in bytes
+ * @ext_csd:	Extended CSD register, for MMC version 4 and later
+ */
+struct mmc_handoff {
+	u64 base;
+	u32 version;
+	u32 high_capacity;
+	u32 ocr;
+	u32 rca;
+	u32 cid[4];
+	u32 csd[4];
+	u32 scr[2];
+	u32 card_caps;
+	u32 cardtype;
+	u32 selected_mode;
+	u32 best_mode;
+	u32 legacy_speed;
+	u32 bus_width;
+	u32 clock;
+	u32 signal_voltage;
+	u32 tuning;
+	u32 read_bl_len;
+	u64 capacity_user;
+	u8 ext_csd[MMC_MAX_BLOCK_LEN];
+};
+
+/**
+ * mmc_save_handoff() - Save the card state for U-Boot proper
+ *
+ * This is called by SPL once it has finished with the card. It does nothing
+ * unless CONFIG_MMC_HANDOFF is enabled.
+ *
+ * @mmc:	MMC device, which must be initialised
+ * Return: 0 if OK, -ve on error
+ */
+int mmc_save_handoff(struct mmc *mmc);
+
 static inline enum dma_data_direction mmc_get_dma_dir(struct mmc_data *data)
 {
 	return data->flags & MMC_DATA_WRITE ? DMA_TO_DEVICE : DMA_FROM_DEVICE;
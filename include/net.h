@@ -45,7 +45,7 @@ struct udevice;
 #define PKTALIGN	ARCH_DMA_MINALIGN
 
 /* Number of packets processed together */
-#define ETH_PACKETS_BATCH_RECV	32
+#define ETH_PACKETS_BATCH_RECV	CONFIG_NET_RX_BUDGET
 
 /* ARP hardware address length */
 #define ARP_HLEN 6
@@ -174,6 +174,33 @@ struct eth_ops {
 
 #define eth_get_ops(dev) ((struct eth_ops *)(dev)->driver->ops)
 
+/**
+ * struct eth_rx_stats - Receive statistics of an Ethernet device
+ *
+ * @polls: Number of times the device was asked for frames
+ * @frames: Number of frames received
+ * @max_frames: Largest number of frames received in one poll
+ * @budget_hits: Number of polls which stopped at CONFIG_NET_RX_BUDGET frames,
+ *		 i.e. where more frames may have been waiting in the driver
+ * @errors: Number of errors returned by the recv() method of the driver
+ */
+struct eth_rx_stats {
+	ulong polls;
+	ulong frames;
+	uint max_frames;
+	ulong budget_hits;
+	ulong errors;
+};
+
+/**
+ * eth_get_rx_stats() - Get the receive statistics of a device
+ *
+ * @dev: Ethernet device
+ * Return: pointer to the statistics, or NULL if CONFIG_NET_RX_STATS is not
+ * enabled
+ */
+struct eth_rx_stats *eth_get_rx_stats(struct udevice *dev);
+
 struct udevice *eth_get_dev(void); /* get the current device */
 /*
  * The devname can be either an exact name given by the driver or device tree
@@ -371,6 +398,7 @@ struct vlan_ethernet_hdr {
 #define PROT_NCSI	0x88f8		/* NC-SI control packets        */
 
 #define IPPROTO_ICMP	 1	/* Internet Control Message Protocol	*/
+#define IPPROTO_TCP	 6	/* Transmission Control Protocol	*/
 #define IPPROTO_UDP	17	/* User Datagram Protocol		*/
 
 /*
@@ -564,7 +592,7 @@ extern int		net_restart_wrap;	/* Tried all network devices */
 
 enum proto_t {
 	BOOTP, RARP, ARP, TFTPGET, DHCP, PING, DNS, NFS, CDP, NETCONS, SNTP,
-	TFTPSRV, TFTPPUT, LINKLOCAL, FASTBOOT, WOL, UDP
+	TFTPSRV, TFTPPUT, LINKLOCAL, FASTBOOT, WOL, UDP, WGET, TFTPMULTI
 };
 
 extern char	net_boot_file_name[1024];/* Boot File name */
@@ -0,0 +1,170 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Minimal TCP client for downloading over the network loop
+ *
+ * Only one connection exists at a time. Received data is handed to the user
+ * as soon as it arrives, together with its offset in the stream, so that it
+ * can be written straight to its final place in memory. This lets segments
+ * which arrive ahead of a lost one be kept and reported to the sender with
+ * selective acknowledgements (RFC 2018).
+ */
+
+#ifndef __TCP_H__
+#define __TCP_H__
+
+#include <net.h>
+
+/* TCP header flags, also used as the action of net_send_ip_packet() */
+#define TCP_FIN		0x01
+#define TCP_SYN		0x02
+#define TCP_RST		0x04
+#define TCP_PUSH	0x08
+#define TCP_ACK		0x10
+
+/* TCP options */
+#define TCP_O_END	0
+#define TCP_O_NOP	1
+#define TCP_O_MSS	2
+#define TCP_O_WS	3
+#define TCP_O_SACK_PERM	4
+#define TCP_O_SACK	5
+
+/* Largest segment we accept, for a 1500-byte Ethernet MTU */
+#define TCP_MSS		1460
+/* Minimum segment size every host must accept (RFC 879) */
+#define TCP_MIN_MSS	536
+
+/**
+ * struct ip_tcp_hdr - IP and TCP headers, without options
+ */
+struct ip_tcp_hdr {
+	u8		ip_hl_v;	/* header length and version	*/
+	u8		ip_tos;		/* type of service		*/
+	u16		ip_len;		/* total length			*/
+	u16		ip_id;		/* identification		*/
+	u16		ip_off;		/* fragment offset field	*/
+	u8		ip_ttl;		/* time to live			*/
+	u8		ip_p;		/* protocol			*/
+	u16		ip_sum;		/* checksum			*/
+	struct in_addr	ip_src;		/* Source IP address		*/
+	struct in_addr	ip_dst;		/* Destination IP address	*/
+	u16		tcp_src;	/* TCP source port		*/
+	u16		tcp_dst;	/* TCP destination port		*/
+	u32		tcp_seq;	/* Sequence number		*/
+	u32		tcp_ack;	/* Acknowledgement number	*/
+	u8		tcp_hlen;	/* 4 bits header length in words */
+	u8		tcp_flags;	/* TCP_FIN, TCP_SYN, ...	*/
+	u16		tcp_win;	/* Receive window		*/
+	u16		tcp_xsum;	/* Checksum			*/
+	u16		tcp_ugr;	/* Urgent pointer		*/
+} __packed;
+
+#define IP_TCP_HDR_SIZE		(sizeof(struct ip_tcp_hdr))
+#define TCP_HDR_SIZE		(IP_TCP_HDR_SIZE - IP_HDR_SIZE)
+
+/**
+ * struct tcp_ops - callbacks for a TCP connection
+ *
+ * @connected:	The connection is established and data can be sent
+ * @rx:		Data was received. @offset is the position of @data in the
+ *		stream. Data can arrive ahead of earlier data which was lost,
+ *		and the same data can be passed again if the sender repeats
+ *		it. Return true if the data was used. Data ahead of the
+ *		stream position is dropped, and retransmitted later by the
+ *		sender, if this returns false.
+ * @received:	All data up to @len bytes into the stream has been received
+ * @closed:	The connection has ended. @err is 0 if the remote closed it
+ *		after sending all its data, -ECONNRESET if it was reset,
+ *		-ETIMEDOUT if the remote stopped responding
+ */
+struct tcp_ops {
+	void (*connected)(void);
+	bool (*rx)(u32 offset, const uchar *data, unsigned int len);
+	void (*received)(u32 len);
+	void (*closed)(int err);
+};
+
+/**
+ * tcp_connect() - open a connection to a remote port
+ *
+ * This must be called from the start function of a protocol, within
+ * net_loop(). The TCP code uses the network loop's timeout handler for its
+ * timers, so the caller must not set its own.
+ *
+ * @dest:	Remote IP address
+ * @dport:	Remote port
+ * @ops:	Callbacks for the connection
+ * Return: 0 if the connection attempt was started, -ve on error
+ */
+int tcp_connect(struct in_addr dest, int dport, const struct tcp_ops *ops);
+
+/**
+ * tcp_send() - send data on the connection
+ *
+ * The data is copied and sent again until the remote acknowledges it. Only
+ * one segment can be in flight.
+ *
+ * @data:	Data to send
+ * @len:	Number of bytes, at most the remote's maximum segment size
+ * Return: 0 if OK, -ENOTCONN if not connected, -EBUSY if earlier data has
+ * not been acknowledged yet, -EMSGSIZE if @len is too large
+ */
+int tcp_send(const void *data, unsigned int len);
+
+/**
+ * tcp_close() - close our side of the connection
+ *
+ * Nothing more can be sent. Data the remote sends is still received.
+ */
+void tcp_close(void);
+
+/**
+ * tcp_abort() - drop the connection
+ *
+ * The remote is sent a reset if the connection is open. Nothing more is
+ * received on it and no callbacks are made, so a protocol calls this once
+ * it is done with the connection, before net_loop() returns. net_loop()
+ * also calls it on entry, in case an earlier loop left a connection behind.
+ */
+void tcp_abort(void);
+
+/**
+ * tcp_receive() - process a received TCP packet
+ *
+ * This is called by net_process_received_packet().
+ *
+ * @ip:		IP header of the packet, followed by the TCP header
+ * @len:	Length of the IP packet
+ */
+void tcp_receive(struct ip_tcp_hdr *ip, int len);
+
+/**
+ * tcp_set_tcp_header() - set the IP and TCP headers of a packet to send
+ *
+ * The TCP options are chosen from @action and the connection state. The
+ * payload must already follow the headers, at an offset of
+ * tcp_hdr_size(@action).
+ *
+ * @pkt:	Start of the IP header
+ * @dest:	Remote IP address
+ * @dport:	Remote port
+ * @sport:	Local port
+ * @payload_len: Number of bytes of payload
+ * @action:	TCP flags to set
+ * @tcp_seq_num: Sequence number
+ * @tcp_ack_num: Acknowledgement number
+ * Return: size of the IP and TCP headers including options
+ */
+int tcp_set_tcp_header(uchar *pkt, struct in_addr dest, int dport, int sport,
+		       int payload_len, u8 action, u32 tcp_seq_num,
+		       u32 tcp_ack_num);
+
+/**
+ * tcp_hdr_size() - get the size of the headers of a packet to send
+ *
+ * @action:	TCP flags which will be set
+ * Return: size of the IP and TCP headers including options
+ */
+int tcp_hdr_size(u8 action);
+
+#endif /* __TCP_H__ */
@@ -22,6 +22,36 @@ void tftp_start(enum proto_t protocol);	/* Begin TFTP get/put */
 void tftp_start_server(void);	/* Wait for incoming TFTP put */
 #endif
 
+/**
+ * struct tftp_file - a file read by tftp_multi_start()
+ *
+ * @addr:	Address to load the file to
+ * @name:	Name of the file on the server
+ * @size:	Set to the size of the file once it is loaded
+ */
+struct tftp_file {
+	ulong addr;
+	const char *name;
+	ulong size;
+};
+
+/**
+ * tftp_multi_set_files() - set the files to read with the TFTPMULTI protocol
+ *
+ * The array must stay valid until net_loop() returns. Each file must have
+ * its own address; a file may not grow past the address of the next one.
+ *
+ * @files:	Files to read
+ * @count:	Number of files, at most CONFIG_TFTP_MULTI_MAX
+ */
+void tftp_multi_set_files(struct tftp_file *files, int count);
+
+/*
+ * Begin reading several files at once from the server, each with its own
+ * UDP port
+ */
+void tftp_multi_start(void);
+
 extern ulong tftp_timeout_ms;
 extern int tftp_timeout_count_max;
 
@@ -0,0 +1,19 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Download a file with HTTP
+ */
+
+#ifndef __WGET_H__
+#define __WGET_H__
+
+/* Default HTTP server port, changed with the httpdstp variable */
+#define WGET_HTTP_PORT	80
+
+/**
+ * wget_start() - start downloading net_boot_file_name to image_load_addr
+ *
+ * This is called by net_loop() for the WGET protocol.
+ */
+void wget_start(void);
+
+#endif /* __WGET_H__ */
@@ -9,9 +9,25 @@
 /* Maximum number of host devices - see drivers/block/sandbox.c */
 #define SANDBOX_HOST_MAX_DEVICES	4
 
+/* Number of asynchronous requests a host device can have in flight */
+#define SANDBOX_HOST_QUEUE_DEPTH	2
+
+/**
+ * struct host_async_req - an asynchronous request in flight
+ *
+ * @req:	Request, NULL if this slot is free
+ * @polls:	Number of polls before the request completes
+ */
+struct host_async_req {
+	struct blk_req *req;
+	int polls;
+};
+
 struct host_block_dev {
 #ifndef CONFIG_BLK
 	struct blk_desc blk_dev;
+#else
+	struct host_async_req queue[SANDBOX_HOST_QUEUE_DEPTH];
 #endif
 	char *filename;
 	int fd;
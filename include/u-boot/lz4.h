@@ -21,4 +21,20 @@
  */
 int ulz4fn(const void *src, size_t srcn, void *dst, size_t *dstn);
 
+struct image_reader;
+
+/**
+ * ulz4fn_stream() - Decompress LZ4 data while reading it from storage
+ *
+ * Each LZ4 block is read from @rd and decompressed before the next one is
+ * read, so only a single block of input is held in memory.
+ *
+ * @rd: Reader supplying the data to decompress
+ * @dst: Destination for uncompressed data
+ * @dstn: On entry, size of @dst. Returns length of uncompressed data
+ * Return: 0 if OK, -ENOMEM if the block buffer cannot be allocated, -EIO
+ *	on read error, otherwise the same errors as ulz4fn()
+ */
+int ulz4fn_stream(struct image_reader *rd, void *dst, size_t *dstn);
+
 #endif
@@ -101,6 +101,24 @@ void sha1_hmac(const unsigned char *key, int keylen,
  */
 int sha1_self_test( void );
 
+#if !defined(USE_HOSTCC) && defined(CONFIG_CRYPTO_SHA1_ARM64_CE)
+/**
+ * \brief	   Process whole blocks using the ARMv8 Crypto Extensions
+ *
+ * \param ctx	   SHA-1 context
+ * \param data	   blocks to process
+ * \param blocks   number of 64-byte blocks
+ * \return	   true if done, false if the CPU lacks the instructions
+ */
+bool sha1_ce_blocks(sha1_context *ctx, const unsigned char *data, int blocks);
+#else
+static inline bool sha1_ce_blocks(sha1_context *ctx,
+				  const unsigned char *data, int blocks)
+{
+	return false;
+}
+#endif
+
 #ifdef __cplusplus
 }
 #endif
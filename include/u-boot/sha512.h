@@ -34,5 +34,23 @@ void sha384_finish(sha512_context * ctx, uint8_t digest[SHA384_SUM_LEN]);
 void sha384_csum_wd(const unsigned char *input, unsigned int ilen,
 		unsigned char *output, unsigned int chunk_sz);
 
+#if !defined(USE_HOSTCC) && defined(CONFIG_CRYPTO_SHA512_ARM64_CE)
+/**
+ * sha512_ce_blocks() - process whole blocks using the ARMv8 Crypto Extensions
+ *
+ * @ctx:	SHA-384/SHA-512 context
+ * @data:	Blocks to process
+ * @blocks:	Number of SHA512_BLOCK_SIZE blocks
+ * Return: true if done, false if the CPU lacks the SHA-512 instructions
+ */
+bool sha512_ce_blocks(sha512_context *ctx, const uint8_t *data, int blocks);
+#else
+static inline bool sha512_ce_blocks(sha512_context *ctx, const uint8_t *data,
+				    int blocks)
+{
+	return false;
+}
+#endif
+
 
 #endif /* _SHA512_H */
@@ -22,6 +22,9 @@
 #include <watchdog.h>
 #endif
 #include "u-boot/zlib.h"
+#ifdef CONFIG_ARM64_CRC32
+#include <asm/armv8/cpu.h>
+#endif
 
 #ifdef USE_HOSTCC
 #define __efi_runtime
@@ -84,7 +87,7 @@ static void __efi_runtime make_crc_table(void)
   }
   crc_table_empty = 0;
 }
-#elif !defined(CONFIG_ARM64_CRC32)
+#else
 /* ========================================================================
  * Table of CRC-32's of all single-byte values (made by make_crc_table)
  */
@@ -179,20 +182,40 @@ const uint32_t * ZEXPORT get_crc_table()
 
 /* ========================================================================= */
 
+#ifdef CONFIG_ARM64_CRC32
+/*
+ * Not every ARMv8.0 core implements the crc32 instructions, so this is only
+ * used once ID_AA64ISAR0_EL1 says they are there. Align the buffer and then
+ * consume a doubleword per instruction.
+ */
+static uint32_t __efi_runtime crc32_arm64(uint32_t crc, const Bytef *buf,
+					  uInt len)
+{
+    while (len && ((unsigned long)buf & 7)) {
+        crc = __builtin_aarch64_crc32b(crc, *buf++);
+        len--;
+    }
+    for (; len >= 8; len -= 8, buf += 8)
+        crc = __builtin_aarch64_crc32x(crc, *(const uint64_t *)buf);
+    while (len--)
+        crc = __builtin_aarch64_crc32b(crc, *buf++);
+
+    return crc;
+}
+#endif
+
 /* No ones complement version. JFFS2 (and other things ?)
  * don't use ones compliment in their CRC calculations.
  */
 uint32_t __efi_runtime crc32_no_comp(uint32_t crc, const Bytef *buf, uInt len)
 {
-#ifdef CONFIG_ARM64_CRC32
-    crc = cpu_to_le32(crc);
-    while (len--)
-        crc = __builtin_aarch64_crc32b(crc, *buf++);
-    return le32_to_cpu(crc);
-#else
     const uint32_t *tab = crc_table;
     const uint32_t *b =(const uint32_t *)buf;
     size_t rem_len;
+#ifdef CONFIG_ARM64_CRC32
+    if (has_crc32())
+        return le32_to_cpu(crc32_arm64(cpu_to_le32(crc), buf, len));
+#endif
 #ifdef CONFIG_DYNAMIC_CRC_TABLE
     if (crc_table_empty)
       make_crc_table();
@@ -227,7 +250,6 @@ uint32_t __efi_runtime crc32_no_comp(uint32_t crc, const Bytef *buf, uInt len)
     }
 
     return le32_to_cpu(crc);
-#endif
 }
 #undef DO_CRC
 
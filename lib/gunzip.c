@@ -82,6 +82,73 @@ int gunzip(void *dst, int dstlen, unsigned char *src, unsigned long *lenp)
 	return zunzip(dst, dstlen, src, lenp, 1, offset);
 }
 
+int gunzip_stream(void *dst, int dstlen, struct image_reader *rd,
+		  unsigned long *lenp)
+{
+	unsigned char *buf;
+	z_stream s;
+	int err = -1;
+	long len;
+	int offset;
+	int r;
+
+	buf = malloc(IMAGE_STREAM_CHUNK_SIZE);
+	if (!buf)
+		return -1;
+
+	len = image_reader_read(rd, buf, IMAGE_STREAM_CHUNK_SIZE);
+	if (len <= 0)
+		goto out;
+	offset = gzip_parse_header(buf, len);
+	if (offset < 0)
+		goto out;
+
+	s.zalloc = gzalloc;
+	s.zfree = gzfree;
+
+	r = inflateInit2(&s, -MAX_WBITS);
+	if (r != Z_OK) {
+		printf("Error: inflateInit2() returned %d\n", r);
+		goto out;
+	}
+	s.next_in = buf + offset;
+	s.avail_in = len - offset;
+	s.next_out = dst;
+	s.avail_out = dstlen;
+	while (1) {
+		r = inflate(&s, Z_NO_FLUSH);
+		if (r == Z_STREAM_END) {
+			err = 0;
+			break;
+		}
+		if (r != Z_OK && r != Z_BUF_ERROR) {
+			printf("Error: inflate() returned %d\n", r);
+			break;
+		}
+		if (!s.avail_out) {
+			puts("Error: gunzip out of output space\n");
+			break;
+		}
+		if (s.avail_in)
+			continue;
+
+		/* Refill the input only once the previous chunk is used up */
+		len = image_reader_read(rd, buf, IMAGE_STREAM_CHUNK_SIZE);
+		if (len <= 0) {
+			puts("Error: gunzip out of data\n");
+			break;
+		}
+		s.next_in = buf;
+		s.avail_in = len;
+	}
+	*lenp = s.next_out - (unsigned char *)dst;
+	inflateEnd(&s);
+out:
+	free(buf);
+
+	return err;
+}
+
 #ifdef CONFIG_CMD_UNZIP
 __weak
 void gzwrite_progress_init(ulong expectedsize)
@@ -50,82 +50,363 @@
 
 static void default_log(const char *ignored, char *response) {}
 
-static lbaint_t write_sparse_chunk_raw(struct sparse_storage *info,
-				       lbaint_t blk, lbaint_t blkcnt,
-				       void *data,
-				       char *response)
+static int sparse_writer_init(struct sparse_writer *w,
+			      struct sparse_storage *info)
 {
-	lbaint_t n = blkcnt, write_blks, blks = 0, aligned_buf_blks = 4096;
-	uint32_t *aligned_buf = NULL;
+	w->size = max_t(size_t, info->blksz,
+			rounddown(CONFIG_IMAGE_SPARSE_WRITEBUF_SIZE,
+				  info->blksz));
+	w->buf = memalign(ARCH_DMA_MINALIGN,
+			  ROUNDUP(w->size, ARCH_DMA_MINALIGN));
+	if (!w->buf)
+		return -ENOMEM;
+
+	w->info = info;
+	w->blk = info->start;
+	w->len = 0;
+	w->fill_len = 0;
+
+	return 0;
+}
 
-	if (CONFIG_IS_ENABLED(SYS_DCACHE_OFF)) {
-		write_blks = info->write(info, blk, n, data);
-		if (write_blks < n)
-			goto write_fail;
+static void sparse_writer_free(struct sparse_writer *w)
+{
+	free(w->buf);
+	w->buf = NULL;
+}
 
-		return write_blks;
+/* Write blocks to storage, returning the number of storage blocks used */
+static lbaint_t sparse_writer_write(struct sparse_writer *w, lbaint_t blk,
+				    lbaint_t blkcnt, const void *data,
+				    char *response)
+{
+	struct sparse_storage *info = w->info;
+	lbaint_t write_blks;
+
+	/* write_blks might be > blkcnt due to NAND bad-blocks */
+	write_blks = info->write(info, blk, blkcnt, data);
+	if (IS_ERR_VALUE(write_blks) || write_blks < blkcnt) {
+		printf("%s: %s" LBAFU " [" LBAFU "]\n",
+		       __func__, "Write failed, block #", blk, blkcnt);
+		info->mssg("flash write failure", response);
+		return 0;
 	}
 
-	aligned_buf = memalign(ARCH_DMA_MINALIGN, info->blksz * aligned_buf_blks);
-	if (!aligned_buf) {
-		info->mssg("Malloc failed for: CHUNK_TYPE_RAW", response);
-		return -ENOMEM;
+	return write_blks;
+}
+
+/**
+ * sparse_writer_flush() - write out the gathered blocks
+ *
+ * @w: Writer to flush
+ * @response: Pointer to fastboot response buffer
+ * Return: 0 if OK, -1 on error
+ */
+static int sparse_writer_flush(struct sparse_writer *w, char *response)
+{
+	lbaint_t blkcnt = w->len / w->info->blksz;
+	lbaint_t blks;
+
+	if (!blkcnt)
+		return 0;
+
+	blks = sparse_writer_write(w, w->blk, blkcnt, w->buf, response);
+	if (!blks)
+		return -1;
+	w->blk += blks;
+	w->len = 0;
+
+	return 0;
+}
+
+/* Storage block which the next data goes to */
+static lbaint_t sparse_writer_next(struct sparse_writer *w)
+{
+	return w->blk + w->len / w->info->blksz;
+}
+
+/**
+ * sparse_writer_raw() - add RAW data for the next blocks
+ *
+ * The data is gathered with the data before it, so that consecutive chunks
+ * are written together. It may end within a block, which is then completed
+ * by the next call.
+ *
+ * @w: Writer to add to
+ * @data: Data to write
+ * @len: Number of bytes
+ * @response: Pointer to fastboot response buffer
+ * Return: 0 if OK, -1 on error
+ */
+static int sparse_writer_raw(struct sparse_writer *w, const void *data,
+			     size_t len, char *response)
+{
+	lbaint_t blkcnt;
+	lbaint_t blks;
+	size_t n;
+
+	/* Without a data cache, large runs can be written from the image */
+	if (CONFIG_IS_ENABLED(SYS_DCACHE_OFF) && !w->len &&
+	    len >= w->size) {
+		blkcnt = len / w->info->blksz;
+		blks = sparse_writer_write(w, w->blk, blkcnt, data, response);
+		if (!blks)
+			return -1;
+		w->blk += blks;
+		data += blkcnt * w->info->blksz;
+		len -= blkcnt * w->info->blksz;
+	}
+
+	while (len) {
+		if (w->len == w->size && sparse_writer_flush(w, response))
+			return -1;
+		n = min_t(size_t, len, w->size - w->len);
+		memcpy(w->buf + w->len, data, n);
+		w->fill_len = min(w->fill_len, w->len);
+		w->len += n;
+		data += n;
+		len -= n;
 	}
 
-	while (blkcnt > 0) {
-		n = min(aligned_buf_blks, blkcnt);
-		memcpy(aligned_buf, data, n * info->blksz);
+	return 0;
+}
 
-		/* write_blks might be > n due to NAND bad-blocks */
-		write_blks = info->write(info, blk + blks, n, aligned_buf);
-		if (write_blks < n) {
-			free(aligned_buf);
-			goto write_fail;
+/* Add blocks filled with @fill_val, gathered with the data before them */
+static int sparse_writer_fill(struct sparse_writer *w, uint32_t fill_val,
+			      lbaint_t blkcnt, char *response)
+{
+	size_t len;
+	u32 *p, *end;
+
+	while (blkcnt) {
+		if (w->len == w->size && sparse_writer_flush(w, response))
+			return -1;
+		len = min_t(u64, (u64)blkcnt * w->info->blksz,
+			    w->size - w->len);
+
+		/* A long fill reuses the buffer it filled for the last write */
+		if (w->len || w->fill_val != fill_val || w->fill_len < len) {
+			end = (u32 *)(w->buf + w->len + len);
+			for (p = (u32 *)(w->buf + w->len); p < end; p++)
+				*p = fill_val;
+			if (w->len) {
+				w->fill_len = min(w->fill_len, w->len);
+			} else {
+				w->fill_val = fill_val;
+				w->fill_len = len;
+			}
 		}
+		w->len += len;
+		blkcnt -= len / w->info->blksz;
+	}
+
+	return 0;
+}
 
-		blks += write_blks;
-		data += n * info->blksz;
-		blkcnt -= n;
+/**
+ * sparse_writer_zero() - add blocks which must read as zeroes
+ *
+ * If the storage reads erased blocks as zeroes, the erase groups within the
+ * blocks are erased rather than written.
+ *
+ * @w: Writer to add to
+ * @blkcnt: Number of blocks
+ * @response: Pointer to fastboot response buffer
+ * Return: 0 if OK, -1 on error
+ */
+static int sparse_writer_zero(struct sparse_writer *w, lbaint_t blkcnt,
+			      char *response)
+{
+	struct sparse_storage *info = w->info;
+	lbaint_t blk = sparse_writer_next(w);
+	lbaint_t head = 0, erase_cnt = 0;
+	u32 rem;
+
+	if (info->erase && info->erase_size) {
+		div_u64_rem(blk, info->erase_size, &rem);
+		if (rem)
+			head = info->erase_size - rem;
+		if (head < blkcnt) {
+			div_u64_rem(blkcnt - head, info->erase_size, &rem);
+			erase_cnt = blkcnt - head - rem;
+		}
 	}
+	if (!erase_cnt)
+		return sparse_writer_fill(w, 0, blkcnt, response);
 
-	free(aligned_buf);
-	return blks;
+	if (sparse_writer_fill(w, 0, head, response) ||
+	    sparse_writer_flush(w, response))
+		return -1;
 
-write_fail:
-	if (IS_ERR_VALUE(write_blks)) {
-		printf("%s: Write failed, block #" LBAFU " [" LBAFU "] (%lld)\n",
-		       __func__, blk + blks, n, (long long)write_blks);
-		info->mssg("flash write failure", response);
-		return write_blks;
+	if (info->erase(info, w->blk, erase_cnt) != erase_cnt) {
+		printf("%s: Erase failed, block #" LBAFU " [" LBAFU "]\n",
+		       __func__, w->blk, erase_cnt);
+		info->mssg("flash erase failure", response);
+		return -1;
 	}
+	w->blk += erase_cnt;
+
+	return sparse_writer_fill(w, 0, blkcnt - head - erase_cnt, response);
+}
 
-	/* write_blks < n */
-	printf("%s: Write failed, block #" LBAFU " [" LBAFU "]\n",
-	       __func__, blk + blks, n);
-	info->mssg("flash write failure(incomplete)", response);
-	return -1;
+/* Skip blocks which the image does not care about */
+static int sparse_writer_skip(struct sparse_writer *w, lbaint_t blkcnt,
+			      char *response)
+{
+	if (sparse_writer_flush(w, response))
+		return -1;
+	w->blk += w->info->reserve(w->info, w->blk, blkcnt);
+
+	return 0;
+}
+
+/**
+ * sparse_check_header() - check that a sparse image can be written to storage
+ *
+ * @info: Storage the image is written to
+ * @sparse_header: Header of the sparse image
+ * @response: Pointer to fastboot response buffer
+ * Return: 0 if OK, -1 if the sparse block size does not suit the storage
+ */
+static int sparse_check_header(struct sparse_storage *info,
+			       sparse_header_t *sparse_header, char *response)
+{
+	unsigned int offset;
+
+	debug("=== Sparse Image Header ===\n");
+	debug("magic: 0x%x\n", sparse_header->magic);
+	debug("major_version: 0x%x\n", sparse_header->major_version);
+	debug("minor_version: 0x%x\n", sparse_header->minor_version);
+	debug("file_hdr_sz: %d\n", sparse_header->file_hdr_sz);
+	debug("chunk_hdr_sz: %d\n", sparse_header->chunk_hdr_sz);
+	debug("blk_sz: %d\n", sparse_header->blk_sz);
+	debug("total_blks: %d\n", sparse_header->total_blks);
+	debug("total_chunks: %d\n", sparse_header->total_chunks);
+
+	/*
+	 * Verify that the sparse block size is a multiple of our
+	 * storage backend block size
+	 */
+	div_u64_rem(sparse_header->blk_sz, info->blksz, &offset);
+	if (offset) {
+		printf("%s: Sparse image block size issue [%u]\n",
+		       __func__, sparse_header->blk_sz);
+		info->mssg("sparse image block size issue", response);
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * sparse_check_chunk() - check a chunk header against the image and storage
+ *
+ * @info: Storage the image is written to
+ * @sparse_header: Header of the sparse image
+ * @chunk_header: Header of the chunk
+ * @blk: Storage block the chunk starts at
+ * @blkcnt: Returns the number of storage blocks the chunk covers
+ * @response: Pointer to fastboot response buffer
+ * Return: 0 if OK, -1 if the chunk is bad or does not fit in the partition
+ */
+static int sparse_check_chunk(struct sparse_storage *info,
+			      sparse_header_t *sparse_header,
+			      chunk_header_t *chunk_header, lbaint_t blk,
+			      lbaint_t *blkcnt, char *response)
+{
+	uint64_t chunk_data_sz;
+
+	if (chunk_header->chunk_type != CHUNK_TYPE_RAW) {
+		debug("=== Chunk Header ===\n");
+		debug("chunk_type: 0x%x\n", chunk_header->chunk_type);
+		debug("chunk_data_sz: 0x%x\n", chunk_header->chunk_sz);
+		debug("total_size: 0x%x\n", chunk_header->total_sz);
+	}
+
+	chunk_data_sz = ((u64)sparse_header->blk_sz) * chunk_header->chunk_sz;
+	*blkcnt = DIV_ROUND_UP_ULL(chunk_data_sz, info->blksz);
+	switch (chunk_header->chunk_type) {
+	case CHUNK_TYPE_RAW:
+		if (chunk_header->total_sz !=
+		    (sparse_header->chunk_hdr_sz + chunk_data_sz)) {
+			info->mssg("Bogus chunk size for chunk type Raw",
+				   response);
+			return -1;
+		}
+		break;
+
+	case CHUNK_TYPE_FILL:
+		if (chunk_header->total_sz !=
+		    (sparse_header->chunk_hdr_sz + sizeof(uint32_t))) {
+			info->mssg("Bogus chunk size for chunk type FILL",
+				   response);
+			return -1;
+		}
+		break;
+
+	case CHUNK_TYPE_DONT_CARE:
+		return 0;
+
+	case CHUNK_TYPE_CRC32:
+		if (chunk_header->total_sz != sparse_header->chunk_hdr_sz) {
+			info->mssg("Bogus chunk size for chunk type Dont Care",
+				   response);
+			return -1;
+		}
+		return 0;
+
+	default:
+		printf("%s: Unknown chunk type: %x\n", __func__,
+		       chunk_header->chunk_type);
+		info->mssg("Unknown chunk type", response);
+		return -1;
+	}
+
+	if (blk + *blkcnt > info->start + info->size) {
+		printf("%s: Request would exceed partition size!\n", __func__);
+		info->mssg("Request would exceed partition size!", response);
+		return -1;
+	}
+
+	return 0;
+}
+
+/* Write a chunk whose header and data have been checked */
+static int sparse_write_chunk(struct sparse_writer *w,
+			      chunk_header_t *chunk_header, lbaint_t blkcnt,
+			      const void *data, size_t len, char *response)
+{
+	uint32_t fill_val;
+
+	switch (chunk_header->chunk_type) {
+	case CHUNK_TYPE_RAW:
+		return sparse_writer_raw(w, data, len, response);
+
+	case CHUNK_TYPE_FILL:
+		fill_val = *(uint32_t *)data;
+		if (!fill_val)
+			return sparse_writer_zero(w, blkcnt, response);
+		return sparse_writer_fill(w, fill_val, blkcnt, response);
+
+	case CHUNK_TYPE_DONT_CARE:
+		return sparse_writer_skip(w, blkcnt, response);
+	}
+
+	return 0;
 }
 
 int write_sparse_image(struct sparse_storage *info,
 		       const char *part_name, void *data, char *response)
 {
-	lbaint_t blk;
+	struct sparse_writer w;
 	lbaint_t blkcnt;
-	lbaint_t blks;
 	uint64_t bytes_written = 0;
 	unsigned int chunk;
-	unsigned int offset;
 	uint64_t chunk_data_sz;
-	uint32_t *fill_buf = NULL;
-	uint32_t fill_val;
 	sparse_header_t *sparse_header;
 	chunk_header_t *chunk_header;
 	uint32_t total_blocks = 0;
-	int fill_buf_num_blks;
-	int i;
-	int j;
-
-	fill_buf_num_blks = CONFIG_IMAGE_SPARSE_FILLBUF_SIZE / info->blksz;
+	int ret = -1;
 
 	/* Read and skip over sparse image header */
 	sparse_header = (sparse_header_t *)data;
@@ -142,44 +423,23 @@ int write_sparse_image(struct sparse_storage *info,
 	if (!info->mssg)
 		info->mssg = default_log;
 
-	debug("=== Sparse Image Header ===\n");
-	debug("magic: 0x%x\n", sparse_header->magic);
-	debug("major_version: 0x%x\n", sparse_header->major_version);
-	debug("minor_version: 0x%x\n", sparse_header->minor_version);
-	debug("file_hdr_sz: %d\n", sparse_header->file_hdr_sz);
-	debug("chunk_hdr_sz: %d\n", sparse_header->chunk_hdr_sz);
-	debug("blk_sz: %d\n", sparse_header->blk_sz);
-	debug("total_blks: %d\n", sparse_header->total_blks);
-	debug("total_chunks: %d\n", sparse_header->total_chunks);
+	if (sparse_check_header(info, sparse_header, response))
+		return -1;
 
-	/*
-	 * Verify that the sparse block size is a multiple of our
-	 * storage backend block size
-	 */
-	div_u64_rem(sparse_header->blk_sz, info->blksz, &offset);
-	if (offset) {
-		printf("%s: Sparse image block size issue [%u]\n",
-		       __func__, sparse_header->blk_sz);
-		info->mssg("sparse image block size issue", response);
+	if (sparse_writer_init(&w, info)) {
+		printf("%s: Malloc failed for: CHUNK_TYPE_RAW\n", __func__);
+		info->mssg("Malloc failed for: CHUNK_TYPE_RAW", response);
 		return -1;
 	}
 
 	puts("Flashing Sparse Image\n");
 
 	/* Start processing chunks */
-	blk = info->start;
 	for (chunk = 0; chunk < sparse_header->total_chunks; chunk++) {
 		/* Read and skip over chunk header */
 		chunk_header = (chunk_header_t *)data;
 		data += sizeof(chunk_header_t);
 
-		if (chunk_header->chunk_type != CHUNK_TYPE_RAW) {
-			debug("=== Chunk Header ===\n");
-			debug("chunk_type: 0x%x\n", chunk_header->chunk_type);
-			debug("chunk_data_sz: 0x%x\n", chunk_header->chunk_sz);
-			debug("total_size: 0x%x\n", chunk_header->total_sz);
-		}
-
 		if (sparse_header->chunk_hdr_sz > sizeof(chunk_header_t)) {
 			/*
 			 * Skip the remaining bytes in a header that is longer
@@ -189,131 +449,213 @@ int write_sparse_image(struct sparse_storage *info,
 				 sizeof(chunk_header_t));
 		}
 
+		if (sparse_check_chunk(info, sparse_header, chunk_header,
+				       sparse_writer_next(&w), &blkcnt,
+				       response))
+			goto out;
+
 		chunk_data_sz = ((u64)sparse_header->blk_sz) * chunk_header->chunk_sz;
-		blkcnt = DIV_ROUND_UP_ULL(chunk_data_sz, info->blksz);
+		if (sparse_write_chunk(&w, chunk_header, blkcnt, data,
+				       chunk_data_sz, response))
+			goto out;
+
+		total_blocks += chunk_header->chunk_sz;
 		switch (chunk_header->chunk_type) {
 		case CHUNK_TYPE_RAW:
-			if (chunk_header->total_sz !=
-			    (sparse_header->chunk_hdr_sz + chunk_data_sz)) {
-				info->mssg("Bogus chunk size for chunk type Raw",
-					   response);
-				return -1;
-			}
-
-			if (blk + blkcnt > info->start + info->size) {
-				printf(
-				    "%s: Request would exceed partition size!\n",
-				    __func__);
-				info->mssg("Request would exceed partition size!",
-					   response);
-				return -1;
-			}
-
-			blks = write_sparse_chunk_raw(info, blk, blkcnt,
-						      data, response);
-			if (blks < 0)
-				return -1;
-
-			blk += blks;
 			bytes_written += ((u64)blkcnt) * info->blksz;
-			total_blocks += chunk_header->chunk_sz;
 			data += chunk_data_sz;
 			break;
 
 		case CHUNK_TYPE_FILL:
-			if (chunk_header->total_sz !=
-			    (sparse_header->chunk_hdr_sz + sizeof(uint32_t))) {
-				info->mssg("Bogus chunk size for chunk type FILL", response);
-				return -1;
-			}
-
-			fill_buf = (uint32_t *)
-				   memalign(ARCH_DMA_MINALIGN,
-					    ROUNDUP(
-						info->blksz * fill_buf_num_blks,
-						ARCH_DMA_MINALIGN));
-			if (!fill_buf) {
-				info->mssg("Malloc failed for: CHUNK_TYPE_FILL",
-					   response);
-				return -1;
-			}
-
-			fill_val = *(uint32_t *)data;
-			data = (char *)data + sizeof(uint32_t);
-
-			for (i = 0;
-			     i < (info->blksz * fill_buf_num_blks /
-				  sizeof(fill_val));
-			     i++)
-				fill_buf[i] = fill_val;
-
-			if (blk + blkcnt > info->start + info->size) {
-				printf(
-				    "%s: Request would exceed partition size!\n",
-				    __func__);
-				info->mssg("Request would exceed partition size!",
-					   response);
-				free(fill_buf);
-				return -1;
-			}
-
-			for (i = 0; i < blkcnt;) {
-				j = blkcnt - i;
-				if (j > fill_buf_num_blks)
-					j = fill_buf_num_blks;
-				blks = info->write(info, blk, j, fill_buf);
-				/* blks might be > j (eg. NAND bad-blocks) */
-				if (blks < j) {
-					printf("%s: %s " LBAFU " [%d]\n",
-					       __func__,
-					       "Write failed, block #",
-					       blk, j);
-					info->mssg("flash write failure",
-						   response);
-					free(fill_buf);
-					return -1;
-				}
-				blk += blks;
-				i += j;
-			}
 			bytes_written += ((u64)blkcnt) * info->blksz;
-			total_blocks += DIV_ROUND_UP_ULL(chunk_data_sz,
-							 sparse_header->blk_sz);
-			free(fill_buf);
-			break;
-
-		case CHUNK_TYPE_DONT_CARE:
-			blk += info->reserve(info, blk, blkcnt);
-			total_blocks += chunk_header->chunk_sz;
+			data += sizeof(uint32_t);
 			break;
 
 		case CHUNK_TYPE_CRC32:
-			if (chunk_header->total_sz !=
-			    sparse_header->chunk_hdr_sz) {
-				info->mssg("Bogus chunk size for chunk type Dont Care",
-					   response);
-				return -1;
-			}
-			total_blocks += chunk_header->chunk_sz;
 			data += chunk_data_sz;
 			break;
-
-		default:
-			printf("%s: Unknown chunk type: %x\n", __func__,
-			       chunk_header->chunk_type);
-			info->mssg("Unknown chunk type", response);
-			return -1;
 		}
 	}
 
+	if (sparse_writer_flush(&w, response))
+		goto out;
+
 	debug("Wrote %d blocks, expected to write %d blocks\n",
 	      total_blocks, sparse_header->total_blks);
 	printf("........ wrote %llu bytes to '%s'\n", bytes_written, part_name);
 
 	if (total_blocks != sparse_header->total_blks) {
 		info->mssg("sparse image write failure", response);
-		return -1;
+		goto out;
+	}
+	ret = 0;
+
+out:
+	sparse_writer_free(&w);
+
+	return ret;
+}
+
+int sparse_stream_init(struct sparse_stream *ss, struct sparse_storage *info)
+{
+	memset(ss, '\0', sizeof(*ss));
+	if (sparse_writer_init(&ss->w, info))
+		return -ENOMEM;
+
+	if (!info->mssg)
+		info->mssg = default_log;
+	ss->info = info;
+	ss->state = SPARSE_STREAM_FILE_HDR;
+	ss->want = sizeof(sparse_header_t);
+
+	return 0;
+}
+
+/* Move on to the next chunk, or finish after the last one */
+static void sparse_stream_next_chunk(struct sparse_stream *ss)
+{
+	if (ss->chunk == ss->header.total_chunks) {
+		ss->state = SPARSE_STREAM_DONE;
+		return;
+	}
+	ss->chunk++;
+	ss->state = SPARSE_STREAM_CHUNK_HDR;
+	ss->want = sizeof(chunk_header_t);
+}
+
+/* Handle a header or fill value which has been gathered in buf */
+static int sparse_stream_parse(struct sparse_stream *ss, char *response)
+{
+	struct sparse_storage *info = ss->info;
+	sparse_header_t *sparse_header = &ss->header;
+	chunk_header_t *chunk_header = &ss->chunk_hdr;
+	uint64_t chunk_data_sz;
+
+	switch (ss->state) {
+	case SPARSE_STREAM_FILE_HDR:
+		memcpy(sparse_header, ss->buf, sizeof(*sparse_header));
+		if (sparse_check_header(info, sparse_header, response))
+			return -1;
+		if (sparse_header->file_hdr_sz > sizeof(sparse_header_t))
+			ss->skip = sparse_header->file_hdr_sz -
+				   sizeof(sparse_header_t);
+		puts("Flashing Sparse Image\n");
+		sparse_stream_next_chunk(ss);
+		break;
+
+	case SPARSE_STREAM_CHUNK_HDR:
+		memcpy(chunk_header, ss->buf, sizeof(*chunk_header));
+		if (sparse_header->chunk_hdr_sz > sizeof(chunk_header_t))
+			ss->skip = sparse_header->chunk_hdr_sz -
+				   sizeof(chunk_header_t);
+		if (sparse_check_chunk(info, sparse_header, chunk_header,
+				       sparse_writer_next(&ss->w), &ss->blkcnt,
+				       response))
+			return -1;
+
+		chunk_data_sz = ((u64)sparse_header->blk_sz) *
+				chunk_header->chunk_sz;
+		ss->total_blocks += chunk_header->chunk_sz;
+		switch (chunk_header->chunk_type) {
+		case CHUNK_TYPE_RAW:
+			ss->bytes_written += ((u64)ss->blkcnt) * info->blksz;
+			ss->data_left = chunk_data_sz;
+			ss->state = SPARSE_STREAM_RAW;
+			if (!ss->data_left)
+				sparse_stream_next_chunk(ss);
+			break;
+		case CHUNK_TYPE_FILL:
+			ss->bytes_written += ((u64)ss->blkcnt) * info->blksz;
+			ss->state = SPARSE_STREAM_FILL;
+			ss->want = sizeof(uint32_t);
+			break;
+		case CHUNK_TYPE_DONT_CARE:
+			if (sparse_write_chunk(&ss->w, chunk_header,
+					       ss->blkcnt, NULL, 0, response))
+				return -1;
+			sparse_stream_next_chunk(ss);
+			break;
+		case CHUNK_TYPE_CRC32:
+			ss->skip += chunk_data_sz;
+			sparse_stream_next_chunk(ss);
+			break;
+		}
+		break;
+
+	case SPARSE_STREAM_FILL:
+		if (sparse_write_chunk(&ss->w, chunk_header, ss->blkcnt,
+				       ss->buf, sizeof(uint32_t), response))
+			return -1;
+		sparse_stream_next_chunk(ss);
+		break;
+	default:
+		break;
+	}
+
+	return 0;
+}
+
+int sparse_stream_write(struct sparse_stream *ss, const void *data,
+			size_t len, char *response)
+{
+	size_t n;
+
+	while (len && ss->state != SPARSE_STREAM_DONE) {
+		if (ss->skip) {
+			n = min_t(u64, len, ss->skip);
+			ss->skip -= n;
+		} else if (ss->state == SPARSE_STREAM_RAW) {
+			/* RAW data may end within a block; the rest follows */
+			n = min_t(u64, len, ss->data_left);
+			if (sparse_writer_raw(&ss->w, data, n, response))
+				return -1;
+			ss->data_left -= n;
+			if (!ss->data_left)
+				sparse_stream_next_chunk(ss);
+		} else {
+			/* Headers and fill values may be split across calls */
+			n = min_t(size_t, len, ss->want - ss->buf_len);
+			memcpy(ss->buf + ss->buf_len, data, n);
+			ss->buf_len += n;
+			if (ss->buf_len == ss->want) {
+				ss->buf_len = 0;
+				if (sparse_stream_parse(ss, response))
+					return -1;
+			}
+		}
+		data += n;
+		len -= n;
 	}
 
 	return 0;
 }
+
+int sparse_stream_finish(struct sparse_stream *ss, const char *part_name,
+			 char *response)
+{
+	int ret = -1;
+
+	if (ss->state != SPARSE_STREAM_DONE) {
+		printf("%s: Sparse image is incomplete\n", __func__);
+		ss->info->mssg("sparse image incomplete", response);
+		goto out;
+	}
+	if (sparse_writer_flush(&ss->w, response))
+		goto out;
+
+	debug("Wrote %d blocks, expected to write %d blocks\n",
+	      ss->total_blocks, ss->header.total_blks);
+	printf("........ wrote %llu bytes to '%s'\n", ss->bytes_written,
+	       part_name);
+
+	if (ss->total_blocks != ss->header.total_blks) {
+		ss->info->mssg("sparse image write failure", response);
+		goto out;
+	}
+	ret = 0;
+
+out:
+	sparse_writer_free(&ss->w);
+
+	return ret;
+}
@@ -72,50 +72,95 @@ static long lmb_addrs_adjacent(phys_addr_t base1, phys_size_t size1,
 	return 0;
 }
 
-static long lmb_regions_adjacent(struct lmb_region *rgn, unsigned long r1,
-				 unsigned long r2)
+/**
+ * lmb_search() - find where an address belongs in a region array
+ *
+ * @rgn:	regions to search, sorted by base address
+ * @addr:	address to look up
+ * Return: index of the first region starting above @addr, so the only
+ * region which can contain @addr is the one before it
+ */
+static unsigned long lmb_search(struct lmb_region *rgn, phys_addr_t addr)
 {
-	phys_addr_t base1 = rgn->region[r1].base;
-	phys_size_t size1 = rgn->region[r1].size;
-	phys_addr_t base2 = rgn->region[r2].base;
-	phys_size_t size2 = rgn->region[r2].size;
+	unsigned long lo = 0, hi = rgn->cnt;
+
+	while (lo < hi) {
+		unsigned long mid = lo + (hi - lo) / 2;
+
+		if (rgn->region[mid].base <= addr)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
 
-	return lmb_addrs_adjacent(base1, size1, base2, size2);
+	return lo;
 }
 
 static void lmb_remove_region(struct lmb_region *rgn, unsigned long r)
 {
-	unsigned long i;
-
-	for (i = r; i < rgn->cnt - 1; i++) {
-		rgn->region[i].base = rgn->region[i + 1].base;
-		rgn->region[i].size = rgn->region[i + 1].size;
-		rgn->region[i].flags = rgn->region[i + 1].flags;
-	}
+	memmove(&rgn->region[r], &rgn->region[r + 1],
+		(rgn->cnt - r - 1) * sizeof(*rgn->region));
 	rgn->cnt--;
 }
 
-/* Assumption: base addr of region 1 < base addr of region 2 */
-static void lmb_coalesce_regions(struct lmb_region *rgn, unsigned long r1,
-				 unsigned long r2)
+/* Make room for one more region, moving the array to the heap if needed */
+static int lmb_grow_region(struct lmb_region *rgn)
 {
-	rgn->region[r1].size += rgn->region[r2].size;
-	lmb_remove_region(rgn, r2);
+	struct lmb_property *region;
+	unsigned long new_max;
+
+	if (rgn->cnt < rgn->max)
+		return 0;
+
+	new_max = max(rgn->max * 2, 8UL);
+	region = malloc(new_max * sizeof(*region));
+	if (!region)
+		return -ENOMEM;
+	memcpy(region, rgn->region, rgn->cnt * sizeof(*region));
+	if (rgn->alloced)
+		free(rgn->region);
+	rgn->region = region;
+	rgn->max = new_max;
+	rgn->alloced = true;
+
+	return 0;
+}
+
+static void lmb_insert_region(struct lmb_region *rgn, unsigned long r,
+			      phys_addr_t base, phys_size_t size,
+			      enum lmb_flags flags)
+{
+	memmove(&rgn->region[r + 1], &rgn->region[r],
+		(rgn->cnt - r) * sizeof(*rgn->region));
+	rgn->region[r].base = base;
+	rgn->region[r].size = size;
+	rgn->region[r].flags = flags;
+	rgn->cnt++;
+}
+
+static void lmb_init_region(struct lmb_region *rgn,
+			    struct lmb_property *region, unsigned long max)
+{
+	rgn->cnt = 0;
+	rgn->max = max;
+	rgn->region = region;
+	rgn->alloced = false;
 }
 
 void lmb_init(struct lmb *lmb)
 {
-#if IS_ENABLED(CONFIG_LMB_USE_MAX_REGIONS)
-	lmb->memory.max = CONFIG_LMB_MAX_REGIONS;
-	lmb->reserved.max = CONFIG_LMB_MAX_REGIONS;
-#else
-	lmb->memory.max = CONFIG_LMB_MEMORY_REGIONS;
-	lmb->reserved.max = CONFIG_LMB_RESERVED_REGIONS;
-	lmb->memory.region = lmb->memory_regions;
-	lmb->reserved.region = lmb->reserved_regions;
-#endif
-	lmb->memory.cnt = 0;
-	lmb->reserved.cnt = 0;
+	lmb_init_region(&lmb->memory, lmb->memory_regions, LMB_MEMORY_REGIONS);
+	lmb_init_region(&lmb->reserved, lmb->reserved_regions,
+			LMB_RESERVED_REGIONS);
+}
+
+void lmb_uninit(struct lmb *lmb)
+{
+	if (lmb->memory.alloced)
+		free(lmb->memory.region);
+	if (lmb->reserved.alloced)
+		free(lmb->reserved.region);
+	lmb_init(lmb);
 }
 
 void arch_lmb_reserve_generic(struct lmb *lmb, ulong sp, ulong end, ulong align)
@@ -192,84 +237,53 @@ void lmb_init_and_reserve_range(struct lmb *lmb, phys_addr_t base,
 static long lmb_add_region_flags(struct lmb_region *rgn, phys_addr_t base,
 				 phys_size_t size, enum lmb_flags flags)
 {
-	unsigned long coalesced = 0;
-	long adjacent, i;
-
-	if (rgn->cnt == 0) {
-		rgn->region[0].base = base;
-		rgn->region[0].size = size;
-		rgn->region[0].flags = flags;
-		rgn->cnt = 1;
-		return 0;
-	}
+	struct lmb_property *prev = NULL, *next = NULL;
+	unsigned long i;
 
-	/* First try and coalesce this LMB with another. */
-	for (i = 0; i < rgn->cnt; i++) {
-		phys_addr_t rgnbase = rgn->region[i].base;
-		phys_size_t rgnsize = rgn->region[i].size;
-		phys_size_t rgnflags = rgn->region[i].flags;
-
-		if (rgnbase == base && rgnsize == size) {
-			if (flags == rgnflags)
-				/* Already have this region, so we're done */
-				return 0;
-			else
-				return -1; /* regions with new flags */
-		}
+	i = lmb_search(rgn, base);
+	if (i > 0)
+		prev = &rgn->region[i - 1];
+	if (i < rgn->cnt)
+		next = &rgn->region[i];
 
-		adjacent = lmb_addrs_adjacent(base, size, rgnbase, rgnsize);
-		if (adjacent > 0) {
-			if (flags != rgnflags)
-				break;
-			rgn->region[i].base -= size;
-			rgn->region[i].size += size;
-			coalesced++;
-			break;
-		} else if (adjacent < 0) {
-			if (flags != rgnflags)
-				break;
-			rgn->region[i].size += size;
-			coalesced++;
-			break;
-		} else if (lmb_addrs_overlap(base, size, rgnbase, rgnsize)) {
-			/* regions overlap */
-			return -2;
-		}
-	}
-
-	if ((i < rgn->cnt - 1) && lmb_regions_adjacent(rgn, i, i + 1)) {
-		if (rgn->region[i].flags == rgn->region[i + 1].flags) {
-			lmb_coalesce_regions(rgn, i, i + 1);
-			coalesced++;
-		}
+	if (prev && prev->base == base && prev->size == size) {
+		if (flags == prev->flags)
+			/* Already have this region, so we're done */
+			return 0;
+		else
+			return -1; /* regions with new flags */
 	}
 
-	if (coalesced)
-		return coalesced;
-	if (rgn->cnt >= rgn->max)
-		return -1;
-
-	/* Couldn't coalesce the LMB, so add it to the sorted table. */
-	for (i = rgn->cnt-1; i >= 0; i--) {
-		if (base < rgn->region[i].base) {
-			rgn->region[i + 1].base = rgn->region[i].base;
-			rgn->region[i + 1].size = rgn->region[i].size;
-			rgn->region[i + 1].flags = rgn->region[i].flags;
-		} else {
-			rgn->region[i + 1].base = base;
-			rgn->region[i + 1].size = size;
-			rgn->region[i + 1].flags = flags;
-			break;
+	if ((prev && lmb_addrs_overlap(base, size, prev->base, prev->size)) ||
+	    (next && lmb_addrs_overlap(base, size, next->base, next->size)))
+		/* regions overlap */
+		return -2;
+
+	/* Try and coalesce this LMB with its neighbours */
+	if (prev && prev->flags != flags)
+		prev = NULL;
+	if (next && next->flags != flags)
+		next = NULL;
+	if (prev && lmb_addrs_adjacent(prev->base, prev->size, base, size) > 0) {
+		prev->size += size;
+		if (next && lmb_addrs_adjacent(prev->base, prev->size,
+					       next->base, next->size) > 0) {
+			prev->size += next->size;
+			lmb_remove_region(rgn, i);
+			return 2;
 		}
+		return 1;
 	}
-
-	if (base < rgn->region[0].base) {
-		rgn->region[0].base = base;
-		rgn->region[0].size = size;
-		rgn->region[0].flags = flags;
+	if (next && lmb_addrs_adjacent(base, size, next->base, next->size) > 0) {
+		next->base = base;
+		next->size += size;
+		return 1;
 	}
 
-	rgn->cnt++;
+	/* Couldn't coalesce the LMB, so add it to the sorted table. */
+	if (lmb_grow_region(rgn))
+		return -1;
+	lmb_insert_region(rgn, i, base, size, flags);
 
 	return 0;
 }
@@ -293,21 +307,18 @@ long lmb_free(struct lmb *lmb, phys_addr_t base, phys_size_t size)
 	struct lmb_region *rgn = &(lmb->reserved);
 	phys_addr_t rgnbegin, rgnend;
 	phys_addr_t end = base + size - 1;
-	int i;
-
-	rgnbegin = rgnend = 0; /* supress gcc warnings */
+	unsigned long i;
 
 	/* Find the region where (base, size) belongs to */
-	for (i = 0; i < rgn->cnt; i++) {
-		rgnbegin = rgn->region[i].base;
-		rgnend = rgnbegin + rgn->region[i].size - 1;
-
-		if ((rgnbegin <= base) && (end <= rgnend))
-			break;
-	}
+	i = lmb_search(rgn, base);
+	if (!i)
+		return -1;
+	i--;
+	rgnbegin = rgn->region[i].base;
+	rgnend = rgnbegin + rgn->region[i].size - 1;
 
 	/* Didn't find the region */
-	if (i == rgn->cnt)
+	if (end > rgnend)
 		return -1;
 
 	/* Check to see if we are removing entire region */
@@ -333,9 +344,13 @@ long lmb_free(struct lmb *lmb, phys_addr_t base, phys_size_t size)
 	 * We need to split the entry -  adjust the current one to the
 	 * beginging of the hole and add the region after hole.
 	 */
+	if (lmb_grow_region(rgn))
+		return -1;
 	rgn->region[i].size = base - rgn->region[i].base;
-	return lmb_add_region_flags(rgn, end + 1, rgnend - end,
-				    rgn->region[i].flags);
+	lmb_insert_region(rgn, i + 1, end + 1, rgnend - end,
+			  rgn->region[i].flags);
+
+	return 0;
 }
 
 long lmb_reserve_flags(struct lmb *lmb, phys_addr_t base, phys_size_t size,
@@ -356,14 +371,16 @@ static long lmb_overlaps_region(struct lmb_region *rgn, phys_addr_t base,
 {
 	unsigned long i;
 
-	for (i = 0; i < rgn->cnt; i++) {
-		phys_addr_t rgnbase = rgn->region[i].base;
-		phys_size_t rgnsize = rgn->region[i].size;
-		if (lmb_addrs_overlap(base, size, rgnbase, rgnsize))
-			break;
-	}
+	/* Only the region before base and the one after it can overlap */
+	i = lmb_search(rgn, base);
+	if (i > 0 && lmb_addrs_overlap(base, size, rgn->region[i - 1].base,
+				       rgn->region[i - 1].size))
+		return i - 1;
+	if (i < rgn->cnt && lmb_addrs_overlap(base, size, rgn->region[i].base,
+					      rgn->region[i].size))
+		return i;
 
-	return (i < rgn->cnt) ? i : -1;
+	return -1;
 }
 
 long lmb_reserve_overlap(struct lmb *lmb, phys_addr_t base, phys_size_t size,
@@ -496,22 +513,22 @@ phys_addr_t lmb_alloc_addr(struct lmb *lmb, phys_addr_t base, phys_size_t size)
 /* Return number of bytes from a given address that are free */
 phys_size_t lmb_get_free_size(struct lmb *lmb, phys_addr_t addr)
 {
-	int i;
-	long rgn;
+	struct lmb_region *rgn = &lmb->reserved;
+	unsigned long i;
+	long mem;
 
 	/* check if the requested address is in the memory regions */
-	rgn = lmb_overlaps_region(&lmb->memory, addr, 1);
-	if (rgn >= 0) {
-		for (i = 0; i < lmb->reserved.cnt; i++) {
-			if (addr < lmb->reserved.region[i].base) {
-				/* first reserved range > requested address */
-				return lmb->reserved.region[i].base - addr;
-			}
-			if (lmb->reserved.region[i].base +
-			    lmb->reserved.region[i].size > addr) {
-				/* requested addr is in this reserved range */
-				return 0;
-			}
+	mem = lmb_overlaps_region(&lmb->memory, addr, 1);
+	if (mem >= 0) {
+		i = lmb_search(rgn, addr);
+		if (i > 0 && rgn->region[i - 1].base +
+			     rgn->region[i - 1].size > addr) {
+			/* requested addr is in this reserved range */
+			return 0;
+		}
+		if (i < rgn->cnt) {
+			/* first reserved range > requested address */
+			return rgn->region[i].base - addr;
 		}
 		/* if we come here: no reserved ranges above requested addr */
 		return lmb->memory.region[lmb->memory.cnt - 1].base +
@@ -522,15 +539,13 @@ phys_size_t lmb_get_free_size(struct lmb *lmb, phys_addr_t addr)
 
 int lmb_is_reserved_flags(struct lmb *lmb, phys_addr_t addr, int flags)
 {
-	int i;
+	long i;
 
-	for (i = 0; i < lmb->reserved.cnt; i++) {
-		phys_addr_t upper = lmb->reserved.region[i].base +
-			lmb->reserved.region[i].size - 1;
-		if ((addr >= lmb->reserved.region[i].base) && (addr <= upper))
-			return (lmb->reserved.region[i].flags & flags) == flags;
-	}
-	return 0;
+	i = lmb_overlaps_region(&lmb->reserved, addr, 1);
+	if (i < 0)
+		return 0;
+
+	return (lmb->reserved.region[i].flags & flags) == flags;
 }
 
 int lmb_is_reserved(struct lmb *lmb, phys_addr_t addr)
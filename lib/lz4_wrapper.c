@@ -6,6 +6,7 @@
 #include <common.h>
 #include <compiler.h>
 #include <image.h>
+#include <malloc.h>
 #include <linux/kernel.h>
 #include <linux/types.h>
 #include <asm/unaligned.h>
@@ -128,3 +129,107 @@ int ulz4fn(const void *src, size_t srcn, void *dst, size_t *dstn)
 	*dstn = out - dst;
 	return ret;
 }
+
+int ulz4fn_stream(struct image_reader *rd, void *dst, size_t *dstn)
+{
+	const void *end = dst + *dstn;
+	void *out = dst;
+	int has_block_checksum;
+	size_t max_block;
+	u8 hdr[sizeof(u32) + 2 * sizeof(u8) + sizeof(u64) + sizeof(u8)];
+	void *block;
+	int ret;
+	*dstn = 0;
+
+	{
+		u32 magic;
+		u8 flags, version, independent_blocks, has_content_size;
+		u8 block_desc, block_max;
+		size_t len = sizeof(u32) + 2 * sizeof(u8);
+
+		if (image_reader_read(rd, hdr, len) != len)
+			return -EINVAL;	/* input overrun */
+
+		magic = get_unaligned_le32(hdr);
+		flags = hdr[4];
+		block_desc = hdr[5];
+
+		version = (flags >> 6) & 0x3;
+		independent_blocks = (flags >> 5) & 0x1;
+		has_block_checksum = (flags >> 4) & 0x1;
+		has_content_size = (flags >> 3) & 0x1;
+		block_max = (block_desc >> 4) & 0x7;
+
+		if (magic != LZ4F_MAGIC || version != 1)
+			return -EPROTONOSUPPORT;	/* unknown format */
+		if ((flags & 0x03) || (block_desc & 0x8f) || block_max < 4)
+			return -EINVAL;	/* reserved bits must be zero */
+		if (!independent_blocks)
+			return -EPROTONOSUPPORT; /* we can't support this yet */
+
+		/* Skip the content size, if any, and the header checksum */
+		len = (has_content_size ? sizeof(u64) : 0) + sizeof(u8);
+		if (image_reader_read(rd, hdr, len) != len)
+			return -EINVAL;	/* input overrun */
+
+		/* 64KB, 256KB, 1MB or 4MB */
+		max_block = 1 << (8 + 2 * block_max);
+	}
+
+	block = malloc(max_block + sizeof(u32));
+	if (!block)
+		return -ENOMEM;
+
+	while (1) {
+		u32 block_header, block_size;
+		size_t len;
+
+		if (image_reader_read(rd, &block_header, sizeof(u32)) !=
+		    sizeof(u32)) {
+			ret = -EINVAL;		/* input overrun */
+			break;
+		}
+		block_header = le32_to_cpu(block_header);
+		block_size = block_header & ~LZ4F_BLOCKUNCOMPRESSED_FLAG;
+
+		if (!block_size) {
+			ret = 0;	/* decompression successful */
+			break;
+		}
+		if (block_size > max_block) {
+			ret = -EINVAL;
+			break;
+		}
+
+		/* Read the block along with its checksum, if any */
+		len = block_size + (has_block_checksum ? sizeof(u32) : 0);
+		if (image_reader_read(rd, block, len) != len) {
+			ret = -EIO;
+			break;
+		}
+
+		if (block_header & LZ4F_BLOCKUNCOMPRESSED_FLAG) {
+			size_t size = min((ptrdiff_t)block_size, end - out);
+			memcpy(out, block, size);
+			out += size;
+			if (size < block_size) {
+				ret = -ENOBUFS;	/* output overrun */
+				break;
+			}
+		} else {
+			/* constant folding essential, do not touch params! */
+			ret = LZ4_decompress_generic(block, out, block_size,
+					end - out, endOnInputSize,
+					full, 0, noDict, out, NULL, 0);
+			if (ret < 0) {
+				ret = -EPROTO;	/* decompression error */
+				break;
+			}
+			out += ret;
+		}
+	}
+
+	free(block);
+	*dstn = out - dst;
+	return ret;
+}
@@ -31,6 +31,8 @@
 #include "LzmaTools.h"
 #include "LzmaDec.h"
 
+#include <image.h>
+#include <linux/errno.h>
 #include <linux/string.h>
 #include <malloc.h>
 
@@ -121,4 +123,112 @@ int lzmaBuffToBuffDecompress (unsigned char *outStream, SizeT *uncompressedSize,
     return res;
 }
 
+int lzmaStreamDecompress(unsigned char *outStream, SizeT *uncompressedSize,
+                         struct image_reader *rd)
+{
+    int res = SZ_ERROR_DATA;
+    int i;
+    ISzAlloc g_Alloc;
+    CLzmaDec dec;
+    unsigned char header[LZMA_DATA_OFFSET];
+    unsigned char *chunk;
+    SizeT outSizeFull;
+    SizeT inPos = 0, inSize = 0;
+    UInt64 size = 0;
+    ELzmaStatus state = LZMA_STATUS_NOT_SPECIFIED;
+    ELzmaFinishMode finishMode = LZMA_FINISH_ANY;
+    long len;
+
+    if (image_reader_read(rd, header, sizeof(header)) != sizeof(header))
+        return -EIO;
+
+    /* Read the uncompressed size, all ones meaning unknown */
+    for (i = 0; i < 8; i++)
+        size |= (UInt64)header[LZMA_SIZE_OFFSET + i] << (i * 8);
+    if (size == (UInt64)-1) {
+        /* The end mark must then turn up before the output is full */
+        outSizeFull = *uncompressedSize;
+        finishMode = LZMA_FINISH_END;
+    } else if ((SizeT)size != size) {
+        return -EINVAL;
+    } else if (*uncompressedSize < (SizeT)size) {
+        return -ENOSPC;
+    } else {
+        outSizeFull = size;
+    }
+
+    debug("LZMA: Uncompresed size............ 0x%zx\n", outSizeFull);
+
+    g_Alloc.Alloc = SzAlloc;
+    g_Alloc.Free = SzFree;
+
+    chunk = malloc(IMAGE_STREAM_CHUNK_SIZE);
+    if (!chunk)
+        return -ENOMEM;
+
+    LzmaDec_Construct(&dec);
+    res = LzmaDec_AllocateProbs(&dec, header + LZMA_PROPERTIES_OFFSET,
+                                LZMA_PROPS_SIZE, &g_Alloc);
+    if (res != SZ_OK)
+        goto out;
+
+    /* Decode straight into the output, it serves as the dictionary */
+    dec.dic = outStream;
+    dec.dicBufSize = outSizeFull;
+    LzmaDec_Init(&dec);
+
+    for (;;) {
+        SizeT srcLen;
+
+        if (inPos == inSize) {
+            len = image_reader_read(rd, chunk, IMAGE_STREAM_CHUNK_SIZE);
+            if (len <= 0) {
+                res = SZ_ERROR_INPUT_EOF;
+                break;
+            }
+            inPos = 0;
+            inSize = len;
+        }
+
+        WATCHDOG_RESET();
+
+        srcLen = inSize - inPos;
+        res = LzmaDec_DecodeToDic(&dec, outSizeFull, chunk + inPos, &srcLen,
+                                  finishMode, &state);
+        inPos += srcLen;
+        if (res != SZ_OK || state == LZMA_STATUS_FINISHED_WITH_MARK)
+            break;
+        if (dec.dicPos == outSizeFull &&
+            state != LZMA_STATUS_NEEDS_MORE_INPUT) {
+            if (finishMode == LZMA_FINISH_END)
+                res = SZ_ERROR_OUTPUT_EOF;
+            break;
+        }
+    }
+    /* Data left over once the output is full means it did not fit */
+    if (res == SZ_ERROR_DATA && dec.dicPos == outSizeFull)
+        res = SZ_ERROR_OUTPUT_EOF;
+    *uncompressedSize = dec.dicPos;
+
+    debug("LZMA: Uncompressed ............... 0x%zx\n", dec.dicPos);
+
+    LzmaDec_FreeProbs(&dec, &g_Alloc);
+out:
+    free(chunk);
+
+    switch (res) {
+    case SZ_OK:
+        return 0;
+    case SZ_ERROR_MEM:
+        return -ENOMEM;
+    case SZ_ERROR_OUTPUT_EOF:
+        return -ENOSPC;
+    case SZ_ERROR_DATA:
+    case SZ_ERROR_UNSUPPORTED:
+        return -EINVAL;
+    default:
+        return -EIO;
+    }
+}
+
 #endif
@@ -15,4 +15,16 @@
 
 extern int lzmaBuffToBuffDecompress (unsigned char *outStream, SizeT *uncompressedSize,
 			      unsigned char *inStream,  SizeT  length);
+
+struct image_reader;
+
+/*
+ * Same as lzmaBuffToBuffDecompress(), but the compressed data is pulled from
+ * an image reader in IMAGE_STREAM_CHUNK_SIZE pieces while decoding. Returns
+ * 0 on success, -EIO if the data ends early, -EINVAL if it is corrupt and
+ * -ENOSPC if it does not fit in *uncompressedSize.
+ */
+extern int lzmaStreamDecompress(unsigned char *outStream,
+				SizeT *uncompressedSize,
+				struct image_reader *rd);
 #endif
@@ -248,6 +248,11 @@ void sha1_update(sha1_context *ctx, const unsigned char *input,
 		left = 0;
 	}
 
+	if (ilen >= 64 && sha1_ce_blocks(ctx, input, ilen / 64)) {
+		input += ilen & ~0x3F;
+		ilen &= 0x3F;
+	}
+
 	while (ilen >= 64) {
 		sha1_process (ctx, input);
 		input += 64;
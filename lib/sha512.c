@@ -194,6 +194,9 @@ sha512_transform(uint64_t *state, const uint8_t *input)
 static void sha512_block_fn(sha512_context *sst, const uint8_t *src,
 				    int blocks)
 {
+	if (sha512_ce_blocks(sst, src, blocks))
+		return;
+
 	while (blocks--) {
 		sha512_transform(sst->state, src);
 		src += SHA512_BLOCK_SIZE;
@@ -7,6 +7,7 @@
 
 #include <common.h>
 #include <abuf.h>
+#include <image.h>
 #include <log.h>
 #include <malloc.h>
 #include <linux/zstd.h>
@@ -62,3 +63,90 @@ do_free:
 	free(workspace);
 	return ret;
 }
+
+int zstd_decompress_stream(struct image_reader *rd, struct abuf *out)
+{
+	ZSTD_DStream *dstream;
+	ZSTD_inBuffer in_buf;
+	ZSTD_outBuffer out_buf;
+	void *workspace;
+	void *chunk;
+	size_t wsize;
+	long len;
+	int ret;
+
+	chunk = malloc(IMAGE_STREAM_CHUNK_SIZE);
+	if (!chunk)
+		return -ENOMEM;
+
+	wsize = ZSTD_DStreamWorkspaceBound(rd->size);
+	workspace = malloc(wsize);
+	if (!workspace) {
+		debug("%s: cannot allocate workspace of size %zu\n", __func__,
+			wsize);
+		ret = -ENOMEM;
+		goto do_free_chunk;
+	}
+
+	dstream = ZSTD_initDStream(rd->size, workspace, wsize);
+	if (!dstream) {
+		log_err("%s: ZSTD_initDStream failed\n", __func__);
+		ret = -EPERM;
+		goto do_free;
+	}
+
+	in_buf.src = chunk;
+	in_buf.pos = 0;
+	in_buf.size = 0;
+
+	out_buf.dst = abuf_data(out);
+	out_buf.pos = 0;
+	out_buf.size = abuf_size(out);
+
+	while (1) {
+		size_t in_pos, out_pos, res;
+
+		if (in_buf.pos == in_buf.size) {
+			len = image_reader_read(rd, chunk,
+						IMAGE_STREAM_CHUNK_SIZE);
+			if (len < 0) {
+				ret = len;
+				goto do_free;
+			}
+			if (!len) {
+				/* The data ended in the middle of a frame */
+				log_err("ZSTD data is truncated\n");
+				ret = -EIO;
+				goto do_free;
+			}
+			in_buf.pos = 0;
+			in_buf.size = len;
+		}
+
+		in_pos = in_buf.pos;
+		out_pos = out_buf.pos;
+		res = ZSTD_decompressStream(dstream, &out_buf, &in_buf);
+		if (ZSTD_isError(res)) {
+			log_err("ZSTD_decompressStream error %d\n",
+				ZSTD_getErrorCode(res));
+			ret = -EIO;
+			goto do_free;
+		}
+
+		if (!res)
+			break;
+
+		/* No progress is possible once the output buffer is full */
+		if (in_buf.pos == in_pos && out_buf.pos == out_pos) {
+			ret = -ENOSPC;
+			goto do_free;
+		}
+	}
+
+	ret = out_buf.pos;
+do_free:
+	free(workspace);
+do_free_chunk:
+	free(chunk);
+	return ret;
+}
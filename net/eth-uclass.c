@@ -26,10 +26,14 @@ DECLARE_GLOBAL_DATA_PTR;
  * struct eth_device_priv - private structure for each Ethernet device
  *
  * @state: The state of the Ethernet MAC driver (defined by enum eth_state_t)
+ * @stats: Receive statistics, if CONFIG_NET_RX_STATS is enabled
  */
 struct eth_device_priv {
 	enum eth_state_t state;
 	bool running;
+#if CONFIG_IS_ENABLED(NET_RX_STATS)
+	struct eth_rx_stats stats;
+#endif
 };
 
 /**
@@ -378,13 +382,42 @@ int eth_send(void *packet, int length)
 	return ret;
 }
 
+struct eth_rx_stats *eth_get_rx_stats(struct udevice *dev)
+{
+#if CONFIG_IS_ENABLED(NET_RX_STATS)
+	struct eth_device_priv *priv = dev_get_uclass_priv(dev);
+
+	return &priv->stats;
+#else
+	return NULL;
+#endif
+}
+
+static void eth_rx_count(struct udevice *dev, int frames, int ret)
+{
+	struct eth_rx_stats *stats = eth_get_rx_stats(dev);
+
+	if (!stats)
+		return;
+
+	stats->polls++;
+	stats->frames += frames;
+	if (frames > stats->max_frames)
+		stats->max_frames = frames;
+	if (frames == ETH_PACKETS_BATCH_RECV)
+		stats->budget_hits++;
+	if (ret < 0 && ret != -EAGAIN)
+		stats->errors++;
+}
+
 int eth_rx(void)
 {
 	struct udevice *current;
+	const struct eth_ops *ops;
 	uchar *packet;
+	int frames = 0;
 	int flags;
 	int ret;
-	int i;
 
 	current = eth_get_dev();
 	if (!current)
@@ -393,18 +426,24 @@ int eth_rx(void)
 	if (!eth_is_active(current))
 		return -EINVAL;
 
-	/* Process up to 32 packets at one time */
+	/*
+	 * Drain the driver, up to CONFIG_NET_RX_BUDGET frames, so that a full
+	 * receive ring is emptied before the timeouts are checked again
+	 */
+	ops = eth_get_ops(current);
 	flags = ETH_RECV_CHECK_DEVICE;
-	for (i = 0; i < ETH_PACKETS_BATCH_RECV; i++) {
-		ret = eth_get_ops(current)->recv(current, flags, &packet);
+	do {
+		ret = ops->recv(current, flags, &packet);
 		flags = 0;
-		if (ret > 0)
+		if (ret > 0) {
 			net_process_received_packet(packet, ret);
-		if (ret >= 0 && eth_get_ops(current)->free_pkt)
-			eth_get_ops(current)->free_pkt(current, packet, ret);
-		if (ret <= 0)
-			break;
-	}
+			frames++;
+		}
+		if (ret >= 0 && ops->free_pkt)
+			ops->free_pkt(current, packet, ret);
+	} while (ret > 0 && frames < ETH_PACKETS_BATCH_RECV);
+
+	eth_rx_count(current, frames, ret);
 	if (ret == -EAGAIN)
 		ret = 0;
 	if (ret < 0) {
@@ -22,8 +22,17 @@ struct __packed fastboot_header {
 	unsigned short seq;
 };
 
-#define PACKET_SIZE 1024
-#define DATA_SIZE (PACKET_SIZE - sizeof(struct fastboot_header))
+/*
+ * Largest packet we accept, which is offered to the host in the INIT reply.
+ * The protocol has only one packet in flight, so this sets the number of
+ * round trips needed for a download. With IP_DEFRAG a packet can span
+ * several Ethernet frames, otherwise it has to fit in one.
+ */
+#ifdef CONFIG_IP_DEFRAG
+#define PACKET_SIZE	(CONFIG_NET_MAXDEFRAG - IP_UDP_HDR_SIZE)
+#else
+#define PACKET_SIZE	(1500 - IP_UDP_HDR_SIZE)
+#endif
 
 /* Sequence number sent for every packet */
 static unsigned short sequence_number = 1;
@@ -31,7 +40,8 @@ static const unsigned short packet_size = PACKET_SIZE;
 static const unsigned short udp_version = 1;
 
 /* Keep track of last packet for resubmission */
-static uchar last_packet[PACKET_SIZE];
+static uchar last_packet[sizeof(struct fastboot_header) +
+			 FASTBOOT_RESPONSE_LEN];
 static unsigned int last_packet_len;
 
 static struct in_addr fastboot_remote_ip;
@@ -110,11 +120,11 @@ static void fastboot_timed_send_info(const char *msg)
  * fastboot_send() - Sends a packet in response to received fastboot packet
  *
  * @header: Header for response packet
- * @fastboot_data: Pointer to received fastboot data
+ * @fastboot_data: Pointer to received fastboot data, in the received packet
  * @fastboot_data_len: Length of received fastboot data
  * @retransmit: Nonzero if sending last sent packet
  */
-static void fastboot_send(struct fastboot_header header, char *fastboot_data,
+static void fastboot_send(struct fastboot_header header, uchar *fastboot_data,
 			  unsigned int fastboot_data_len, uchar retransmit)
 {
 	uchar *packet;
@@ -176,9 +186,10 @@ static void fastboot_send(struct fastboot_header header, char *fastboot_data,
 						       response);
 			}
 		} else if (!pending_command) {
-			strlcpy(command, fastboot_data,
-				min((size_t)fastboot_data_len + 1,
-				    sizeof(command)));
+			fastboot_data_len = min((size_t)fastboot_data_len,
+						sizeof(command) - 1);
+			memcpy(command, fastboot_data, fastboot_data_len);
+			command[fastboot_data_len] = '\0';
 			pending_command = true;
 		} else {
 			cmd = fastboot_handle_command(command, response);
@@ -261,8 +272,6 @@ static void fastboot_handler(uchar *packet, unsigned int dport,
 			     unsigned int len)
 {
 	struct fastboot_header header;
-	char fastboot_data[DATA_SIZE] = {0};
-	unsigned int fastboot_data_len = 0;
 
 	if (dport != fastboot_our_port)
 		return;
@@ -280,27 +289,23 @@ static void fastboot_handler(uchar *packet, unsigned int dport,
 
 	switch (header.id) {
 	case FASTBOOT_QUERY:
-		fastboot_send(header, fastboot_data, 0, 0);
+		fastboot_send(header, packet, 0, 0);
 		break;
 	case FASTBOOT_INIT:
 	case FASTBOOT_FASTBOOT:
-		fastboot_data_len = len;
-		if (len > 0)
-			memcpy(fastboot_data, packet, len);
+		/* Download data is copied straight from the packet */
 		if (header.seq == sequence_number) {
-			fastboot_send(header, fastboot_data,
-				      fastboot_data_len, 0);
+			fastboot_send(header, packet, len, 0);
 			sequence_number++;
 		} else if (header.seq == sequence_number - 1) {
 			/* Retransmit last sent packet */
-			fastboot_send(header, fastboot_data,
-				      fastboot_data_len, 1);
+			fastboot_send(header, packet, len, 1);
 		}
 		break;
 	default:
 		pr_err("ID %d not implemented.\n", header.id);
 		header.id = FASTBOOT_ERROR;
-		fastboot_send(header, fastboot_data, 0, 0);
+		fastboot_send(header, packet, 0, 0);
 		break;
 	}
 }
@@ -49,10 +49,36 @@
 #define NFS_RPC_ERR	1
 #define NFS_RPC_DROP	124
 
+/* Bytes received for each "loading" hash */
+#define NFS_HASH_BYTES	((NFS_READ_SIZE / 2) * 10)
+/* Send a read again once this many later reads have been answered */
+#define NFS_READ_OVERTAKEN	3
+
+/**
+ * struct nfs_read - a read request waiting for its reply
+ *
+ * @id:		XID of the request, which the reply carries
+ * @offset:	Offset in the file
+ * @len:	Number of bytes requested
+ * @overtaken:	Number of replies received for reads sent after this one
+ * @busy:	true if the request is waiting for a reply
+ */
+struct nfs_read {
+	unsigned long id;
+	u32 offset;
+	u32 len;
+	int overtaken;
+	bool busy;
+};
+
 static int fs_mounted;
 static unsigned long rpc_id;
-static int nfs_offset = -1;
-static int nfs_len;
+static u32 nfs_offset;		/* offset of the next read to send */
+static u32 nfs_read_size;
+static u32 nfs_file_end;	/* file size, once a read has reached it */
+static u32 nfs_received;
+static int nfs_num_hash;
+static struct nfs_read nfs_reads[CONFIG_NFS_READ_WINDOW];
 static ulong nfs_timeout = NFS_TIMEOUT;
 
 static char dirfh[NFS_FHSIZE];	/* NFSv2 / NFSv3 file handle of directory */
@@ -391,11 +417,71 @@ static void nfs_read_req(int offset, int readlen)
 	rpc_req(PROG_NFS, NFS_READ, data, len);
 }
 
+static void nfs_read_send(struct nfs_read *rd)
+{
+	nfs_read_req(rd->offset, rd->len);
+	rd->id = rpc_id;
+	rd->overtaken = 0;
+	rd->busy = true;
+}
+
+/* Keep CONFIG_NFS_READ_WINDOW reads in flight until the end of the file */
+static void nfs_read_fill(void)
+{
+	struct nfs_read *rd;
+
+	for (rd = nfs_reads; rd < nfs_reads + ARRAY_SIZE(nfs_reads); rd++) {
+		if (nfs_offset >= nfs_file_end)
+			break;
+		if (rd->busy)
+			continue;
+		rd->offset = nfs_offset;
+		rd->len = nfs_read_size;
+		nfs_read_send(rd);
+		nfs_offset += nfs_read_size;
+	}
+}
+
+static void nfs_read_start(void)
+{
+	memset(nfs_reads, '\0', sizeof(nfs_reads));
+	nfs_offset = 0;
+	nfs_file_end = U32_MAX;
+	nfs_received = 0;
+	nfs_num_hash = 0;
+	if (supported_nfs_versions & NFSV2_FLAG)
+		nfs_read_size = min(NFS_READ_MAX, NFS2_READ_MAX);
+	else  /* NFSV3_FLAG */
+		nfs_read_size = NFS_READ_MAX;
+
+	nfs_state = STATE_READ_REQ;
+	nfs_read_fill();
+}
+
+/* Check whether all reads up to the end of the file have been answered */
+static bool nfs_read_done(void)
+{
+	struct nfs_read *rd;
+	bool done = true;
+
+	for (rd = nfs_reads; rd < nfs_reads + ARRAY_SIZE(nfs_reads); rd++) {
+		/* Forget reads past the end; their replies are dropped */
+		if (rd->busy && rd->offset >= nfs_file_end)
+			rd->busy = false;
+		if (rd->busy)
+			done = false;
+	}
+
+	return done;
+}
+
 /**************************************************************************
 RPC request dispatcher
 **************************************************************************/
 static void nfs_send(void)
 {
+	int i;
+
 	debug("%s\n", __func__);
 
 	switch (nfs_state) {
@@ -421,7 +507,10 @@ static void nfs_send(void)
 		nfs_lookup_req(nfs_filename);
 		break;
 	case STATE_READ_REQ:
-		nfs_read_req(nfs_offset, nfs_len);
+		for (i = 0; i < ARRAY_SIZE(nfs_reads); i++) {
+			if (nfs_reads[i].busy)
+				nfs_read_send(&nfs_reads[i]);
+		}
 		break;
 	case STATE_READLINK_REQ:
 		nfs_readlink_req();
@@ -665,16 +754,26 @@ static int nfs_readlink_reply(uchar *pkt, unsigned len)
 static int nfs_read_reply(uchar *pkt, unsigned len)
 {
 	struct rpc_t rpc_pkt;
+	struct nfs_read *rd, *other;
+	unsigned long id;
+	unsigned hdr_len;
 	int rlen;
+	bool eof;
 	uchar *data_ptr;
 
 	debug("%s\n", __func__);
 
-	memcpy(&rpc_pkt.u.data[0], pkt, sizeof(rpc_pkt.u.reply));
+	/* Only copy the headers; the data is stored from the packet */
+	memcpy(&rpc_pkt.u.data[0], pkt,
+	       min_t(uint, len, (6 + NFS_MAX_ATTRS) * sizeof(uint32_t)));
 
-	if (ntohl(rpc_pkt.u.reply.id) > rpc_id)
-		return -NFS_RPC_ERR;
-	else if (ntohl(rpc_pkt.u.reply.id) < rpc_id)
+	/* Several reads can be in flight, find the one this answers */
+	id = ntohl(rpc_pkt.u.reply.id);
+	for (rd = nfs_reads; rd < nfs_reads + ARRAY_SIZE(nfs_reads); rd++) {
+		if (rd->busy && rd->id == id)
+			break;
+	}
+	if (rd == nfs_reads + ARRAY_SIZE(nfs_reads))
 		return -NFS_RPC_DROP;
 
 	if (rpc_pkt.u.reply.rstatus  ||
@@ -688,34 +787,61 @@ static int nfs_read_reply(uchar *pkt, unsigned len)
 		return -ntohl(rpc_pkt.u.reply.data[0]);
 	}
 
-	if ((nfs_offset != 0) && !((nfs_offset) %
-			(NFS_READ_SIZE / 2 * 10 * HASHES_PER_LINE)))
-		puts("\n\t ");
-	if (!(nfs_offset % ((NFS_READ_SIZE / 2) * 10)))
-		putc('#');
-
 	if (supported_nfs_versions & NFSV2_FLAG) {
 		rlen = ntohl(rpc_pkt.u.reply.data[18]);
 		data_ptr = (uchar *)&(rpc_pkt.u.reply.data[19]);
+		/* NFSv2 has no EOF flag, a short read means the end */
+		eof = rlen < rd->len;
 	} else {  /* NFSV3_FLAG */
 		int nfsv3_data_offset =
 			nfs3_get_attributes_offset(rpc_pkt.u.reply.data);
 
 		/* count value */
 		rlen = ntohl(rpc_pkt.u.reply.data[1 + nfsv3_data_offset]);
+		eof = rpc_pkt.u.reply.data[2 + nfsv3_data_offset];
 		/* Skip unused values :
-			EOF:		32 bits value,
 			data_size:	32 bits value,
 		*/
 		data_ptr = (uchar *)
 			&(rpc_pkt.u.reply.data[4 + nfsv3_data_offset]);
 	}
 
-	if (((uchar *)&(rpc_pkt.u.reply.data[0]) - (uchar *)(&rpc_pkt) + rlen) > len)
-			return -9999;
+	hdr_len = data_ptr - (uchar *)&rpc_pkt;
+	if (rlen < 0 || rlen > rd->len || hdr_len + rlen > len)
+		return -9999;
+
+	/* An empty read past the end must not change the file size */
+	if (rlen && store_block(pkt + hdr_len, rd->offset, rlen))
+		return -9999;
+
+	rd->busy = false;
+	nfs_received += rlen;
+	if (eof || !rlen) {
+		nfs_file_end = min(nfs_file_end, rd->offset + rlen);
+	} else if (rlen < rd->len) {
+		/* The server may return less than asked; get the rest */
+		rd->offset += rlen;
+		rd->len -= rlen;
+		nfs_read_send(rd);
+	}
 
-	if (store_block(data_ptr, nfs_offset, rlen))
-			return -9999;
+	for (; nfs_num_hash < nfs_received / NFS_HASH_BYTES; nfs_num_hash++) {
+		if (nfs_num_hash && !(nfs_num_hash % HASHES_PER_LINE))
+			puts("\n\t ");
+		putc('#');
+	}
+
+	/*
+	 * Replies mostly arrive in the order of the requests, so a read which
+	 * is still waiting after several later ones were answered has likely
+	 * been lost. Send it again rather than waiting for the timeout.
+	 */
+	for (other = nfs_reads; other < nfs_reads + ARRAY_SIZE(nfs_reads);
+	     other++) {
+		if (other->busy && (long)(other->id - id) < 0 &&
+		    ++other->overtaken >= NFS_READ_OVERTAKEN)
+			nfs_read_send(other);
+	}
 
 	return rlen;
 }
@@ -745,7 +871,9 @@ static void nfs_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 
 	debug("%s\n", __func__);
 
-	if (len > sizeof(struct rpc_t))
+	/* Only the headers of a read reply are copied, it may be larger */
+	if (len > sizeof(struct rpc_t) +
+	    (nfs_state == STATE_READ_REQ ? NFS_READ_MAX - NFS_READ_SIZE : 0))
 		return;
 
 	if (dest != nfs_our_port)
@@ -811,10 +939,7 @@ static void nfs_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			nfs_state = STATE_PRCLOOKUP_PROG_MOUNT_REQ;
 			nfs_send();
 		} else {
-			nfs_state = STATE_READ_REQ;
-			nfs_offset = 0;
-			nfs_len = NFS_READ_SIZE;
-			nfs_send();
+			nfs_read_start();
 		}
 		break;
 
@@ -841,18 +966,19 @@ static void nfs_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 		if (rlen == -NFS_RPC_DROP)
 			break;
 		net_set_timeout_handler(nfs_timeout, nfs_timeout_handler);
-		if (rlen > 0) {
-			nfs_offset += rlen;
-			nfs_send();
+		if (rlen >= 0) {
+			nfs_read_fill();
+			if (nfs_read_done()) {
+				nfs_download_state = NETLOOP_SUCCESS;
+				nfs_state = STATE_UMOUNT_REQ;
+				nfs_send();
+			}
 		} else if ((rlen == -NFSERR_ISDIR) || (rlen == -NFSERR_INVAL)) {
 			/* symbolic link */
 			nfs_state = STATE_READLINK_REQ;
 			nfs_send();
 		} else {
-			if (!rlen)
-				nfs_download_state = NETLOOP_SUCCESS;
-			if (rlen < 0)
-				debug("NFS READ error (%d)\n", rlen);
+			debug("NFS READ error (%d)\n", rlen);
 			nfs_state = STATE_UMOUNT_REQ;
 			nfs_send();
 		}
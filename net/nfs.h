@@ -44,6 +44,31 @@
 #define NFS_READ_SIZE	1024	/* biggest power of two that fits Ether frame */
 #define NFS_MAX_ATTRS	26
 
+/*
+ * With CONFIG_IP_DEFRAG, read in the biggest power of two whose reply still
+ * fits in the reassembly buffer, leaving room for the IP, UDP, RPC and NFS
+ * headers in front of the data.
+ */
+#define NFS_READ_OVERHEAD	256
+#ifdef CONFIG_IP_DEFRAG
+#define NFS_DEFRAG_ROOM	(CONFIG_NET_MAXDEFRAG - NFS_READ_OVERHEAD)
+#else
+#define NFS_DEFRAG_ROOM	0
+#endif
+#if NFS_DEFRAG_ROOM >= 32768
+#define NFS_READ_MAX	32768
+#elif NFS_DEFRAG_ROOM >= 16384
+#define NFS_READ_MAX	16384
+#elif NFS_DEFRAG_ROOM >= 8192
+#define NFS_READ_MAX	8192
+#elif NFS_DEFRAG_ROOM >= 4096
+#define NFS_READ_MAX	4096
+#else
+#define NFS_READ_MAX	NFS_READ_SIZE
+#endif
+/* NFSv2 cannot read more than this at once (RFC 1094) */
+#define NFS2_READ_MAX	8192
+
 /* Values for Accept State flag on RPC answers (See: rfc1831) */
 enum rpc_accept_stat {
 	NFS_RPC_SUCCESS = 0,	/* RPC executed successfully */
@@ -0,0 +1,576 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Minimal TCP client
+ *
+ * This is enough TCP to download a large file quickly: one connection,
+ * opened by U-Boot, which mostly receives. Incoming data is handed to the
+ * user as it arrives, so the receive window never fills up and can be made
+ * large with window scaling (RFC 7323). Segments which arrive ahead of a
+ * lost one are kept and reported with selective acknowledgements (RFC 2018),
+ * so the sender only repeats what was really lost. Every second segment is
+ * acknowledged, or after a short delay (RFC 1122).
+ *
+ * Sending is kept simple: only one segment is in flight at a time, which
+ * suits a request/response protocol.
+ */
+
+#include <common.h>
+#include <net.h>
+#include <time.h>
+#include <asm/unaligned.h>
+#include <net/tcp.h>
+
+enum tcp_state {
+	TCP_CLOSED,
+	TCP_SYN_SENT,
+	TCP_ESTABLISHED,
+	TCP_FIN_WAIT,		/* we have closed, the remote has not */
+};
+
+/* Interval of the TCP timer */
+#define TCP_TICK_MS		10
+/* Longest time that received data is left unacknowledged */
+#define TCP_ACK_DELAY_MS	20
+/* Retransmission timeout, doubled on each retry */
+#define TCP_RTO_MS		500
+#define TCP_RTO_MAX_MS		8000
+#define TCP_RETRIES		8
+/* Give up if the remote sends nothing for this long */
+#define TCP_IDLE_TIMEOUT_MS	30000
+/* Ranges of data received ahead of the stream which are remembered */
+#define TCP_SACK_MAX		8
+/* Ranges reported in each acknowledgement, as fit in the option space */
+#define TCP_SACK_REPORT		4
+
+#define TCP_RCV_WND		CONFIG_TCP_RX_WINDOW
+
+struct tcp_sack_block {
+	u32 start;
+	u32 end;
+};
+
+static enum tcp_state tcp_state;
+static const struct tcp_ops *tcp_ops;
+static struct in_addr tcp_remote_ip;
+static uchar tcp_remote_ethaddr[ARP_HLEN];
+static int tcp_remote_port;
+static int tcp_our_port;
+
+/* Send side */
+static u32 tcp_iss;		/* our initial sequence number */
+static u32 tcp_snd_una;		/* oldest unacknowledged sequence number */
+static u32 tcp_snd_nxt;		/* next sequence number to send */
+static uint tcp_peer_mss;
+static uchar tcp_tx_buf[TCP_MSS];
+static uint tcp_tx_len;		/* bytes in tcp_tx_buf, from tcp_snd_una */
+static ulong tcp_rto_start;
+static ulong tcp_rto;
+static int tcp_retries;
+
+/* Receive side */
+static u32 tcp_irs;		/* remote initial sequence number */
+static u32 tcp_rcv_nxt;		/* next sequence number expected */
+static bool tcp_ws_ok;		/* the remote agreed to window scaling */
+static bool tcp_sack_ok;	/* the remote accepts SACK options */
+static bool tcp_fin_rcvd;
+static u32 tcp_fin_seq;
+/* Data received ahead of tcp_rcv_nxt, most recent first */
+static struct tcp_sack_block tcp_sack[TCP_SACK_MAX];
+static int tcp_sack_count;
+static int tcp_ack_pending;	/* segments received but not acknowledged */
+static ulong tcp_ack_start;	/* when the first of those was received */
+static ulong tcp_rx_time;	/* when a segment was last received */
+
+static inline bool tcp_before(u32 a, u32 b)
+{
+	return (s32)(a - b) < 0;
+}
+
+/* Smallest window scale which lets TCP_RCV_WND fit in 16 bits */
+static u8 tcp_wscale(void)
+{
+	u8 shift = 0;
+
+	while ((TCP_RCV_WND >> shift) > 0xffff && shift < 14)
+		shift++;
+
+	return shift;
+}
+
+/* Receive window in bytes, as the remote sees it */
+static u32 tcp_rcv_wnd(void)
+{
+	u8 shift = tcp_wscale();
+
+	if (!tcp_ws_ok)
+		return min(TCP_RCV_WND, 0xffff);
+
+	return min(TCP_RCV_WND >> shift, 0xffff) << shift;
+}
+
+static int tcp_opt_len(u8 action)
+{
+	/* MSS, window scale and SACK permitted, padded to 12 bytes */
+	if (action & TCP_SYN)
+		return 12;
+	if (tcp_sack_ok && tcp_sack_count)
+		return 4 + 8 * min(tcp_sack_count, TCP_SACK_REPORT);
+
+	return 0;
+}
+
+int tcp_hdr_size(u8 action)
+{
+	return IP_TCP_HDR_SIZE + tcp_opt_len(action);
+}
+
+/* Checksum over the pseudo-header and TCP segment, 0 if a segment is valid */
+static u16 tcp_checksum(struct ip_tcp_hdr *ip, int tcp_len)
+{
+	__be32 ph[3];
+
+	net_copy_ip(&ph[0], &ip->ip_src);
+	net_copy_ip(&ph[1], &ip->ip_dst);
+	ph[2] = htonl(IPPROTO_TCP << 16 | tcp_len);
+
+	return add_ip_checksums(sizeof(ph), compute_ip_checksum(ph, sizeof(ph)),
+				compute_ip_checksum(&ip->tcp_src, tcp_len));
+}
+
+int tcp_set_tcp_header(uchar *pkt, struct in_addr dest, int dport, int sport,
+		       int payload_len, u8 action, u32 tcp_seq_num,
+		       u32 tcp_ack_num)
+{
+	struct ip_tcp_hdr *ip = (struct ip_tcp_hdr *)pkt;
+	uchar *opt = pkt + IP_TCP_HDR_SIZE;
+	int opt_len = tcp_opt_len(action);
+	int tcp_len = TCP_HDR_SIZE + opt_len + payload_len;
+	int i, n;
+
+	net_set_ip_header(pkt, dest, net_ip, IP_HDR_SIZE + tcp_len,
+			  IPPROTO_TCP);
+
+	ip->tcp_src = htons(sport);
+	ip->tcp_dst = htons(dport);
+	ip->tcp_seq = htonl(tcp_seq_num);
+	ip->tcp_ack = action & TCP_ACK ? htonl(tcp_ack_num) : 0;
+	ip->tcp_hlen = (TCP_HDR_SIZE + opt_len) / 4 << 4;
+	ip->tcp_flags = action;
+	ip->tcp_xsum = 0;
+	ip->tcp_ugr = 0;
+
+	if (action & TCP_SYN) {
+		/* The window in a SYN is never scaled */
+		ip->tcp_win = htons(min(TCP_RCV_WND, 0xffff));
+		*opt++ = TCP_O_MSS;
+		*opt++ = 4;
+		put_unaligned_be16(TCP_MSS, opt);
+		opt += 2;
+		*opt++ = TCP_O_NOP;
+		*opt++ = TCP_O_WS;
+		*opt++ = 3;
+		*opt++ = tcp_wscale();
+		*opt++ = TCP_O_NOP;
+		*opt++ = TCP_O_NOP;
+		*opt++ = TCP_O_SACK_PERM;
+		*opt++ = 2;
+	} else {
+		ip->tcp_win = htons(tcp_rcv_wnd() >>
+				    (tcp_ws_ok ? tcp_wscale() : 0));
+		if (opt_len) {
+			n = (opt_len - 4) / 8;
+			*opt++ = TCP_O_NOP;
+			*opt++ = TCP_O_NOP;
+			*opt++ = TCP_O_SACK;
+			*opt++ = 2 + 8 * n;
+			for (i = 0; i < n; i++) {
+				put_unaligned_be32(tcp_sack[i].start, opt);
+				put_unaligned_be32(tcp_sack[i].end, opt + 4);
+				opt += 8;
+			}
+		}
+	}
+	ip->tcp_xsum = tcp_checksum(ip, tcp_len);
+
+	return IP_TCP_HDR_SIZE + opt_len;
+}
+
+static void tcp_send_segment(u8 action, u32 seq, const void *data, uint len)
+{
+	uchar *pkt = net_tx_packet + net_eth_hdr_size() + tcp_hdr_size(action);
+
+	if (len)
+		memcpy(pkt, data, len);
+	/* Every segment but the first carries an acknowledgement */
+	if (action & TCP_ACK)
+		tcp_ack_pending = 0;
+	net_send_ip_packet(tcp_remote_ethaddr, tcp_remote_ip, tcp_remote_port,
+			   tcp_our_port, len, IPPROTO_TCP, action, seq,
+			   tcp_rcv_nxt);
+}
+
+static void tcp_send_ack(void)
+{
+	tcp_send_segment(TCP_ACK, tcp_snd_nxt, NULL, 0);
+}
+
+/* Send whatever has not been acknowledged yet */
+static void tcp_retransmit(void)
+{
+	u8 action = TCP_ACK;
+
+	if (tcp_state == TCP_SYN_SENT) {
+		tcp_send_segment(TCP_SYN, tcp_iss, NULL, 0);
+		return;
+	}
+	if (tcp_tx_len)
+		action |= TCP_PUSH;
+	/* Our FIN is the last sequence number in flight */
+	if (tcp_state == TCP_FIN_WAIT)
+		action |= TCP_FIN;
+	tcp_send_segment(action, tcp_snd_una, tcp_tx_buf, tcp_tx_len);
+}
+
+static void tcp_start_rto(void)
+{
+	tcp_rto_start = get_timer(0);
+	tcp_rto = TCP_RTO_MS;
+	tcp_retries = 0;
+}
+
+static void tcp_finish(int err)
+{
+	tcp_state = TCP_CLOSED;
+	tcp_ops->closed(err);
+}
+
+static void tcp_tick(void)
+{
+	ulong now = get_timer(0);
+
+	if (tcp_state == TCP_CLOSED)
+		return;
+
+	if (now - tcp_rx_time >= TCP_IDLE_TIMEOUT_MS) {
+		tcp_finish(-ETIMEDOUT);
+		return;
+	}
+	if (tcp_ack_pending && now - tcp_ack_start >= TCP_ACK_DELAY_MS)
+		tcp_send_ack();
+	if (tcp_snd_una != tcp_snd_nxt && now - tcp_rto_start >= tcp_rto) {
+		if (++tcp_retries > TCP_RETRIES) {
+			tcp_finish(-ETIMEDOUT);
+			return;
+		}
+		tcp_rto_start = now;
+		tcp_rto = min(tcp_rto * 2, (ulong)TCP_RTO_MAX_MS);
+		tcp_retransmit();
+	}
+
+	net_set_timeout_handler(TCP_TICK_MS, tcp_tick);
+}
+
+int tcp_connect(struct in_addr dest, int dport, const struct tcp_ops *ops)
+{
+	ulong now = get_timer(0);
+
+	if (!ops || !ops->rx || !ops->closed)
+		return -EINVAL;
+
+	tcp_ops = ops;
+	tcp_remote_ip = dest;
+	tcp_remote_port = dport;
+	/* Zero the remote's MAC address so that it is looked up with ARP */
+	memset(tcp_remote_ethaddr, '\0', ARP_HLEN);
+	/* Use a pseudo-random port and initial sequence number */
+	tcp_our_port = 49152 + (now % 16384);
+	tcp_iss = get_ticks();
+
+	tcp_snd_una = tcp_iss;
+	tcp_snd_nxt = tcp_iss + 1;
+	tcp_tx_len = 0;
+	tcp_peer_mss = TCP_MIN_MSS;
+	tcp_rcv_nxt = 0;
+	tcp_ws_ok = false;
+	tcp_sack_ok = false;
+	tcp_fin_rcvd = false;
+	tcp_sack_count = 0;
+	tcp_ack_pending = 0;
+	tcp_rx_time = now;
+
+	tcp_state = TCP_SYN_SENT;
+	tcp_start_rto();
+	tcp_send_segment(TCP_SYN, tcp_iss, NULL, 0);
+	net_set_timeout_handler(TCP_TICK_MS, tcp_tick);
+
+	return 0;
+}
+
+int tcp_send(const void *data, unsigned int len)
+{
+	if (tcp_state != TCP_ESTABLISHED)
+		return -ENOTCONN;
+	if (tcp_snd_una != tcp_snd_nxt)
+		return -EBUSY;
+	if (len > min(tcp_peer_mss, (uint)TCP_MSS))
+		return -EMSGSIZE;
+
+	memcpy(tcp_tx_buf, data, len);
+	tcp_tx_len = len;
+	tcp_snd_nxt += len;
+	tcp_start_rto();
+	tcp_send_segment(TCP_ACK | TCP_PUSH, tcp_snd_una, tcp_tx_buf, len);
+
+	return 0;
+}
+
+void tcp_close(void)
+{
+	if (tcp_state != TCP_ESTABLISHED)
+		return;
+
+	tcp_state = TCP_FIN_WAIT;
+	if (tcp_snd_una == tcp_snd_nxt)
+		tcp_start_rto();
+	tcp_snd_nxt++;
+	tcp_send_segment(TCP_ACK | TCP_FIN, tcp_snd_nxt - 1, NULL, 0);
+}
+
+void tcp_abort(void)
+{
+	if (tcp_state == TCP_ESTABLISHED || tcp_state == TCP_FIN_WAIT)
+		tcp_send_segment(TCP_RST | TCP_ACK, tcp_snd_nxt, NULL, 0);
+	tcp_state = TCP_CLOSED;
+	tcp_ops = NULL;
+}
+
+static void tcp_parse_syn_options(const uchar *opt, int len)
+{
+	int olen;
+
+	while (len > 0 && *opt != TCP_O_END) {
+		if (*opt == TCP_O_NOP) {
+			opt++;
+			len--;
+			continue;
+		}
+		if (len < 2 || opt[1] < 2 || opt[1] > len)
+			break;
+		olen = opt[1];
+		if (*opt == TCP_O_MSS && olen == 4)
+			tcp_peer_mss = get_unaligned_be16(opt + 2);
+		else if (*opt == TCP_O_WS && olen == 3)
+			tcp_ws_ok = true;
+		else if (*opt == TCP_O_SACK_PERM && olen == 2)
+			tcp_sack_ok = true;
+		opt += olen;
+		len -= olen;
+	}
+}
+
+static void tcp_process_ack(u32 ack)
+{
+	u32 acked;
+
+	/* Ignore old acknowledgements and ones for data never sent */
+	if (!tcp_before(tcp_snd_una, ack) || tcp_before(tcp_snd_nxt, ack))
+		return;
+
+	acked = min(ack - tcp_snd_una, tcp_tx_len);
+	memmove(tcp_tx_buf, tcp_tx_buf + acked, tcp_tx_len - acked);
+	tcp_tx_len -= acked;
+	tcp_snd_una = ack;
+	tcp_start_rto();
+}
+
+/* Remember data received ahead of the stream, merging adjacent ranges */
+static void tcp_sack_add(u32 start, u32 end)
+{
+	struct tcp_sack_block *blk;
+	int i;
+
+	for (i = 0; i < tcp_sack_count; ) {
+		blk = &tcp_sack[i];
+		if (tcp_before(end, blk->start) || tcp_before(blk->end, start)) {
+			i++;
+			continue;
+		}
+		if (tcp_before(blk->start, start))
+			start = blk->start;
+		if (tcp_before(end, blk->end))
+			end = blk->end;
+		tcp_sack_count--;
+		memmove(blk, blk + 1, (tcp_sack_count - i) * sizeof(*blk));
+	}
+
+	/* The newest range is reported first; forget the oldest if full */
+	if (tcp_sack_count == TCP_SACK_MAX)
+		tcp_sack_count--;
+	memmove(tcp_sack + 1, tcp_sack, tcp_sack_count * sizeof(*tcp_sack));
+	tcp_sack[0].start = start;
+	tcp_sack[0].end = end;
+	tcp_sack_count++;
+}
+
+/*
+ * Move tcp_rcv_nxt over ranges received earlier which now join the stream.
+ * Ranges do not touch each other, so one pass is enough.
+ */
+static bool tcp_sack_take(void)
+{
+	struct tcp_sack_block *blk;
+	bool took = false;
+	int i;
+
+	for (i = 0; i < tcp_sack_count; ) {
+		blk = &tcp_sack[i];
+		if (tcp_before(tcp_rcv_nxt, blk->start)) {
+			i++;
+			continue;
+		}
+		if (tcp_before(tcp_rcv_nxt, blk->end))
+			tcp_rcv_nxt = blk->end;
+		tcp_sack_count--;
+		memmove(blk, blk + 1, (tcp_sack_count - i) * sizeof(*blk));
+		took = true;
+	}
+
+	return took;
+}
+
+static void tcp_rx_data(u32 seq, const uchar *data, uint len, bool fin)
+{
+	u32 wnd = tcp_rcv_wnd();
+	u32 off;
+	bool took;
+
+	/* Drop what was received before */
+	if (tcp_before(seq, tcp_rcv_nxt)) {
+		off = tcp_rcv_nxt - seq;
+		if (off > len || (off == len && !fin)) {
+			/* Our acknowledgement may have been lost */
+			tcp_send_ack();
+			return;
+		}
+		data += off;
+		len -= off;
+		seq = tcp_rcv_nxt;
+	}
+
+	/* ...and what does not fit in the window */
+	off = seq - tcp_rcv_nxt;
+	if (off >= wnd) {
+		tcp_send_ack();
+		return;
+	}
+	if (len > wnd - off) {
+		len = wnd - off;
+		fin = false;
+	}
+
+	if (len && !tcp_ops->rx(seq - tcp_irs - 1, data, len))
+		return;
+	/* The user may have dropped the connection */
+	if (tcp_state == TCP_CLOSED)
+		return;
+	if (fin) {
+		tcp_fin_rcvd = true;
+		tcp_fin_seq = seq + len;
+	}
+
+	if (off) {
+		/* A segment is missing: tell the remote straight away */
+		if (len)
+			tcp_sack_add(seq, seq + len);
+		tcp_send_ack();
+		return;
+	}
+
+	tcp_rcv_nxt += len;
+	took = tcp_sack_take();
+	if (tcp_ops->received)
+		tcp_ops->received(tcp_rcv_nxt - tcp_irs - 1);
+	if (tcp_state == TCP_CLOSED)
+		return;
+
+	if (tcp_fin_rcvd && tcp_rcv_nxt == tcp_fin_seq) {
+		tcp_rcv_nxt++;
+		if (tcp_state == TCP_ESTABLISHED) {
+			/* Close our side too; there is nothing more to send */
+			tcp_snd_nxt++;
+			tcp_send_segment(TCP_ACK | TCP_FIN, tcp_snd_nxt - 1,
+					 NULL, 0);
+		} else {
+			tcp_send_ack();
+		}
+		tcp_finish(0);
+		return;
+	}
+
+	/* Acknowledge a filled gap at once, else every second segment */
+	if (took || tcp_sack_count || ++tcp_ack_pending >= 2)
+		tcp_send_ack();
+	else if (tcp_ack_pending == 1)
+		tcp_ack_start = get_timer(0);
+}
+
+void tcp_receive(struct ip_tcp_hdr *ip, int len)
+{
+	int tcp_len = len - IP_HDR_SIZE;
+	int hlen = (ip->tcp_hlen >> 4) * 4;
+	u32 seq, ack;
+	u8 flags;
+
+	if (tcp_state == TCP_CLOSED)
+		return;
+	if (hlen < TCP_HDR_SIZE || tcp_len < hlen)
+		return;
+	if (ip->ip_src.s_addr != tcp_remote_ip.s_addr ||
+	    ntohs(ip->tcp_src) != tcp_remote_port ||
+	    ntohs(ip->tcp_dst) != tcp_our_port)
+		return;
+	if (tcp_checksum(ip, tcp_len))
+		return;
+
+	seq = ntohl(ip->tcp_seq);
+	ack = ntohl(ip->tcp_ack);
+	flags = ip->tcp_flags;
+	tcp_rx_time = get_timer(0);
+
+	if (flags & TCP_RST) {
+		if (tcp_state == TCP_SYN_SENT ?
+		    (flags & TCP_ACK) && ack == tcp_snd_nxt :
+		    seq - tcp_rcv_nxt < tcp_rcv_wnd())
+			tcp_finish(-ECONNRESET);
+		return;
+	}
+
+	if (tcp_state == TCP_SYN_SENT) {
+		if (!(flags & TCP_SYN) || !(flags & TCP_ACK) ||
+		    ack != tcp_snd_nxt)
+			return;
+		tcp_parse_syn_options((uchar *)ip + IP_TCP_HDR_SIZE,
+				      hlen - TCP_HDR_SIZE);
+		tcp_irs = seq;
+		tcp_rcv_nxt = seq + 1;
+		tcp_snd_una = ack;
+		tcp_state = TCP_ESTABLISHED;
+		tcp_send_ack();
+		if (tcp_ops->connected)
+			tcp_ops->connected();
+		return;
+	}
+
+	/* Our acknowledgement of the SYN was lost */
+	if (flags & TCP_SYN) {
+		tcp_send_ack();
+		return;
+	}
+	if (!(flags & TCP_ACK))
+		return;
+
+	tcp_process_ack(ack);
+	if (tcp_len > hlen || (flags & TCP_FIN))
+		tcp_rx_data(seq, (uchar *)ip + IP_HDR_SIZE + hlen,
+			    tcp_len - hlen, flags & TCP_FIN);
+}
@@ -73,37 +73,6 @@ enum {
 	TFTP_ERR_OPTION_NEGOTIATION = 8,
 };
 
-static struct in_addr tftp_remote_ip;
-/* The UDP port at their end */
-static int	tftp_remote_port;
-/* The UDP port at our end */
-static int	tftp_our_port;
-static int	timeout_count;
-/* packet sequence number */
-static ulong	tftp_cur_block;
-/* last packet sequence number received */
-static ulong	tftp_prev_block;
-/* count of sequence number wraparounds */
-static ulong	tftp_block_wrap;
-/* memory offset due to wrapping */
-static ulong	tftp_block_wrap_offset;
-static int	tftp_state;
-static ulong	tftp_load_addr;
-#ifdef CONFIG_LMB
-static ulong	tftp_load_size;
-#endif
-#ifdef CONFIG_TFTP_TSIZE
-/* The file size reported by the server */
-static int	tftp_tsize;
-/* The number of hashes we printed */
-static short	tftp_tsize_num_hash;
-#endif
-/* The window size negotiated */
-static ushort	tftp_windowsize;
-/* Next block to send ack to */
-static ushort	tftp_next_ack;
-/* Last nack block we send */
-static ushort	tftp_last_nack;
 #ifdef CONFIG_CMD_TFTPPUT
 /* 1 if writing, else 0 */
 static int	tftp_put_active;
@@ -121,6 +90,8 @@ static int	tftp_put_final_block_sent;
 #define STATE_RECV_WRQ	6
 #define STATE_SEND_WRQ	7
 #define STATE_INVALID_OPTION	8
+#define STATE_WAIT	9	/* waiting to send the RRQ */
+#define STATE_DONE	10
 
 /* default TFTP block size */
 #define TFTP_BLOCK_SIZE		512
@@ -136,7 +107,94 @@ static char default_filename[DEFAULT_NAME_LEN];
 #define MAX_LEN CONFIG_TFTP_FILE_NAME_MAX_LEN
 #endif
 
-static char tftp_filename[MAX_LEN];
+/*
+ * Blocks of the current window which arrived ahead of a lost one, indexed by
+ * block number modulo TFTP_REORDER_BLOCKS. They are already stored.
+ */
+#define TFTP_REORDER_BLOCKS	1024
+
+/**
+ * struct tftp_xfer - state of one transfer
+ *
+ * @remote_ip:		Address of the server
+ * @remote_port:	The UDP port at their end
+ * @our_port:		The UDP port at our end
+ * @timeout_count:	Number of timeouts since the last progress
+ * @timeout_start:	Time of the last progress, when several files are read
+ * @cur_block:		Packet sequence number
+ * @prev_block:		Last packet sequence number received
+ * @block_wrap:		Count of sequence number wraparounds
+ * @block_wrap_offset:	Memory offset due to wrapping
+ * @state:		STATE_...
+ * @load_addr:		Address the file is loaded to
+ * @load_size:		Space available at @load_addr, 0 for no limit
+ * @load_end:		Address the file must stop short of, 0 for no limit
+ * @size:		Number of bytes of the file received so far
+ * @tsize:		The file size reported by the server
+ * @tsize_num_hash:	The number of hashes we printed
+ * @block_size:		The block size negotiated
+ * @windowsize:		The window size negotiated
+ * @next_ack:		Next block to send ack to
+ * @last_nack:		Last nack block we send
+ * @last_ack:		Last block acked early after filling in a lost one
+ * @reorder_map:	Blocks received ahead of a lost one
+ * @reorder_final:	Number of the short block ending the file if it was
+ *			received early, or -1
+ * @filename:		Name of the file on the server
+ */
+struct tftp_xfer {
+	struct in_addr remote_ip;
+	int remote_port;
+	int our_port;
+	int timeout_count;
+	ulong timeout_start;
+	ulong cur_block;
+	ulong prev_block;
+	ulong block_wrap;
+	ulong block_wrap_offset;
+	int state;
+	ulong load_addr;
+#ifdef CONFIG_LMB
+	ulong load_size;
+#endif
+	ulong load_end;
+	ulong size;
+#ifdef CONFIG_TFTP_TSIZE
+	int tsize;
+	short tsize_num_hash;
+#endif
+	unsigned short block_size;
+	ushort windowsize;
+	ushort next_ack;
+	ushort last_nack;
+	ushort last_ack;
+	u8 reorder_map[TFTP_REORDER_BLOCKS / 8];
+	int reorder_final;
+	char filename[MAX_LEN];
+};
+
+#ifdef CONFIG_CMD_TFTPMULTI
+#define TFTP_MAX_XFERS	CONFIG_TFTP_MULTI_MAX
+#else
+#define TFTP_MAX_XFERS	1
+#endif
+
+static struct tftp_xfer tftp_xfers[TFTP_MAX_XFERS];
+/* The transfer a packet or timeout is being handled for */
+static struct tftp_xfer *tx = tftp_xfers;
+
+#ifdef CONFIG_CMD_TFTPMULTI
+/* Check for timeouts of the transfers this often */
+#define TFTP_MULTI_TICK_MS	10
+/* true while several files are read at once */
+static bool	tftp_multi;
+static struct tftp_file *tftp_multi_files;
+static int	tftp_multi_count;
+/* Number of transfers which are not complete */
+static int	tftp_multi_active;
+#else
+#define tftp_multi	false
+#endif
 
 /* 512 is poor choice for ethernet, MTU is typically 1500.
  * Minus eth.hdrs thats 1468.  Can get 2x better throughput with
@@ -154,18 +212,25 @@ static char tftp_filename[MAX_LEN];
 #define TFTP_WINDOWSIZE 1
 #endif
 
-static unsigned short tftp_block_size = TFTP_BLOCK_SIZE;
 static unsigned short tftp_block_size_option = CONFIG_TFTP_BLOCKSIZE;
 static unsigned short tftp_window_size_option = TFTP_WINDOWSIZE;
 
 static inline int store_block(int block, uchar *src, unsigned int len)
 {
-	ulong offset = block * tftp_block_size + tftp_block_wrap_offset -
-			tftp_block_size;
+	ulong offset = block * tx->block_size + tx->block_wrap_offset -
+			tx->block_size;
 	ulong newsize = offset + len;
-	ulong store_addr = tftp_load_addr + offset;
+	ulong store_addr = tx->load_addr + offset;
 #ifdef CONFIG_SYS_DIRECT_FLASH_TFTP
 	int i, rc = 0;
+#endif
+
+	if (tx->load_end && store_addr + len > tx->load_end) {
+		printf("\nTFTP error: '%s' would overwrite the next file\n",
+		       tx->filename);
+		return -1;
+	}
+#ifdef CONFIG_SYS_DIRECT_FLASH_TFTP
 
 	for (i = 0; i < CONFIG_SYS_MAX_FLASH_BANKS; i++) {
 		/* start address in flash? */
@@ -189,12 +254,12 @@ static inline int store_block(int block, uchar *src, unsigned int len)
 		void *ptr;
 
 #ifdef CONFIG_LMB
-		ulong end_addr = tftp_load_addr + tftp_load_size;
+		ulong end_addr = tx->load_addr + tx->load_size;
 
 		if (!end_addr)
 			end_addr = ULONG_MAX;
 
-		if (store_addr < tftp_load_addr ||
+		if (store_addr < tx->load_addr ||
 		    store_addr + len > end_addr) {
 			puts("\nTFTP error: ");
 			puts("trying to overwrite reserved memory...\n");
@@ -206,7 +271,9 @@ static inline int store_block(int block, uchar *src, unsigned int len)
 		unmap_sysmem(ptr);
 	}
 
-	if (net_boot_file_size < newsize)
+	if (tx->size < newsize)
+		tx->size = newsize;
+	if (!tftp_multi && net_boot_file_size < newsize)
 		net_boot_file_size = newsize;
 
 	return 0;
@@ -215,14 +282,70 @@ static inline int store_block(int block, uchar *src, unsigned int len)
 /* Clear our state ready for a new transfer */
 static void new_transfer(void)
 {
-	tftp_prev_block = 0;
-	tftp_block_wrap = 0;
-	tftp_block_wrap_offset = 0;
+	tx->prev_block = 0;
+	tx->block_wrap = 0;
+	tx->block_wrap_offset = 0;
+	memset(tx->reorder_map, '\0', sizeof(tx->reorder_map));
+	tx->reorder_final = -1;
 #ifdef CONFIG_CMD_TFTPPUT
 	tftp_put_final_block_sent = 0;
 #endif
 }
 
+/**
+ * tftp_reorder_store() - store a block which arrived ahead of the next one
+ *
+ * With a window of several blocks, losing one means the following blocks of
+ * the window arrive before it. They are written to their place in memory
+ * straight away, so that only the lost block has to be sent again.
+ *
+ * @block:	Block number received
+ * @src:	Block data
+ * @len:	Length of the block data
+ * Return: 1 if the block was stored (or already had been), 0 if it is not
+ * within the window, -ve on error
+ */
+static int tftp_reorder_store(ushort block, uchar *src, unsigned int len)
+{
+	ushort ahead = block - (ushort)(tx->cur_block + 1);
+	int bit = block % TFTP_REORDER_BLOCKS;
+	int ret;
+
+	if (!ahead || ahead >= tx->windowsize ||
+	    ahead >= TFTP_REORDER_BLOCKS)
+		return 0;
+	if (tx->reorder_map[bit / 8] & BIT(bit % 8))
+		return 1;
+
+	/* store_block() handles a block number past the next wrap */
+	ret = store_block(tx->cur_block + 1 + ahead, src, len);
+	if (ret)
+		return ret;
+	tx->reorder_map[bit / 8] |= BIT(bit % 8);
+	if (len < tx->block_size)
+		tx->reorder_final = block;
+
+	return 1;
+}
+
+/**
+ * tftp_reorder_take() - check whether a block was received ahead of time
+ *
+ * @block:	Block number to check
+ * Return: true if the block is already stored, in which case it is removed
+ * from the map
+ */
+static bool tftp_reorder_take(ushort block)
+{
+	int bit = block % TFTP_REORDER_BLOCKS;
+
+	if (!(tx->reorder_map[bit / 8] & BIT(bit % 8)))
+		return false;
+	tx->reorder_map[bit / 8] &= ~BIT(bit % 8);
+
+	return true;
+}
+
 #ifdef CONFIG_CMD_TFTPPUT
 /**
  * Load the next block from memory to be sent over tftp.
@@ -235,8 +358,8 @@ static void new_transfer(void)
 static int load_block(unsigned block, uchar *dst, unsigned len)
 {
 	/* We may want to get the final block from the previous set */
-	ulong offset = block * tftp_block_size + tftp_block_wrap_offset -
-		       tftp_block_size;
+	ulong offset = block * tx->block_size + tx->block_wrap_offset -
+		       tx->block_size;
 	ulong tosend = len;
 
 	tosend = min(net_boot_file_size - offset, tosend);
@@ -249,6 +372,18 @@ static int load_block(unsigned block, uchar *dst, unsigned len)
 
 static void tftp_send(void);
 static void tftp_timeout_handler(void);
+#ifdef CONFIG_CMD_TFTPMULTI
+static void tftp_multi_complete(void);
+#endif
+
+/* Restart the timeout of the current transfer, after some progress */
+static void tftp_set_timeout(void)
+{
+	if (tftp_multi)
+		tx->timeout_start = get_timer(0);
+	else
+		net_set_timeout_handler(timeout_ms, tftp_timeout_handler);
+}
 
 /**********************************************************************/
 
@@ -256,22 +391,26 @@ static void show_block_marker(void)
 {
 	ulong pos;
 
+	/* The progress of several transfers cannot be shown on one line */
+	if (tftp_multi)
+		return;
+
 #ifdef CONFIG_TFTP_TSIZE
-	if (tftp_tsize) {
-		pos = tftp_cur_block * tftp_block_size +
-			tftp_block_wrap_offset;
-		if (pos > tftp_tsize)
-			pos = tftp_tsize;
+	if (tx->tsize) {
+		pos = tx->cur_block * tx->block_size +
+			tx->block_wrap_offset;
+		if (pos > tx->tsize)
+			pos = tx->tsize;
 
-		while (tftp_tsize_num_hash < pos * 50 / tftp_tsize) {
+		while (tx->tsize_num_hash < pos * 50 / tx->tsize) {
 			putc('#');
-			tftp_tsize_num_hash++;
+			tx->tsize_num_hash++;
 		}
 	} else
 #endif
 	{
-		pos = (tftp_cur_block - 1) +
-			(tftp_block_wrap * TFTP_SEQUENCE_SIZE);
+		pos = (tx->cur_block - 1) +
+			(tx->block_wrap * TFTP_SEQUENCE_SIZE);
 		if ((pos % 10) == 0)
 			putc('#');
 		else if (((pos + 1) % (10 * HASHES_PER_LINE)) == 0)
@@ -292,8 +431,6 @@ static void restart(const char *msg)
 
 /*
  * Check if the block number has wrapped, and update progress
- *
- * TODO: The egregious use of global variables in this file should be tidied.
  */
 static void update_block_number(void)
 {
@@ -303,10 +440,10 @@ static void update_block_number(void)
 	 * number of 0 this means that there was a wrap
 	 * around of the (16 bit) counter.
 	 */
-	if (tftp_cur_block == 0 && tftp_prev_block != 0) {
-		tftp_block_wrap++;
-		tftp_block_wrap_offset += tftp_block_size * TFTP_SEQUENCE_SIZE;
-		timeout_count = 0; /* we've done well, reset the timeout */
+	if (tx->cur_block == 0 && tx->prev_block != 0) {
+		tx->block_wrap++;
+		tx->block_wrap_offset += tx->block_size * TFTP_SEQUENCE_SIZE;
+		tx->timeout_count = 0; /* we've done well, reset the timeout */
 	}
 	show_block_marker();
 }
@@ -314,14 +451,20 @@ static void update_block_number(void)
 /* The TFTP get or put is complete */
 static void tftp_complete(void)
 {
+#ifdef CONFIG_CMD_TFTPMULTI
+	if (tftp_multi) {
+		tftp_multi_complete();
+		return;
+	}
+#endif
 #ifdef CONFIG_TFTP_TSIZE
 	/* Print hash marks for the last packet received */
-	while (tftp_tsize && tftp_tsize_num_hash < 49) {
+	while (tx->tsize && tx->tsize_num_hash < 49) {
 		putc('#');
-		tftp_tsize_num_hash++;
+		tx->tsize_num_hash++;
 	}
 	puts("  ");
-	print_size(tftp_tsize, "");
+	print_size(tx->tsize, "");
 #endif
 	time_start = get_timer(time_start);
 	if (time_start > 0) {
@@ -332,8 +475,8 @@ static void tftp_complete(void)
 	puts("\ndone\n");
 	if (IS_ENABLED(CONFIG_CMD_BOOTEFI)) {
 		if (!tftp_put_active)
-			efi_set_bootdev("Net", "", tftp_filename,
-					map_sysmem(tftp_load_addr, 0),
+			efi_set_bootdev("Net", "", tx->filename,
+					map_sysmem(tx->load_addr, 0),
 					net_boot_file_size);
 	}
 	net_set_state(NETLOOP_SUCCESS);
@@ -353,20 +496,20 @@ static void tftp_send(void)
 	 */
 	pkt = net_tx_packet + net_eth_hdr_size() + IP_UDP_HDR_SIZE;
 
-	switch (tftp_state) {
+	switch (tx->state) {
 	case STATE_SEND_RRQ:
 	case STATE_SEND_WRQ:
 		xp = pkt;
 		s = (ushort *)pkt;
 #ifdef CONFIG_CMD_TFTPPUT
-		*s++ = htons(tftp_state == STATE_SEND_RRQ ? TFTP_RRQ :
+		*s++ = htons(tx->state == STATE_SEND_RRQ ? TFTP_RRQ :
 			TFTP_WRQ);
 #else
 		*s++ = htons(TFTP_RRQ);
 #endif
 		pkt = (uchar *)s;
-		strcpy((char *)pkt, tftp_filename);
-		pkt += strlen(tftp_filename) + 1;
+		strcpy((char *)pkt, tx->filename);
+		pkt += strlen(tx->filename) + 1;
 		strcpy((char *)pkt, "octet");
 		pkt += 5 /*strlen("octet")*/ + 1;
 		strcpy((char *)pkt, "timeout");
@@ -386,7 +529,7 @@ static void tftp_send(void)
 		 * Implemented only for tftp get.
 		 * Don't bother sending if it's 1
 		 */
-		if (tftp_state == STATE_SEND_RRQ && tftp_window_size_option > 1)
+		if (tx->state == STATE_SEND_RRQ && tftp_window_size_option > 1)
 			pkt += sprintf((char *)pkt, "windowsize%c%d%c",
 					0, tftp_window_size_option, 0);
 		len = pkt - xp;
@@ -399,12 +542,12 @@ static void tftp_send(void)
 		xp = pkt;
 		s = (ushort *)pkt;
 		s[0] = htons(TFTP_ACK);
-		s[1] = htons(tftp_cur_block);
+		s[1] = htons(tx->cur_block);
 		pkt = (uchar *)(s + 2);
 #ifdef CONFIG_CMD_TFTPPUT
 		if (tftp_put_active) {
-			int toload = tftp_block_size;
-			int loaded = load_block(tftp_cur_block, pkt, toload);
+			int toload = tx->block_size;
+			int loaded = load_block(tx->cur_block, pkt, toload);
 
 			s[0] = htons(TFTP_DATA);
 			pkt += loaded;
@@ -453,8 +596,8 @@ static void tftp_send(void)
 		break;
 	}
 
-	net_send_udp_packet(net_server_ethaddr, tftp_remote_ip,
-			    tftp_remote_port, tftp_our_port, len);
+	net_send_udp_packet(net_server_ethaddr, tx->remote_ip,
+			    tx->remote_port, tx->our_port, len);
 
 	if (err_pkt)
 		net_set_state(NETLOOP_FAIL);
@@ -479,12 +622,14 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 	__be16 *s;
 	int i;
 	u16 timeout_val_rcvd;
+	bool final;
+	int ahead;
 
-	if (dest != tftp_our_port) {
+	if (dest != tx->our_port) {
 			return;
 	}
-	if (tftp_state != STATE_SEND_RRQ && src != tftp_remote_port &&
-	    tftp_state != STATE_RECV_WRQ && tftp_state != STATE_SEND_WRQ)
+	if (tx->state != STATE_SEND_RRQ && src != tx->remote_port &&
+	    tx->state != STATE_RECV_WRQ && tx->state != STATE_SEND_WRQ)
 		return;
 
 	if (len < 2)
@@ -509,10 +654,10 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 				 * count to wrap just like the other end!
 				 */
 				int block = ntohs(*s);
-				int ack_ok = (tftp_cur_block == block);
+				int ack_ok = (tx->cur_block == block);
 
-				tftp_prev_block = tftp_cur_block;
-				tftp_cur_block = (unsigned short)(block + 1);
+				tx->prev_block = tx->cur_block;
+				tx->cur_block = (unsigned short)(block + 1);
 				update_block_number();
 				if (ack_ok)
 					tftp_send(); /* Send next data block */
@@ -527,9 +672,9 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 #ifdef CONFIG_CMD_TFTPSRV
 	case TFTP_WRQ:
 		debug("Got WRQ\n");
-		tftp_remote_ip = sip;
-		tftp_remote_port = src;
-		tftp_our_port = 1024 + (get_timer(0) % 3072);
+		tx->remote_ip = sip;
+		tx->remote_port = src;
+		tx->our_port = 1024 + (get_timer(0) % 3072);
 		new_transfer();
 		tftp_send(); /* Send ACK(0) */
 		break;
@@ -544,8 +689,8 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 				debug("%c", pkt[i]);
 		}
 		debug("\n");
-		tftp_state = STATE_OACK;
-		tftp_remote_port = src;
+		tx->state = STATE_OACK;
+		tx->remote_port = src;
 		/*
 		 * Check for 'blksize' option.
 		 * Careful: "i" is signed, "len" is unsigned, thus
@@ -553,14 +698,14 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 		 */
 		for (i = 0; i+8 < len; i++) {
 			if (strcasecmp((char *)pkt + i, "blksize") == 0) {
-				tftp_block_size = (unsigned short)
+				tx->block_size = (unsigned short)
 					dectoul((char *)pkt + i + 8, NULL);
 				debug("Blocksize oack: %s, %d\n",
-				      (char *)pkt + i + 8, tftp_block_size);
-				if (tftp_block_size > tftp_block_size_option) {
+				      (char *)pkt + i + 8, tx->block_size);
+				if (tx->block_size > tftp_block_size_option) {
 					printf("Invalid blk size(=%d)\n",
-					       tftp_block_size);
-					tftp_state = STATE_INVALID_OPTION;
+					       tx->block_size);
+					tx->state = STATE_INVALID_OPTION;
 				}
 			}
 			if (strcasecmp((char *)pkt + i, "timeout") == 0) {
@@ -571,32 +716,32 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 				if (timeout_val_rcvd != (timeout_ms / 1000)) {
 					printf("Invalid timeout val(=%d s)\n",
 					       timeout_val_rcvd);
-					tftp_state = STATE_INVALID_OPTION;
+					tx->state = STATE_INVALID_OPTION;
 				}
 			}
 #ifdef CONFIG_TFTP_TSIZE
 			if (strcasecmp((char *)pkt + i, "tsize") == 0) {
-				tftp_tsize = dectoul((char *)pkt + i + 6,
+				tx->tsize = dectoul((char *)pkt + i + 6,
 						     NULL);
 				debug("size = %s, %d\n",
-				      (char *)pkt + i + 6, tftp_tsize);
+				      (char *)pkt + i + 6, tx->tsize);
 			}
 #endif
 			if (strcasecmp((char *)pkt + i,  "windowsize") == 0) {
-				tftp_windowsize =
+				tx->windowsize =
 					dectoul((char *)pkt + i + 11, NULL);
 				debug("windowsize = %s, %d\n",
-				      (char *)pkt + i + 11, tftp_windowsize);
+				      (char *)pkt + i + 11, tx->windowsize);
 			}
 		}
 
-		tftp_next_ack = tftp_windowsize;
+		tx->next_ack = tx->windowsize;
 
 #ifdef CONFIG_CMD_TFTPPUT
-		if (tftp_put_active && tftp_state == STATE_OACK) {
+		if (tftp_put_active && tx->state == STATE_OACK) {
 			/* Get ready to send the first block */
-			tftp_state = STATE_DATA;
-			tftp_cur_block++;
+			tx->state = STATE_DATA;
+			tx->cur_block++;
 		}
 #endif
 		tftp_send(); /* Send ACK or first data block */
@@ -606,67 +751,91 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			return;
 		len -= 2;
 
-		if (ntohs(*(__be16 *)pkt) != (ushort)(tftp_cur_block + 1)) {
+		if (ntohs(*(__be16 *)pkt) != (ushort)(tx->cur_block + 1)) {
 			debug("Received unexpected block: %d, expected: %d\n",
 			      ntohs(*(__be16 *)pkt),
-			      (ushort)(tftp_cur_block + 1));
+			      (ushort)(tx->cur_block + 1));
+			ahead = 0;
+			if (tx->state == STATE_DATA)
+				ahead = tftp_reorder_store(ntohs(*s), pkt + 2,
+							   len);
+			if (ahead < 0) {
+				eth_halt();
+				net_set_state(NETLOOP_FAIL);
+				break;
+			}
 			/*
 			 * If one packet is dropped most likely
 			 * all other buffers in the window
 			 * that will arrive will cause a sending NACK.
 			 * This just overwellms the server, let's just send one.
+			 * Stale blocks need no NACK if we have just acked the
+			 * same block, but a new gap always gets one.
 			 */
-			if (tftp_last_nack != tftp_cur_block) {
-				tftp_send();
-				tftp_last_nack = tftp_cur_block;
-				tftp_next_ack = (ushort)(tftp_cur_block +
-							 tftp_windowsize);
-			}
+			if (tx->last_nack == tx->cur_block)
+				break;
+			if (!ahead && tx->last_ack == tx->cur_block)
+				break;
+			tftp_send();
+			tx->last_nack = tx->cur_block;
+			tx->next_ack = (ushort)(tx->cur_block + tx->windowsize);
 			break;
 		}
 
-		tftp_cur_block++;
-		tftp_cur_block %= TFTP_SEQUENCE_SIZE;
+		tx->cur_block++;
+		tx->cur_block %= TFTP_SEQUENCE_SIZE;
 
-		if (tftp_state == STATE_SEND_RRQ) {
+		if (tx->state == STATE_SEND_RRQ) {
 			debug("Server did not acknowledge any options!\n");
-			tftp_next_ack = tftp_windowsize;
+			tx->next_ack = tx->windowsize;
 		}
 
-		if (tftp_state == STATE_SEND_RRQ || tftp_state == STATE_OACK ||
-		    tftp_state == STATE_RECV_WRQ) {
+		if (tx->state == STATE_SEND_RRQ || tx->state == STATE_OACK ||
+		    tx->state == STATE_RECV_WRQ) {
 			/* first block received */
-			tftp_state = STATE_DATA;
-			tftp_remote_port = src;
+			tx->state = STATE_DATA;
+			tx->remote_port = src;
 			new_transfer();
 
-			if (tftp_cur_block != 1) {	/* Assertion */
+			if (tx->cur_block != 1) {	/* Assertion */
 				puts("\nTFTP error: ");
 				printf("First block is not block 1 (%ld)\n",
-				       tftp_cur_block);
+				       tx->cur_block);
 				puts("Starting again\n\n");
 				net_start_again();
 				break;
 			}
 		}
 
-		if (tftp_cur_block == tftp_prev_block) {
+		if (tx->cur_block == tx->prev_block) {
 			/* Same block again; ignore it. */
 			break;
 		}
 
 		update_block_number();
-		tftp_prev_block = tftp_cur_block;
+		tx->prev_block = tx->cur_block;
 		timeout_count_max = tftp_timeout_count_max;
-		net_set_timeout_handler(timeout_ms, tftp_timeout_handler);
+		tftp_set_timeout();
 
-		if (store_block(tftp_cur_block, pkt + 2, len)) {
+		if (store_block(tx->cur_block, pkt + 2, len)) {
 			eth_halt();
 			net_set_state(NETLOOP_FAIL);
 			break;
 		}
 
-		if (len < tftp_block_size) {
+		/* Move past following blocks which arrived before this one */
+		final = len < tx->block_size;
+		ahead = 0;
+		while (!final && tftp_reorder_take(tx->cur_block + 1)) {
+			tx->cur_block++;
+			tx->cur_block %= TFTP_SEQUENCE_SIZE;
+			update_block_number();
+			tx->prev_block = tx->cur_block;
+			final = tx->cur_block == tx->reorder_final;
+			ahead++;
+		}
+
+		if (final) {
 			tftp_send();
 			tftp_complete();
 			break;
@@ -674,11 +843,18 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 
 		/*
 		 *	Acknowledge the block just received, which will prompt
-		 *	the remote for the next one.
+		 *	the remote for the next one. If a lost block has just
+		 *	been filled in, acknowledge straight away so that the
+		 *	remote does not resend what is already here.
 		 */
-		if (tftp_cur_block == tftp_next_ack) {
+		if (ahead) {
 			tftp_send();
-			tftp_next_ack += tftp_windowsize;
+			tx->last_ack = tx->cur_block;
+			tx->next_ack = (ushort)(tx->cur_block +
+						 tx->windowsize);
+		} else if (tx->cur_block == tx->next_ack) {
+			tftp_send();
+			tx->next_ack += tx->windowsize;
 		}
 		break;
 
@@ -710,18 +886,18 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 
 static void tftp_timeout_handler(void)
 {
-	if (++timeout_count > timeout_count_max) {
+	if (++tx->timeout_count > timeout_count_max) {
 		restart("Retry count exceeded");
 	} else {
 		puts("T ");
-		net_set_timeout_handler(timeout_ms, tftp_timeout_handler);
-		if (tftp_state != STATE_RECV_WRQ)
+		tftp_set_timeout();
+		if (tx->state != STATE_RECV_WRQ)
 			tftp_send();
 	}
 }
 
-/* Initialize tftp_load_addr and tftp_load_size from image_load_addr and lmb */
-static int tftp_init_load_addr(void)
+/* Initialize the load address and limits of tx from addr and lmb */
+static int tftp_init_load_addr(ulong addr)
 {
 #ifdef CONFIG_LMB
 	struct lmb lmb;
@@ -729,17 +905,20 @@ static int tftp_init_load_addr(void)
 
 	lmb_init_and_reserve(&lmb, gd->bd, (void *)gd->fdt_blob);
 
-	max_size = lmb_get_free_size(&lmb, image_load_addr);
+	max_size = lmb_get_free_size(&lmb, addr);
+	lmb_uninit(&lmb);
 	if (!max_size)
 		return -1;
 
-	tftp_load_size = max_size;
+	tx->load_size = max_size;
 #endif
-	tftp_load_addr = image_load_addr;
+	tx->load_addr = addr;
+	tx->load_end = 0;
 	return 0;
 }
 
-void tftp_start(enum proto_t protocol)
+/* Read the TFTP options from the environment */
+static void tftp_get_options(void)
 {
 #if CONFIG_NET_TFTP_VARS
 	char *ep;             /* Environment pointer */
@@ -780,20 +959,68 @@ void tftp_start(enum proto_t protocol)
 
 	debug("TFTP blocksize = %i, TFTP windowsize = %d timeout = %ld ms\n",
 	      tftp_block_size_option, tftp_window_size_option, timeout_ms);
+}
+
+/**
+ * tftp_init_xfer() - get the current transfer ready to send its request
+ *
+ * @our_port:	UDP port at our end, or -1 for a pseudo-random one
+ */
+static void tftp_init_xfer(int our_port)
+{
+#ifdef CONFIG_TFTP_PORT
+	char *ep;
+#endif
+
+	tx->remote_port = WELL_KNOWN_PORT;
+	tx->timeout_count = 0;
+	/* Use a pseudo-random port unless a specific port is set */
+	tx->our_port = 1024 + (get_timer(0) % 3072);
+
+#ifdef CONFIG_TFTP_PORT
+	ep = env_get("tftpdstp");
+	if (ep != NULL)
+		tx->remote_port = simple_strtol(ep, NULL, 10);
+	ep = env_get("tftpsrcp");
+	if (ep != NULL)
+		tx->our_port = simple_strtol(ep, NULL, 10);
+#endif
+	if (our_port >= 0)
+		tx->our_port = our_port;
+	tx->cur_block = 0;
+	tx->windowsize = 1;
+	tx->last_nack = 0;
+	tx->last_ack = 0;
+	/* Revert tx->block_size to dflt */
+	tx->block_size = TFTP_BLOCK_SIZE;
+	tx->size = 0;
+#ifdef CONFIG_TFTP_TSIZE
+	tx->tsize = 0;
+	tx->tsize_num_hash = 0;
+#endif
+}
+
+void tftp_start(enum proto_t protocol)
+{
+	tx = tftp_xfers;
+#ifdef CONFIG_CMD_TFTPMULTI
+	tftp_multi = false;
+#endif
+	tftp_get_options();
 
-	tftp_remote_ip = net_server_ip;
-	if (!net_parse_bootfile(&tftp_remote_ip, tftp_filename, MAX_LEN)) {
+	tx->remote_ip = net_server_ip;
+	if (!net_parse_bootfile(&tx->remote_ip, tx->filename, MAX_LEN)) {
 		sprintf(default_filename, "%02X%02X%02X%02X.img",
 			net_ip.s_addr & 0xFF,
 			(net_ip.s_addr >>  8) & 0xFF,
 			(net_ip.s_addr >> 16) & 0xFF,
 			(net_ip.s_addr >> 24) & 0xFF);
 
-		strncpy(tftp_filename, default_filename, DEFAULT_NAME_LEN);
-		tftp_filename[DEFAULT_NAME_LEN - 1] = 0;
+		strncpy(tx->filename, default_filename, DEFAULT_NAME_LEN);
+		tx->filename[DEFAULT_NAME_LEN - 1] = 0;
 
 		printf("*** Warning: no boot file name; using '%s'\n",
-		       tftp_filename);
+		       tx->filename);
 	}
 
 	printf("Using %s device\n", eth_get_name());
@@ -803,7 +1030,7 @@ void tftp_start(enum proto_t protocol)
 #else
 	       "from",
 #endif
-	       &tftp_remote_ip, &net_ip);
+	       &tx->remote_ip, &net_ip);
 
 	/* Check if we need to send across this subnet */
 	if (net_gateway.s_addr && net_netmask.s_addr) {
@@ -811,13 +1038,13 @@ void tftp_start(enum proto_t protocol)
 		struct in_addr remote_net;
 
 		our_net.s_addr = net_ip.s_addr & net_netmask.s_addr;
-		remote_net.s_addr = tftp_remote_ip.s_addr & net_netmask.s_addr;
+		remote_net.s_addr = tx->remote_ip.s_addr & net_netmask.s_addr;
 		if (our_net.s_addr != remote_net.s_addr)
 			printf("; sending through gateway %pI4", &net_gateway);
 	}
 	putc('\n');
 
-	printf("Filename '%s'.", tftp_filename);
+	printf("Filename '%s'.", tx->filename);
 
 	if (net_boot_file_expected_size_in_blocks) {
 		printf(" Size is 0x%x Bytes = ",
@@ -833,21 +1060,21 @@ void tftp_start(enum proto_t protocol)
 		printf("Save size:    0x%lx\n", image_save_size);
 		net_boot_file_size = image_save_size;
 		puts("Saving: *\b");
-		tftp_state = STATE_SEND_WRQ;
+		tx->state = STATE_SEND_WRQ;
 		new_transfer();
 	} else
 #endif
 	{
-		if (tftp_init_load_addr()) {
+		if (tftp_init_load_addr(image_load_addr)) {
 			eth_halt();
 			net_set_state(NETLOOP_FAIL);
 			puts("\nTFTP error: ");
 			puts("trying to overwrite reserved memory...\n");
 			return;
 		}
-		printf("Load address: 0x%lx\n", tftp_load_addr);
+		printf("Load address: 0x%lx\n", tx->load_addr);
 		puts("Loading: *\b");
-		tftp_state = STATE_SEND_RRQ;
+		tx->state = STATE_SEND_RRQ;
 	}
 
 	time_start = get_timer(0);
@@ -858,40 +1085,178 @@ void tftp_start(enum proto_t protocol)
 #ifdef CONFIG_CMD_TFTPPUT
 	net_set_icmp_handler(icmp_handler);
 #endif
-	tftp_remote_port = WELL_KNOWN_PORT;
-	timeout_count = 0;
-	/* Use a pseudo-random port unless a specific port is set */
-	tftp_our_port = 1024 + (get_timer(0) % 3072);
+	tftp_init_xfer(-1);
+	/* zero out server ether in case the server ip has changed */
+	memset(net_server_ethaddr, 0, 6);
 
-#ifdef CONFIG_TFTP_PORT
-	ep = env_get("tftpdstp");
-	if (ep != NULL)
-		tftp_remote_port = simple_strtol(ep, NULL, 10);
-	ep = env_get("tftpsrcp");
-	if (ep != NULL)
-		tftp_our_port = simple_strtol(ep, NULL, 10);
+	tftp_send();
+}
+
+#ifdef CONFIG_CMD_TFTPMULTI
+/* One of several transfers is complete */
+static void tftp_multi_complete(void)
+{
+	struct tftp_file *file = &tftp_multi_files[tx - tftp_xfers];
+	ulong total = 0;
+	int i;
+
+	tx->state = STATE_DONE;
+	file->size = tx->size;
+	printf("%s: 0x%lx bytes at 0x%lx\n", tx->filename, tx->size,
+	       tx->load_addr);
+	if (--tftp_multi_active)
+		return;
+
+	for (i = 0; i < tftp_multi_count; i++)
+		total += tftp_xfers[i].size;
+	net_boot_file_size = total;
+	time_start = get_timer(time_start);
+	if (time_start > 0) {
+		puts("\t ");
+		print_size(total / time_start * 1000, "/s\n");
+	}
+	puts("done\n");
+	net_set_state(NETLOOP_SUCCESS);
+}
+
+/*
+ * Send the requests which were held back until the server's MAC address is
+ * known, since only one packet can wait for an ARP reply
+ */
+static void tftp_multi_send_requests(void)
+{
+	int i;
+
+	if (is_zero_ethaddr(net_server_ethaddr))
+		return;
+
+	for (i = 0; i < tftp_multi_count; i++) {
+		tx = &tftp_xfers[i];
+		if (tx->state != STATE_WAIT)
+			continue;
+		tx->state = STATE_SEND_RRQ;
+		tftp_set_timeout();
+		tftp_send();
+	}
+}
+
+static void tftp_multi_handler(uchar *pkt, unsigned dest, struct in_addr sip,
+			       unsigned src, unsigned len)
+{
+	int i;
+
+	for (i = 0; i < tftp_multi_count; i++) {
+		tx = &tftp_xfers[i];
+		if (tx->our_port == dest && tx->state != STATE_DONE &&
+		    tx->state != STATE_WAIT) {
+			tftp_handler(pkt, dest, sip, src, len);
+			break;
+		}
+	}
+
+	if (net_state == NETLOOP_CONTINUE)
+		tftp_multi_send_requests();
+}
+
+static void tftp_multi_timeout_handler(void)
+{
+	int i;
+
+	net_set_timeout_handler(TFTP_MULTI_TICK_MS,
+				tftp_multi_timeout_handler);
+
+	for (i = 0; i < tftp_multi_count; i++) {
+		tx = &tftp_xfers[i];
+		if (tx->state == STATE_DONE || tx->state == STATE_WAIT)
+			continue;
+		if (get_timer(tx->timeout_start) < timeout_ms)
+			continue;
+		tftp_timeout_handler();
+		if (net_state != NETLOOP_CONTINUE)
+			return;
+	}
+
+	tftp_multi_send_requests();
+}
+
+void tftp_multi_set_files(struct tftp_file *files, int count)
+{
+	tftp_multi_files = files;
+	tftp_multi_count = min(count, TFTP_MAX_XFERS);
+}
+
+void tftp_multi_start(void)
+{
+	struct tftp_file *file;
+	ulong end;
+	int port;
+	int i, j;
+
+	tx = tftp_xfers;
+	tftp_multi = true;
+#ifdef CONFIG_CMD_TFTPPUT
+	tftp_put_active = 0;
 #endif
-	tftp_cur_block = 0;
-	tftp_windowsize = 1;
-	tftp_last_nack = 0;
+	tftp_get_options();
+
+	printf("Using %s device\n", eth_get_name());
+	printf("TFTP from server %pI4; our IP address is %pI4\n",
+	       &net_server_ip, &net_ip);
+	printf("Loading %d files\n", tftp_multi_count);
+
+	/* Consecutive ports, from a pseudo-random one */
+	port = 1024 + (get_timer(0) % (3072 - TFTP_MAX_XFERS));
+	for (i = 0; i < tftp_multi_count; i++) {
+		file = &tftp_multi_files[i];
+		tx = &tftp_xfers[i];
+		file->size = 0;
+		if (tftp_init_load_addr(file->addr)) {
+			net_set_state(NETLOOP_FAIL);
+			printf("\nTFTP error: '%s' would overwrite reserved memory\n",
+			       file->name);
+			return;
+		}
+		/* Do not let a file run into the one loaded after it */
+		end = 0;
+		for (j = 0; j < tftp_multi_count; j++) {
+			if (tftp_multi_files[j].addr > file->addr &&
+			    (!end || tftp_multi_files[j].addr < end))
+				end = tftp_multi_files[j].addr;
+		}
+		tx->load_end = end;
+		tx->remote_ip = net_server_ip;
+		strlcpy(tx->filename, file->name, MAX_LEN);
+		tftp_init_xfer(port + i);
+		tx->state = STATE_WAIT;
+		tx->timeout_start = get_timer(0);
+	}
+
+	time_start = get_timer(0);
+	timeout_count_max = tftp_timeout_count_max;
+	tftp_multi_active = tftp_multi_count;
+
+	net_set_timeout_handler(TFTP_MULTI_TICK_MS, tftp_multi_timeout_handler);
+	net_set_udp_handler(tftp_multi_handler);
 	/* zero out server ether in case the server ip has changed */
 	memset(net_server_ethaddr, 0, 6);
-	/* Revert tftp_block_size to dflt */
-	tftp_block_size = TFTP_BLOCK_SIZE;
-#ifdef CONFIG_TFTP_TSIZE
-	tftp_tsize = 0;
-	tftp_tsize_num_hash = 0;
-#endif
 
+	/* The first request finds the server's MAC address for the others */
+	tx = tftp_xfers;
+	tx->state = STATE_SEND_RRQ;
 	tftp_send();
 }
+#endif /* CONFIG_CMD_TFTPMULTI */
 
 #ifdef CONFIG_CMD_TFTPSRV
 void tftp_start_server(void)
 {
-	tftp_filename[0] = 0;
+	tx = tftp_xfers;
+#ifdef CONFIG_CMD_TFTPMULTI
+	tftp_multi = false;
+#endif
+	tx->filename[0] = 0;
 
-	if (tftp_init_load_addr()) {
+	if (tftp_init_load_addr(image_load_addr)) {
 		eth_halt();
 		net_set_state(NETLOOP_FAIL);
 		puts("\nTFTP error: trying to overwrite reserved memory...\n");
@@ -899,26 +1264,26 @@ void tftp_start_server(void)
 	}
 	printf("Using %s device\n", eth_get_name());
 	printf("Listening for TFTP transfer on %pI4\n", &net_ip);
-	printf("Load address: 0x%lx\n", tftp_load_addr);
+	printf("Load address: 0x%lx\n", tx->load_addr);
 
 	puts("Loading: *\b");
 
 	timeout_count_max = tftp_timeout_count_max;
-	timeout_count = 0;
+	tx->timeout_count = 0;
 	timeout_ms = TIMEOUT;
 	net_set_timeout_handler(timeout_ms, tftp_timeout_handler);
 
-	/* Revert tftp_block_size to dflt */
-	tftp_block_size = TFTP_BLOCK_SIZE;
-	tftp_cur_block = 0;
-	tftp_our_port = WELL_KNOWN_PORT;
+	/* Revert tx->block_size to dflt */
+	tx->block_size = TFTP_BLOCK_SIZE;
+	tx->cur_block = 0;
+	tx->our_port = WELL_KNOWN_PORT;
 
 #ifdef CONFIG_TFTP_TSIZE
-	tftp_tsize = 0;
-	tftp_tsize_num_hash = 0;
+	tx->tsize = 0;
+	tx->tsize_num_hash = 0;
 #endif
 
-	tftp_state = STATE_RECV_WRQ;
+	tx->state = STATE_RECV_WRQ;
 	net_set_udp_handler(tftp_handler);
 
 	/* zero out server ether in case the server ip has changed */
@@ -0,0 +1,311 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Download a file with HTTP
+ *
+ * The body of the response is written to the load address as it arrives,
+ * at its offset in the TCP stream, so that data received ahead of a lost
+ * segment is kept rather than sent again. Only what is needed to fetch a
+ * file is supported: a GET with a 200 response, ended by Content-Length or
+ * by the server closing the connection.
+ */
+
+#include <common.h>
+#include <display_options.h>
+#include <efi_loader.h>
+#include <env.h>
+#include <image.h>
+#include <lmb.h>
+#include <mapmem.h>
+#include <net.h>
+#include <asm/global_data.h>
+#include <linux/sizes.h>
+#include <net/tcp.h>
+#include <net/wget.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+/* Largest response header which is accepted */
+#define WGET_HDR_MAX		2048
+/* Bytes received for each hash mark */
+#define WGET_HASH_BYTES		SZ_256K
+#define HASHES_PER_LINE		65
+
+static struct in_addr wget_server_ip;
+static int wget_server_port;
+static char wget_path[1024];
+static ulong wget_load_addr;
+static ulong wget_load_size;
+static ulong wget_time_start;
+
+static char wget_hdr[WGET_HDR_MAX];
+static uint wget_hdr_len;
+static bool wget_hdr_done;
+static u32 wget_body_start;	/* offset of the body in the stream */
+static bool wget_len_known;
+static u32 wget_content_len;
+static int wget_num_hash;
+/* A transfer is in progress, so TCP callbacks are for us */
+static bool wget_active;
+
+static void wget_fail(const char *msg)
+{
+	printf("\nwget error: %s\n", msg);
+	wget_active = false;
+	tcp_abort();
+	net_set_state(NETLOOP_FAIL);
+}
+
+static void wget_complete(void)
+{
+	/*
+	 * Drop the connection rather than close it, so that nothing the
+	 * server sends later can reach a later network command
+	 */
+	wget_active = false;
+	tcp_abort();
+	wget_time_start = get_timer(wget_time_start);
+	if (wget_time_start > 0) {
+		puts("\n\t ");	/* Line up with "Loading: " */
+		print_size(net_boot_file_size / wget_time_start * 1000, "/s");
+	}
+	puts("\ndone\n");
+	if (IS_ENABLED(CONFIG_CMD_BOOTEFI))
+		efi_set_bootdev("Net", "", wget_path,
+				map_sysmem(wget_load_addr, 0),
+				net_boot_file_size);
+	net_set_state(NETLOOP_SUCCESS);
+}
+
+static int wget_parse_header(void)
+{
+	char *line, *p;
+
+	if (strncmp(wget_hdr, "HTTP/1.", 7))
+		return -EPROTO;
+	p = strchr(wget_hdr, ' ');
+	if (!p || simple_strtoul(p + 1, NULL, 10) != 200) {
+		p = strstr(wget_hdr, "\r\n");
+		*p = '\0';
+		printf("\nwget: server replied '%s'\n", wget_hdr);
+		return -ENOENT;
+	}
+
+	for (line = strstr(wget_hdr, "\r\n"); line;
+	     line = strstr(line + 2, "\r\n")) {
+		p = line + 2;
+		if (!strncasecmp(p, "Content-Length:", 15)) {
+			for (p += 15; *p == ' ' || *p == '\t'; p++)
+				;
+			wget_content_len = simple_strtoul(p, NULL, 10);
+			wget_len_known = true;
+		} else if (!strncasecmp(p, "Transfer-Encoding:", 18)) {
+			return -EPROTONOSUPPORT;
+		}
+	}
+
+	return 0;
+}
+
+static bool wget_store(u32 pos, const uchar *data, uint len)
+{
+	void *ptr;
+
+	/* Ignore anything the server sends after the body */
+	if (wget_len_known) {
+		if (pos >= wget_content_len)
+			return true;
+		len = min(len, wget_content_len - pos);
+	}
+	if (wget_load_size && pos + len > wget_load_size) {
+		wget_fail("trying to overwrite reserved memory...");
+		return false;
+	}
+
+	ptr = map_sysmem(wget_load_addr + pos, len);
+	memcpy(ptr, data, len);
+	unmap_sysmem(ptr);
+
+	return true;
+}
+
+static void wget_connected(void)
+{
+	char req[TCP_MSS];
+	int len;
+
+	len = snprintf(req, sizeof(req),
+		       "GET %s%s HTTP/1.1\r\n"
+		       "Host: %pI4\r\n"
+		       "User-Agent: U-Boot\r\n"
+		       "Connection: close\r\n\r\n",
+		       *wget_path == '/' ? "" : "/", wget_path,
+		       &wget_server_ip);
+	if (len >= sizeof(req) || tcp_send(req, len))
+		wget_fail("path too long");
+}
+
+static bool wget_rx(u32 offset, const uchar *data, unsigned int len)
+{
+	uint skip, copy;
+	char *end;
+
+	if (wget_hdr_done) {
+		if (offset < wget_body_start) {
+			skip = min(len, wget_body_start - offset);
+			data += skip;
+			len -= skip;
+			offset += skip;
+		}
+		return wget_store(offset - wget_body_start, data, len);
+	}
+
+	/* The header is read in order; the server sends the rest again */
+	if (offset != wget_hdr_len)
+		return false;
+
+	copy = min(len, (uint)sizeof(wget_hdr) - 1 - wget_hdr_len);
+	memcpy(wget_hdr + wget_hdr_len, data, copy);
+	wget_hdr_len += copy;
+	wget_hdr[wget_hdr_len] = '\0';
+
+	end = strstr(wget_hdr, "\r\n\r\n");
+	if (!end) {
+		if (wget_hdr_len == sizeof(wget_hdr) - 1)
+			wget_fail("response header too large");
+		return true;
+	}
+
+	wget_body_start = end + 4 - wget_hdr;
+	wget_hdr_done = true;
+	/* Keep the line ending of the last field, for parsing */
+	end[2] = '\0';
+	switch (wget_parse_header()) {
+	case 0:
+		break;
+	case -ENOENT:
+		wget_fail("server did not send the file");
+		return true;
+	case -EPROTONOSUPPORT:
+		wget_fail("transfer encoding not supported");
+		return true;
+	default:
+		wget_fail("bad response from server");
+		return true;
+	}
+	if (wget_len_known && wget_load_size &&
+	    wget_content_len > wget_load_size) {
+		wget_fail("trying to overwrite reserved memory...");
+		return true;
+	}
+
+	/* Store the start of the body, which came with the header */
+	skip = wget_body_start - offset;
+	return wget_store(0, data + skip, len - skip);
+}
+
+static void wget_received(u32 len)
+{
+	if (!wget_hdr_done || net_state != NETLOOP_CONTINUE)
+		return;
+
+	net_boot_file_size = len - wget_body_start;
+	if (wget_len_known)
+		net_boot_file_size = min(net_boot_file_size, wget_content_len);
+
+	while (wget_num_hash < net_boot_file_size / WGET_HASH_BYTES) {
+		putc('#');
+		if (!(++wget_num_hash % HASHES_PER_LINE))
+			puts("\n\t ");
+	}
+
+	if (wget_len_known && net_boot_file_size == wget_content_len)
+		wget_complete();
+}
+
+static void wget_closed(int err)
+{
+	if (!wget_active || net_state != NETLOOP_CONTINUE)
+		return;
+
+	if (err == -ECONNRESET)
+		wget_fail("connection reset");
+	else if (err)
+		wget_fail("server not responding");
+	else if (!wget_hdr_done)
+		wget_fail("connection closed by server");
+	else if (wget_len_known)
+		wget_fail("connection closed before the end of the file");
+	else
+		wget_complete();
+}
+
+static const struct tcp_ops wget_ops = {
+	.connected	= wget_connected,
+	.rx		= wget_rx,
+	.received	= wget_received,
+	.closed		= wget_closed,
+};
+
+/* Initialize wget_load_addr and wget_load_size from image_load_addr and lmb */
+static int wget_init_load_addr(void)
+{
+#ifdef CONFIG_LMB
+	struct lmb lmb;
+	phys_size_t max_size;
+
+	lmb_init_and_reserve(&lmb, gd->bd, (void *)gd->fdt_blob);
+
+	max_size = lmb_get_free_size(&lmb, image_load_addr);
+	lmb_uninit(&lmb);
+	if (!max_size)
+		return -1;
+
+	wget_load_size = max_size;
+#endif
+	wget_load_addr = image_load_addr;
+	return 0;
+}
+
+void wget_start(void)
+{
+	char *ep;
+
+	wget_server_ip = net_server_ip;
+	if (!net_parse_bootfile(&wget_server_ip, wget_path,
+				sizeof(wget_path))) {
+		puts("*** ERROR: no file name given\n");
+		net_set_state(NETLOOP_FAIL);
+		return;
+	}
+	wget_server_port = WGET_HTTP_PORT;
+	ep = env_get("httpdstp");
+	if (ep)
+		wget_server_port = simple_strtol(ep, NULL, 10);
+
+	printf("Using %s device\n", eth_get_name());
+	printf("HTTP from server %pI4:%d; our IP address is %pI4\n",
+	       &wget_server_ip, wget_server_port, &net_ip);
+	printf("Filename '%s'.\n", wget_path);
+
+	if (wget_init_load_addr()) {
+		net_set_state(NETLOOP_FAIL);
+		puts("\nwget error: trying to overwrite reserved memory...\n");
+		return;
+	}
+	printf("Load address: 0x%lx\n", wget_load_addr);
+	puts("Loading: *\b");
+
+	wget_hdr_len = 0;
+	wget_hdr_done = false;
+	wget_body_start = 0;
+	wget_len_known = false;
+	wget_content_len = 0;
+	wget_num_hash = 0;
+	wget_time_start = get_timer(0);
+
+	if (tcp_connect(wget_server_ip, wget_server_port, &wget_ops)) {
+		net_set_state(NETLOOP_FAIL);
+		return;
+	}
+	wget_active = true;
+}
@@ -0,0 +1,215 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Test for the fitload command
+ *
+ * A FIT with external data is written to a host block device. The test
+ * checks where each image of the configuration ends up, and that images
+ * read straight to their load address never overlap the staging area or
+ * each other.
+ */
+
+#include <common.h>
+#include <command.h>
+#include <dm.h>
+#include <image.h>
+#include <malloc.h>
+#include <mapmem.h>
+#include <os.h>
+#include <sandboxblockdev.h>
+#include <dm/test.h>
+#include <linux/libfdt.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+#define FITLOAD_TEST_FILE	"fitload.img"
+/* Address the FIT structure is loaded to */
+#define FITLOAD_TEST_ADDR	0x100000
+#define FITLOAD_TEST_HDR_SIZE	0x1000
+#define FITLOAD_TEST_KERNEL	0x3000
+#define FITLOAD_TEST_RAMDISK	0x1800
+#define FITLOAD_TEST_FDT	0x800
+#define FITLOAD_TEST_MAX_IMAGES	3
+
+/* @name is also the property which refers to the image in the config */
+struct fitload_test_image {
+	const char *name;
+	const char *type;
+	int size;
+	ulong load;	/* 0 for none */
+	int offset;	/* offset of the data from the end of the FIT */
+};
+
+/* Write a FIT with @images as external data to the test file */
+static int fitload_test_write(struct unit_test_state *uts,
+			      struct fitload_test_image *images, int count,
+			      u8 *data, int data_size)
+{
+	int fit_size, size, i;
+	void *buf;
+
+	size = ALIGN(FITLOAD_TEST_HDR_SIZE + data_size, 512);
+	buf = calloc(1, size);
+	ut_assertnonnull(buf);
+
+	ut_assertok(fdt_create(buf, FITLOAD_TEST_HDR_SIZE));
+	ut_assertok(fdt_finish_reservemap(buf));
+	ut_assertok(fdt_begin_node(buf, ""));
+	ut_assertok(fdt_property_string(buf, FIT_DESC_PROP, "test"));
+	ut_assertok(fdt_begin_node(buf, FIT_IMAGES_PATH + 1));
+	for (i = 0; i < count; i++) {
+		ut_assertok(fdt_begin_node(buf, images[i].name));
+		ut_assertok(fdt_property_string(buf, FIT_DESC_PROP,
+						images[i].name));
+		ut_assertok(fdt_property_string(buf, FIT_TYPE_PROP,
+						images[i].type));
+		ut_assertok(fdt_property_string(buf, FIT_ARCH_PROP,
+						"sandbox"));
+		ut_assertok(fdt_property_string(buf, FIT_OS_PROP, "linux"));
+		ut_assertok(fdt_property_string(buf, FIT_COMP_PROP, "none"));
+		if (images[i].load) {
+			ut_assertok(fdt_property_u32(buf, FIT_LOAD_PROP,
+						     images[i].load));
+			ut_assertok(fdt_property_u32(buf, FIT_ENTRY_PROP,
+						     images[i].load));
+		}
+		ut_assertok(fdt_property_u32(buf, FIT_DATA_OFFSET_PROP,
+					     images[i].offset));
+		ut_assertok(fdt_property_u32(buf, FIT_DATA_SIZE_PROP,
+					     images[i].size));
+		ut_assertok(fdt_end_node(buf));
+	}
+	ut_assertok(fdt_end_node(buf));
+	ut_assertok(fdt_begin_node(buf, FIT_CONFS_PATH + 1));
+	ut_assertok(fdt_property_string(buf, FIT_DEFAULT_PROP, "conf-1"));
+	ut_assertok(fdt_begin_node(buf, "conf-1"));
+	for (i = 0; i < count; i++)
+		ut_assertok(fdt_property_string(buf, images[i].name,
+						images[i].name));
+	ut_assertok(fdt_end_node(buf));
+	ut_assertok(fdt_end_node(buf));
+	ut_assertok(fdt_end_node(buf));
+	ut_assertok(fdt_finish(buf));
+
+	/* The external data follows the FIT, as with mkimage -E */
+	fit_size = ALIGN(fdt_totalsize(buf), 4);
+	memcpy(buf + fit_size, data, data_size);
+	ut_assertok(os_write_file(FITLOAD_TEST_FILE, buf,
+				  ALIGN(fit_size + data_size, 512)));
+	free(buf);
+
+	return 0;
+}
+
+/* Get the address of the data of an image after fitload */
+static ulong fitload_test_addr(const void *fit, const char *name)
+{
+	int node, pos;
+
+	node = fdt_subnode_offset(fit, fdt_path_offset(fit, FIT_IMAGES_PATH),
+				  name);
+	if (node < 0 || fit_image_get_data_position(fit, node, &pos))
+		return 0;
+
+	return FITLOAD_TEST_ADDR + pos;
+}
+
+/*
+ * Run fitload on @images and check that each image's data is where its
+ * data-position property says, and at its load address if @direct is set
+ */
+static int fitload_test_run(struct unit_test_state *uts,
+			    struct fitload_test_image *images, int count,
+			    const bool *direct)
+{
+	ulong start[FITLOAD_TEST_MAX_IMAGES];
+	int data_size = 0, i, j;
+	u8 *data;
+	void *fit;
+
+	ut_assert(count <= FITLOAD_TEST_MAX_IMAGES);
+	for (i = 0; i < count; i++) {
+		images[i].offset = data_size;
+		data_size += images[i].size;
+	}
+	data = malloc(data_size);
+	ut_assertnonnull(data);
+	for (i = 0; i < data_size; i++)
+		data[i] = i * 7 + (i >> 8);
+	ut_assertok(fitload_test_write(uts, images, count, data, data_size));
+	ut_assertok(host_dev_bind(0, FITLOAD_TEST_FILE, false));
+
+	memset(map_sysmem(FITLOAD_TEST_ADDR, 0x100000), '\0', 0x100000);
+	ut_assertok(run_command("fitload host 0 100000", 0));
+
+	fit = map_sysmem(FITLOAD_TEST_ADDR, 0);
+	for (i = 0; i < count; i++) {
+		start[i] = fitload_test_addr(fit, images[i].name);
+		ut_assert(start[i]);
+		if (direct[i]) {
+			ut_asserteq(images[i].load, start[i]);
+		} else {
+			ut_assert(start[i] != images[i].load);
+		}
+		ut_asserteq_mem(data + images[i].offset,
+				map_sysmem(start[i], images[i].size),
+				images[i].size);
+	}
+
+	/* No two images share memory */
+	for (i = 0; i < count; i++) {
+		for (j = i + 1; j < count; j++)
+			ut_assert(start[j] >= start[i] + images[i].size ||
+				  start[i] >= start[j] + images[j].size);
+	}
+
+	ut_assertok(host_dev_bind(0, NULL, false));
+	ut_assertok(os_unlink(FITLOAD_TEST_FILE));
+	free(data);
+
+	return 0;
+}
+
+/* Test images read straight to load addresses well above the FIT */
+static int dm_test_fitload(struct unit_test_state *uts)
+{
+	struct fitload_test_image images[] = {
+		{ "kernel", "kernel", FITLOAD_TEST_KERNEL, 0x200000 },
+		{ "ramdisk", "ramdisk", FITLOAD_TEST_RAMDISK, 0x300000 },
+		{ "fdt", "flat_dt", FITLOAD_TEST_FDT, 0 },
+	};
+	static const bool direct[] = { true, true, false };
+
+	return fitload_test_run(uts, images, ARRAY_SIZE(images), direct);
+}
+DM_TEST(dm_test_fitload, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+
+/*
+ * Test a kernel whose load address is inside the staging area, just above
+ * the FIT, so reading it there would clobber the staged FDT
+ */
+static int dm_test_fitload_staging(struct unit_test_state *uts)
+{
+	struct fitload_test_image images[] = {
+		{ "kernel", "kernel", FITLOAD_TEST_KERNEL,
+		  FITLOAD_TEST_ADDR + FITLOAD_TEST_HDR_SIZE },
+		{ "fdt", "flat_dt", FITLOAD_TEST_FDT, 0 },
+	};
+	static const bool direct[] = { false, false };
+
+	return fitload_test_run(uts, images, ARRAY_SIZE(images), direct);
+}
+DM_TEST(dm_test_fitload_staging, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+
+/* Test two images whose load addresses overlap */
+static int dm_test_fitload_overlap(struct unit_test_state *uts)
+{
+	struct fitload_test_image images[] = {
+		{ "kernel", "kernel", FITLOAD_TEST_KERNEL, 0x200000 },
+		{ "ramdisk", "ramdisk", FITLOAD_TEST_RAMDISK,
+		  0x200000 + FITLOAD_TEST_KERNEL - 0x100 },
+	};
+	static const bool direct[] = { true, false };
+
+	return fitload_test_run(uts, images, ARRAY_SIZE(images), direct);
+}
+DM_TEST(dm_test_fitload_overlap, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
@@ -0,0 +1,333 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Test for the wget command and the TCP client underneath it
+ *
+ * A fake HTTP server is run in the transmit handler of the sandbox Ethernet
+ * driver. It drops one segment of the response, so the test also checks that
+ * the client reports the data after it with SACK and that only the lost
+ * segment is sent again.
+ */
+
+#include <common.h>
+#include <dm.h>
+#include <env.h>
+#include <image.h>
+#include <malloc.h>
+#include <mapmem.h>
+#include <net.h>
+#include <asm/eth.h>
+#include <dm/test.h>
+#include <net/tcp.h>
+#include <net/wget.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+#define WGET_TEST_ADDR		0x100000
+#define WGET_TEST_SIZE		(100 * 1024 + 123)
+/* Offset in the body of the segment which is lost */
+#define WGET_TEST_DROP		(20 * 1024)
+/* Start near the end of the sequence space, to check wrapping */
+#define WGET_TEST_ISS		0xffff0000
+
+struct wget_test_server {
+	struct unit_test_state *uts;
+	const char *status;	/* status line of the response */
+	char *resp;		/* the whole response */
+	int resp_len;
+	int client_port;
+	u32 client_seq;		/* next sequence number from the client */
+	u32 next;		/* next sequence number to send */
+	u32 drop_seq;		/* sequence number of the lost segment */
+	bool requested;
+	bool dropped;
+	bool saw_sack;
+	int resent;
+	bool reset;		/* the connection has been reset */
+	int late_tcp;		/* TCP segments sent after the download */
+};
+
+static u32 sb_http_end(struct wget_test_server *srv)
+{
+	return WGET_TEST_ISS + 1 + srv->resp_len;
+}
+
+static void sb_http_send(struct udevice *dev, struct wget_test_server *srv,
+			 u8 flags, u32 seq, const void *data, int len)
+{
+	static const uchar syn_opts[] = {
+		TCP_O_MSS, 4, TCP_MSS >> 8, TCP_MSS & 0xff,
+		TCP_O_NOP, TCP_O_WS, 3, 7,
+		TCP_O_NOP, TCP_O_NOP, TCP_O_SACK_PERM, 2,
+	};
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	int opt_len = flags & TCP_SYN ? sizeof(syn_opts) : 0;
+	int tcp_len = TCP_HDR_SIZE + opt_len + len;
+	struct ethernet_hdr *eth;
+	struct ip_tcp_hdr *tcp;
+	__be32 ph[3];
+
+	if (priv->recv_packets >= PKTBUFSRX)
+		return;
+
+	eth = (void *)priv->recv_packet_buffer[priv->recv_packets];
+	memcpy(eth->et_dest, net_ethaddr, ARP_HLEN);
+	memcpy(eth->et_src, priv->fake_host_hwaddr, ARP_HLEN);
+	eth->et_protlen = htons(PROT_IP);
+
+	tcp = (void *)eth + ETHER_HDR_SIZE;
+	net_set_ip_header((uchar *)tcp, net_ip, priv->fake_host_ipaddr,
+			  IP_HDR_SIZE + tcp_len, IPPROTO_TCP);
+	tcp->tcp_src = htons(WGET_HTTP_PORT);
+	tcp->tcp_dst = htons(srv->client_port);
+	tcp->tcp_seq = htonl(seq);
+	tcp->tcp_ack = htonl(srv->client_seq);
+	tcp->tcp_hlen = (TCP_HDR_SIZE + opt_len) / 4 << 4;
+	tcp->tcp_flags = flags | TCP_ACK;
+	tcp->tcp_win = htons(0xffff);
+	tcp->tcp_xsum = 0;
+	tcp->tcp_ugr = 0;
+	memcpy((uchar *)tcp + IP_TCP_HDR_SIZE, syn_opts, opt_len);
+	memcpy((uchar *)tcp + IP_TCP_HDR_SIZE + opt_len, data, len);
+
+	net_copy_ip(&ph[0], &tcp->ip_src);
+	net_copy_ip(&ph[1], &tcp->ip_dst);
+	ph[2] = htonl(IPPROTO_TCP << 16 | tcp_len);
+	tcp->tcp_xsum = add_ip_checksums(sizeof(ph),
+					 compute_ip_checksum(ph, sizeof(ph)),
+					 compute_ip_checksum(&tcp->tcp_src,
+							     tcp_len));
+
+	priv->recv_packet_length[priv->recv_packets++] =
+		ETHER_HDR_SIZE + IP_HDR_SIZE + tcp_len;
+}
+
+static void sb_http_send_data(struct udevice *dev,
+			      struct wget_test_server *srv, u32 seq)
+{
+	u32 pos = seq - WGET_TEST_ISS - 1;
+
+	sb_http_send(dev, srv, TCP_PUSH, seq, srv->resp + pos,
+		     min(TCP_MSS, srv->resp_len - (int)pos));
+}
+
+static bool sb_http_has_sack(struct ip_tcp_hdr *tcp, int hlen)
+{
+	uchar *opt = (uchar *)tcp + IP_TCP_HDR_SIZE;
+	uchar *end = (uchar *)tcp + IP_HDR_SIZE + hlen;
+
+	while (opt < end && *opt != TCP_O_END) {
+		if (*opt == TCP_O_NOP) {
+			opt++;
+			continue;
+		}
+		if (*opt == TCP_O_SACK)
+			return true;
+		opt += opt[1];
+	}
+
+	return false;
+}
+
+static int sb_http_handler(struct udevice *dev, void *packet,
+			   unsigned int len)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct wget_test_server *srv = priv->priv;
+	/* Used by all of the ut_assert macros */
+	struct unit_test_state *uts = srv->uts;
+	struct ethernet_hdr *eth = packet;
+	struct ip_tcp_hdr *tcp = packet + ETHER_HDR_SIZE;
+	u32 seq, body;
+	int hlen, dlen, sent;
+	char *data;
+
+	if (!sandbox_eth_arp_req_to_reply(dev, packet, len))
+		return 0;
+	if (ntohs(eth->et_protlen) != PROT_IP || tcp->ip_p != IPPROTO_TCP)
+		return 0;
+
+	ut_asserteq(WGET_HTTP_PORT, ntohs(tcp->tcp_dst));
+	if (tcp->tcp_flags & TCP_RST) {
+		srv->reset = true;
+		return 0;
+	}
+	hlen = (tcp->tcp_hlen >> 4) * 4;
+	dlen = ntohs(tcp->ip_len) - IP_HDR_SIZE - hlen;
+	data = (char *)tcp + IP_HDR_SIZE + hlen;
+	seq = ntohl(tcp->tcp_seq);
+
+	if (tcp->tcp_flags & TCP_SYN) {
+		/* The client must offer window scaling and SACK */
+		ut_asserteq(TCP_HDR_SIZE + 12, hlen);
+		srv->client_port = ntohs(tcp->tcp_src);
+		srv->client_seq = seq + 1;
+		srv->next = WGET_TEST_ISS + 1;
+		sb_http_send(dev, srv, TCP_SYN, WGET_TEST_ISS, NULL, 0);
+		return 0;
+	}
+
+	if (dlen && seq == srv->client_seq) {
+		ut_assert(!strncmp(data, "GET /file.bin HTTP/1.1\r\n", 24));
+		ut_assertnonnull(strstr(data, "\r\n\r\n"));
+		srv->client_seq += dlen;
+		srv->requested = true;
+	}
+	if (tcp->tcp_flags & TCP_FIN)
+		srv->client_seq = seq + dlen + 1;
+	if (!srv->requested)
+		return 0;
+
+	/* Send the lost segment again once the client has reported it */
+	if (sb_http_has_sack(tcp, hlen)) {
+		srv->saw_sack = true;
+		if (ntohl(tcp->tcp_ack) == srv->drop_seq && !srv->resent) {
+			sb_http_send_data(dev, srv, srv->drop_seq);
+			srv->resent++;
+		}
+	}
+
+	for (sent = 0; sent < 2 && srv->next != sb_http_end(srv); sent++) {
+		body = srv->next - WGET_TEST_ISS - 1;
+		if (!srv->dropped && body >= WGET_TEST_DROP) {
+			srv->dropped = true;
+			srv->drop_seq = srv->next;
+		} else {
+			sb_http_send_data(dev, srv, srv->next);
+		}
+		srv->next += min(TCP_MSS, (int)(sb_http_end(srv) - srv->next));
+	}
+
+	return 0;
+}
+
+/*
+ * Answer a ping, after sending a reset on the connection of a finished
+ * download, as a slow server might
+ */
+static int sb_http_late_handler(struct udevice *dev, void *packet,
+				unsigned int len)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct wget_test_server *srv = priv->priv;
+	struct ethernet_hdr *eth = packet;
+	struct ip_tcp_hdr *tcp = packet + ETHER_HDR_SIZE;
+
+	if (!srv->reset) {
+		sb_http_send(dev, srv, TCP_RST, sb_http_end(srv), NULL, 0);
+		srv->reset = true;
+	}
+	if (!sandbox_eth_arp_req_to_reply(dev, packet, len))
+		return 0;
+	if (!sandbox_eth_ping_req_to_reply(dev, packet, len))
+		return 0;
+	if (ntohs(eth->et_protlen) == PROT_IP && tcp->ip_p == IPPROTO_TCP)
+		srv->late_tcp++;
+
+	return 0;
+}
+
+static int wget_test_run(struct unit_test_state *uts,
+			 struct wget_test_server *srv, u8 *body)
+{
+	int hdr_len, i;
+
+	srv->uts = uts;
+	srv->resp = malloc(WGET_TEST_SIZE + 256);
+	ut_assertnonnull(srv->resp);
+	hdr_len = sprintf(srv->resp,
+			  "%s\r\nServer: test\r\ncontent-length: %d\r\n\r\n",
+			  srv->status, WGET_TEST_SIZE);
+	for (i = 0; i < WGET_TEST_SIZE; i++)
+		body[i] = i * 7 + (i >> 9);
+	memcpy(srv->resp + hdr_len, body, WGET_TEST_SIZE);
+	srv->resp_len = hdr_len + WGET_TEST_SIZE;
+
+	sandbox_eth_set_tx_handler(0, sb_http_handler);
+	/* Used by all of the ut_assert macros in the tx_handler */
+	sandbox_eth_set_priv(0, srv);
+
+	env_set("ethact", "eth@10002000");
+	image_load_addr = WGET_TEST_ADDR;
+	copy_filename(net_boot_file_name, "1.1.2.2:/file.bin",
+		      sizeof(net_boot_file_name));
+
+	return 0;
+}
+
+/* Test downloading a file, with one segment lost on the way */
+static int dm_test_wget(struct unit_test_state *uts)
+{
+	struct wget_test_server srv = { .status = "HTTP/1.1 200 OK" };
+	u8 *body;
+
+	body = malloc(WGET_TEST_SIZE);
+	ut_assertnonnull(body);
+	ut_assertok(wget_test_run(uts, &srv, body));
+	memset(map_sysmem(WGET_TEST_ADDR, WGET_TEST_SIZE), '\0',
+	       WGET_TEST_SIZE);
+
+	ut_asserteq(WGET_TEST_SIZE, net_loop(WGET));
+	ut_asserteq_mem(body, map_sysmem(WGET_TEST_ADDR, WGET_TEST_SIZE),
+			WGET_TEST_SIZE);
+
+	/* Only the lost segment was sent again */
+	ut_assert(srv.dropped);
+	ut_assert(srv.saw_sack);
+	ut_asserteq(1, srv.resent);
+
+	sandbox_eth_set_tx_handler(0, NULL);
+	free(srv.resp);
+	free(body);
+
+	return 0;
+}
+DM_TEST(dm_test_wget, UT_TESTF_SCAN_FDT);
+
+/* Test that an error from the server fails the download */
+static int dm_test_wget_not_found(struct unit_test_state *uts)
+{
+	struct wget_test_server srv = { .status = "HTTP/1.1 404 Not Found" };
+	u8 *body;
+
+	body = malloc(WGET_TEST_SIZE);
+	ut_assertnonnull(body);
+	ut_assertok(wget_test_run(uts, &srv, body));
+
+	ut_assert(net_loop(WGET) < 0);
+
+	sandbox_eth_set_tx_handler(0, NULL);
+	free(srv.resp);
+	free(body);
+
+	return 0;
+}
+DM_TEST(dm_test_wget_not_found, UT_TESTF_SCAN_FDT);
+
+/* Test that a reset from the server after a download is ignored */
+static int dm_test_wget_late_reset(struct unit_test_state *uts)
+{
+	struct wget_test_server srv = { .status = "HTTP/1.1 200 OK" };
+	u8 *body;
+
+	body = malloc(WGET_TEST_SIZE);
+	ut_assertnonnull(body);
+	ut_assertok(wget_test_run(uts, &srv, body));
+
+	ut_asserteq(WGET_TEST_SIZE, net_loop(WGET));
+	/* The client dropped the connection once it had the whole body */
+	ut_assert(srv.reset);
+
+	srv.reset = false;
+	sandbox_eth_set_tx_handler(0, sb_http_late_handler);
+	net_ping_ip = string_to_ip("1.1.2.2");
+	ut_assertok(net_loop(PING));
+	ut_assert(srv.reset);
+	ut_asserteq(0, srv.late_tcp);
+
+	sandbox_eth_set_tx_handler(0, NULL);
+	free(srv.resp);
+	free(body);
+
+	return 0;
+}
+DM_TEST(dm_test_wget_late_reset, UT_TESTF_SCAN_FDT);
@@ -122,6 +122,23 @@ static const char lz4_compressed[] =
 static const unsigned long lz4_compressed_size = 276;
 
 
+/* zstd -19 -c /tmp/plain.txt > /tmp/plain.zst */
+static const char zstd_compressed[] =
+	"\x28\xb5\x2f\xfd\x64\x5e\x00\xad\x05\x00\x42\x4e\x26\x17\x90\x3b"
+	"\x07\x04\x5a\x13\x8b\xa7\x65\x34\x12\x21\x6d\xb0\x39\xbb\xae\xe8"
+	"\xba\xc9\xcd\x5e\x02\x49\xd0\x2b\xa9\xfa\x96\x92\xe7\x1f\x19\x19"
+	"\x7c\x8f\xf1\x9d\x54\x37\xfc\xd6\x0a\xf3\x0c\x93\x56\xc7\x52\x4f"
+	"\x0a\x62\x3e\xd1\xa5\x83\x17\x31\xab\x5d\x8f\x57\xf3\xcc\x3b\x58"
+	"\xf8\x91\x8c\xf1\x2a\x5c\x89\xdd\xf2\x9b\x15\xb7\x92\x5b\xbe\xba"
+	"\xab\xd5\xd1\x34\xdf\xf0\x02\x0e\x61\xcd\x7b\xd6\x01\xfc\xc2\xa7"
+	"\xd4\xd1\x3d\x26\x9c\x10\x49\xb8\x5b\xcd\xba\x7c\xf7\xac\x4b\xad"
+	"\xb7\x31\x1c\xbc\xf9\xcb\x62\x8e\x2e\x9b\x0f\xd3\x87\x57\x45\x12"
+	"\x16\xfa\x3a\x79\xde\x65\xf8\xcc\x48\xd5\x43\xa6\xbd\xc3\x91\x29"
+	"\x65\x29\xa7\x5b\x9a\x08\x08\x00\x60\x13\x00\x63\xa3\x8e\x28\x94"
+	"\x79\x41\x2a\x78\xc2\x91\x70\x9f\xaa\x6a\x21\x7a\xa1\xaa\x0c\xe4"
+	"\xf4\x6e\xfa";
+static const unsigned long zstd_compressed_size = 195;
+
 #define TEST_BUFFER_SIZE	512
 
 typedef int (*mutate_func)(struct unit_test_state *uts, void *, unsigned long,
@@ -486,9 +503,7 @@ static int run_bootm_test(struct unit_test_state *uts, int comp_type,
 			   &load_end);
 	ut_assert(err);
 
-	/* We can't detect corruption when not decompressing */
-	if (comp_type == IH_COMP_NONE)
-		return 0;
+	/* The compressed stream is damaged */
 	memset(compress_buff + compress_size / 2, '\x49',
 	       compress_size / 2);
 	err = image_decomp(comp_type, load_addr, image_start,
@@ -536,6 +551,124 @@ static int compression_test_bootm_none(struct unit_test_state *uts)
 }
 COMPRESSION_TEST(compression_test_bootm_none, 0);
 
+#ifdef CONFIG_IMAGE_DECOMP_STREAM
+/* There is no zstd compressor in U-Boot, so use data compressed earlier */
+static int compress_using_zstd(struct unit_test_state *uts,
+			       void *in, unsigned long in_size,
+			       void *out, unsigned long out_max,
+			       unsigned long *out_size)
+{
+	ut_asserteq(strlen(plain), in_size);
+	ut_asserteq_mem(plain, in, in_size);
+	ut_assert(zstd_compressed_size <= out_max);
+	memcpy(out, zstd_compressed, zstd_compressed_size);
+	*out_size = zstd_compressed_size;
+
+	return 0;
+}
+
+struct mem_reader {
+	struct image_reader rd;
+	const void *buf;
+};
+
+static long mem_reader_read(struct image_reader *rd, ulong pos, void *buf,
+			    ulong len)
+{
+	struct mem_reader *mrd = container_of(rd, struct mem_reader, rd);
+
+	memcpy(buf, mrd->buf + pos, len);
+
+	return len;
+}
+
+static int stream_decomp(int comp_type, const void *in, ulong in_size,
+			 ulong load_addr, ulong unc_len, ulong *load_end)
+{
+	struct mem_reader mrd = {
+		.rd = { .read = mem_reader_read, .size = in_size },
+		.buf = in,
+	};
+
+	return image_decomp_stream(comp_type, load_addr,
+				   map_sysmem(load_addr, unc_len), &mrd.rd,
+				   unc_len, load_end);
+}
+
+/**
+ * run_stream_test() - Run tests on the streaming decompression function
+ *
+ * Every failure must be reported as a -ve error number, since callers
+ * take anything else as success.
+ *
+ * @comp_type:	Compression type to test
+ * @compress:	Our function to compress data
+ * Return: 0 if OK, non-zero on failure
+ */
+static int run_stream_test(struct unit_test_state *uts, int comp_type,
+			   mutate_func compress)
+{
+	ulong compress_size = 1024;
+	void *compress_buff;
+	int unc_len;
+	const ulong image_start = 0;
+	const ulong load_addr = 0x1000;
+	ulong load_end;
+
+	printf("Testing: %s\n", genimg_get_comp_name(comp_type));
+	compress_buff = map_sysmem(image_start, 0);
+	unc_len = strlen(plain);
+	ut_assertok(compress(uts, (void *)plain, unc_len, compress_buff,
+			     compress_size, &compress_size));
+
+	memset(map_sysmem(load_addr, unc_len), '\0', unc_len);
+	ut_assertok(stream_decomp(comp_type, compress_buff, compress_size,
+				  load_addr, unc_len, &load_end));
+	ut_asserteq(load_addr + unc_len, load_end);
+	ut_asserteq_mem(plain, map_sysmem(load_addr, unc_len), unc_len);
+
+	/* Not enough room for the output */
+	ut_assert(stream_decomp(comp_type, compress_buff, compress_size,
+				load_addr, unc_len - 1, &load_end) < 0);
+
+	/* The data ends before the compressed stream does */
+	ut_assert(stream_decomp(comp_type, compress_buff, compress_size / 2,
+				load_addr, 0x10000, &load_end) < 0);
+
+	/* The compressed stream is damaged */
+	memset(compress_buff + compress_size / 2, '\x49',
+	       compress_size / 2);
+	ut_assert(stream_decomp(comp_type, compress_buff, compress_size,
+				load_addr, 0x10000, &load_end) < 0);
+
+	return 0;
+}
+
+static int compression_test_stream_gzip(struct unit_test_state *uts)
+{
+	return run_stream_test(uts, IH_COMP_GZIP, compress_using_gzip);
+}
+COMPRESSION_TEST(compression_test_stream_gzip, 0);
+
+static int compression_test_stream_lzma(struct unit_test_state *uts)
+{
+	return run_stream_test(uts, IH_COMP_LZMA, compress_using_lzma);
+}
+COMPRESSION_TEST(compression_test_stream_lzma, 0);
+
+static int compression_test_stream_lz4(struct unit_test_state *uts)
+{
+	return run_stream_test(uts, IH_COMP_LZ4, compress_using_lz4);
+}
+COMPRESSION_TEST(compression_test_stream_lz4, 0);
+
+static int compression_test_stream_zstd(struct unit_test_state *uts)
+{
+	return run_stream_test(uts, IH_COMP_ZSTD, compress_using_zstd);
+}
+COMPRESSION_TEST(compression_test_stream_zstd, 0);
+#endif /* CONFIG_IMAGE_DECOMP_STREAM */
+
 int do_ut_compression(struct cmd_tbl *cmdtp, int flag, int argc,
 		      char *const argv[])
 {
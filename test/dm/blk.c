@@ -5,7 +5,10 @@
 
 #include <common.h>
 #include <dm.h>
+#include <malloc.h>
+#include <os.h>
 #include <part.h>
+#include <sandboxblockdev.h>
 #include <usb.h>
 #include <asm/global_data.h>
 #include <asm/state.h>
@@ -217,3 +220,211 @@ static int dm_test_blk_iter(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_blk_iter, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+
+#define BLK_ASYNC_BLOCKS	8
+#define BLK_ASYNC_SIZE		(BLK_ASYNC_BLOCKS * 512)
+
+/* Test asynchronous requests on a device which supports them */
+static int dm_test_blk_async(struct unit_test_state *uts)
+{
+	struct blk_req req[SANDBOX_HOST_QUEUE_DEPTH + 1];
+	u8 src[BLK_ASYNC_SIZE], buf[BLK_ASYNC_SIZE];
+	struct blk_desc *desc;
+	int i;
+
+	for (i = 0; i < BLK_ASYNC_SIZE; i++)
+		src[i] = i * 13 + (i >> 9);
+	ut_assertok(os_write_file("blk_async.img", src, BLK_ASYNC_SIZE));
+	ut_assertok(host_dev_bind(0, "blk_async.img", false));
+	desc = blk_get_devnum_by_type(IF_TYPE_HOST, 0);
+	ut_assertnonnull(desc);
+
+	/* Keep as many reads in flight as the device takes */
+	memset(buf, '\0', sizeof(buf));
+	for (i = 0; i < ARRAY_SIZE(req); i++) {
+		req[i].start = i * 2;
+		req[i].blkcnt = 2;
+		req[i].buffer = buf + i * 1024;
+		req[i].write = false;
+	}
+	ut_assertok(blk_submit(desc, &req[0]));
+	ut_assertok(blk_submit(desc, &req[1]));
+	ut_asserteq(-EBUSY, blk_submit(desc, &req[2]));
+
+	ut_asserteq(-EAGAIN, blk_poll(desc, &req[0]));
+	ut_assert(!req[0].done);
+	ut_assertok(blk_poll(desc, &req[0]));
+	ut_assert(req[0].done);
+	ut_asserteq(2, req[0].result);
+
+	/* The slot of the completed request can be used again */
+	ut_assertok(blk_submit(desc, &req[2]));
+	ut_asserteq(2, blk_wait(desc, &req[1]));
+	ut_asserteq(2, blk_wait(desc, &req[2]));
+	ut_asserteq_mem(src, buf, 3 * 1024);
+
+	/* Write back, then read the whole device synchronously */
+	for (i = 0; i < BLK_ASYNC_SIZE; i++)
+		buf[i] = ~src[i];
+	req[0].start = 0;
+	req[0].blkcnt = BLK_ASYNC_BLOCKS;
+	req[0].buffer = buf;
+	req[0].write = true;
+	ut_assertok(blk_submit(desc, &req[0]));
+	ut_asserteq(BLK_ASYNC_BLOCKS, blk_wait(desc, &req[0]));
+
+	memset(src, '\0', sizeof(src));
+	ut_asserteq(BLK_ASYNC_BLOCKS,
+		    blk_dread(desc, 0, BLK_ASYNC_BLOCKS, src));
+	ut_asserteq_mem(buf, src, BLK_ASYNC_SIZE);
+
+	ut_assertok(host_dev_bind(0, NULL, false));
+	ut_assertok(os_unlink("blk_async.img"));
+
+	return 0;
+}
+DM_TEST(dm_test_blk_async, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+
+/* Test that asynchronous requests work on a device without support */
+static int dm_test_blk_async_sync(struct unit_test_state *uts)
+{
+	u8 src[BLK_ASYNC_SIZE], buf[BLK_ASYNC_SIZE];
+	struct blk_desc *desc;
+	struct blk_req req;
+	int i;
+
+	desc = blk_get_devnum_by_type(IF_TYPE_MMC, 0);
+	ut_assertnonnull(desc);
+
+	for (i = 0; i < BLK_ASYNC_SIZE; i++)
+		src[i] = i * 7;
+	req.start = 1;
+	req.blkcnt = BLK_ASYNC_BLOCKS;
+	req.buffer = src;
+	req.write = true;
+	ut_assertok(blk_submit(desc, &req));
+	ut_assert(req.done);
+	ut_asserteq(BLK_ASYNC_BLOCKS, blk_wait(desc, &req));
+
+	memset(buf, '\0', sizeof(buf));
+	req.buffer = buf;
+	req.write = false;
+	ut_assertok(blk_submit(desc, &req));
+	ut_assertok(blk_poll(desc, &req));
+	ut_asserteq(BLK_ASYNC_BLOCKS, req.result);
+	ut_asserteq_mem(src, buf, BLK_ASYNC_SIZE);
+
+	return 0;
+}
+DM_TEST(dm_test_blk_async_sync, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+
+#ifdef CONFIG_BLOCK_CACHE
+#define BLK_CACHE_BLOCKS	64
+#define BLK_CACHE_SIZE		(BLK_CACHE_BLOCKS * 512)
+#define BLK_CACHE_LINE		4	/* blocks per cache line */
+#define BLK_CACHE_ENTRIES	8	/* the budget of a device is 6 lines */
+
+/* Read blocks with blk_dread() and check they match @src */
+static int blk_cache_check(struct unit_test_state *uts,
+			   struct blk_desc *desc, const u8 *src,
+			   lbaint_t start, lbaint_t blkcnt)
+{
+	u8 buf[BLK_CACHE_LINE * 2 * 512];
+
+	ut_assert(blkcnt <= ARRAY_SIZE(buf) / 512);
+	memset(buf, '\0', sizeof(buf));
+	ut_asserteq(blkcnt, blk_dread(desc, start, blkcnt, buf));
+	ut_asserteq_mem(src + start * 512, buf, blkcnt * 512);
+
+	return 0;
+}
+
+/* Test the block cache on host devices */
+static int dm_test_blk_cache(struct unit_test_state *uts)
+{
+	struct block_cache_stats stats, old;
+	struct blk_desc *desc, *desc1;
+	u8 *src;
+	int i;
+
+	src = malloc(BLK_CACHE_SIZE);
+	ut_assertnonnull(src);
+	for (i = 0; i < BLK_CACHE_SIZE; i++)
+		src[i] = i * 11 + (i >> 9);
+	ut_assertok(os_write_file("blk_cache.img", src, BLK_CACHE_SIZE));
+	ut_assertok(host_dev_bind(0, "blk_cache.img", false));
+	ut_assertok(host_dev_bind(1, "blk_cache.img", false));
+	desc = blk_get_devnum_by_type(IF_TYPE_HOST, 0);
+	ut_assertnonnull(desc);
+	desc1 = blk_get_devnum_by_type(IF_TYPE_HOST, 1);
+	ut_assertnonnull(desc1);
+
+	/* Start empty, with small lines so a few reads fill the cache */
+	blkcache_stats(&old);
+	blkcache_configure(BLK_CACHE_LINE, BLK_CACHE_ENTRIES);
+
+	/*
+	 * Fill the end of line 0 and the start of line 1, then read across
+	 * both. None of these reads continue the previous one.
+	 */
+	ut_assertok(blk_cache_check(uts, desc, src, 4, 2));
+	ut_assertok(blk_cache_check(uts, desc, src, 2, 2));
+	ut_assertok(blk_cache_check(uts, desc, src, 2, 4));
+	blkcache_stats(&stats);
+	ut_asserteq(1, stats.hits);
+	ut_asserteq(2, stats.misses);
+	ut_asserteq(0, stats.readaheads);
+
+	/* Writing drops the cached blocks of the device */
+	for (i = 2 * 512; i < 6 * 512; i++)
+		src[i] = ~src[i];
+	ut_asserteq(4, blk_dwrite(desc, 2, 4, src + 2 * 512));
+	ut_assertok(blk_cache_check(uts, desc, src, 2, 4));
+	blkcache_stats(&stats);
+	ut_asserteq(0, stats.hits);
+	ut_asserteq(2, stats.entries);
+
+	/* A stream at the end of the device does not read ahead past it */
+	ut_assertok(blk_cache_check(uts, desc, src, BLK_CACHE_BLOCKS - 4, 1));
+	ut_assertok(blk_cache_check(uts, desc, src, BLK_CACHE_BLOCKS - 3, 1));
+	blkcache_stats(&stats);
+	ut_asserteq(1, stats.readaheads);
+	ut_asserteq(2, stats.ra_blocks);
+	ut_assertok(blk_cache_check(uts, desc, src, BLK_CACHE_BLOCKS - 2, 2));
+	blkcache_stats(&stats);
+	ut_asserteq(1, stats.hits);
+
+	/*
+	 * Fill the cache with two lines of host 1 and six of host 0. Host 0
+	 * is then at its budget, so its next line must replace its own
+	 * oldest line, not those of host 1.
+	 */
+	blkcache_invalidate(IF_TYPE_HOST, 0);
+	for (i = 0; i < 2; i++)
+		ut_assertok(blk_cache_check(uts, desc1, src,
+					    i * BLK_CACHE_LINE + 1, 1));
+	for (i = 2; i < 9; i++)
+		ut_assertok(blk_cache_check(uts, desc, src,
+					    i * BLK_CACHE_LINE + 1, 1));
+	blkcache_stats(&stats);
+	ut_asserteq(0, stats.hits);
+	ut_asserteq(BLK_CACHE_ENTRIES, stats.entries);
+	for (i = 0; i < 2; i++)
+		ut_assertok(blk_cache_check(uts, desc1, src,
+					    i * BLK_CACHE_LINE + 1, 1));
+	blkcache_stats(&stats);
+	ut_asserteq(2, stats.hits);
+	ut_assertok(blk_cache_check(uts, desc, src, 2 * BLK_CACHE_LINE + 1, 1));
+	blkcache_stats(&stats);
+	ut_asserteq(0, stats.hits);
+
+	blkcache_configure(old.max_blocks_per_entry, old.max_entries);
+	ut_assertok(host_dev_bind(1, NULL, false));
+	ut_assertok(host_dev_bind(0, NULL, false));
+	ut_assertok(os_unlink("blk_cache.img"));
+	free(src);
+
+	return 0;
+}
+DM_TEST(dm_test_blk_cache, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+#endif /* CONFIG_BLOCK_CACHE */
@@ -5,10 +5,13 @@
  */
 
 #include <common.h>
+#include <hash.h>
 #include <image.h>
+#include <malloc.h>
 #include <mapmem.h>
 #include <os.h>
 #include <spl.h>
+#include <linux/libfdt.h>
 #include <test/ut.h>
 
 /* Declare a new SPL test */
@@ -93,3 +96,130 @@ static int spl_test_load(struct unit_test_state *uts)
 	return 0;
 }
 SPL_TEST(spl_test_load, 0);
+
+#ifdef CONFIG_SPL_FIT_STREAM_HASH
+/* Load address and size of the image in the streaming test FIT */
+#define TEST_FIT_LOAD		0x200000
+/* Spans two hash chunks and is not a multiple of the block size */
+#define TEST_FIT_DATA_SIZE	(CONFIG_SPL_FIT_STREAM_HASH_CHUNK_SIZE + 0x1234)
+#define TEST_FIT_HDR_SIZE	0x1000
+#define TEST_FIT_BLK_SIZE	512
+
+static ulong read_fit_mem(struct spl_load_info *load, ulong sector,
+			  ulong count, void *buf)
+{
+	memcpy(buf, load->priv + sector * load->bl_len,
+	       count * load->bl_len);
+
+	return count;
+}
+
+/* Build a FIT with one image held as external data, checked by @algo */
+static int spl_test_build_fit(struct unit_test_state *uts, void *fit,
+			      const char *algo, bool corrupt)
+{
+	u8 value[HASH_MAX_DIGEST_SIZE];
+	void *data;
+	int value_len, i;
+
+	data = fit + TEST_FIT_HDR_SIZE;
+	value_len = sizeof(value);
+	for (i = 0; i < TEST_FIT_DATA_SIZE; i++)
+		((u8 *)data)[i] = i * 13 + (i >> 11);
+	ut_assertok(hash_block(algo, data, TEST_FIT_DATA_SIZE, value,
+			       &value_len));
+	if (corrupt)
+		value[0] ^= 1;
+
+	ut_assertok(fdt_create(fit, TEST_FIT_HDR_SIZE));
+	ut_assertok(fdt_finish_reservemap(fit));
+	ut_assertok(fdt_begin_node(fit, ""));
+	ut_assertok(fdt_property_string(fit, FIT_DESC_PROP, "test"));
+	ut_assertok(fdt_begin_node(fit, FIT_IMAGES_PATH + 1));
+	ut_assertok(fdt_begin_node(fit, "firmware"));
+	ut_assertok(fdt_property_string(fit, FIT_TYPE_PROP, "firmware"));
+	ut_assertok(fdt_property_string(fit, FIT_OS_PROP,
+					"arm-trusted-firmware"));
+	ut_assertok(fdt_property_string(fit, FIT_COMP_PROP, "none"));
+	ut_assertok(fdt_property_u32(fit, FIT_LOAD_PROP, TEST_FIT_LOAD));
+	ut_assertok(fdt_property_u32(fit, FIT_DATA_POSITION_PROP,
+				     TEST_FIT_HDR_SIZE));
+	ut_assertok(fdt_property_u32(fit, FIT_DATA_SIZE_PROP,
+				     TEST_FIT_DATA_SIZE));
+	ut_assertok(fdt_begin_node(fit, "hash-1"));
+	ut_assertok(fdt_property_string(fit, FIT_ALGO_PROP, algo));
+	ut_assertok(fdt_property(fit, FIT_VALUE_PROP, value, value_len));
+	ut_assertok(fdt_end_node(fit));
+	ut_assertok(fdt_end_node(fit));
+	ut_assertok(fdt_end_node(fit));
+	ut_assertok(fdt_begin_node(fit, FIT_CONFS_PATH + 1));
+	ut_assertok(fdt_property_string(fit, FIT_DEFAULT_PROP, "conf-1"));
+	ut_assertok(fdt_begin_node(fit, "conf-1"));
+	ut_assertok(fdt_property_string(fit, FIT_FIRMWARE_PROP,
+					"firmware"));
+	ut_assertok(fdt_end_node(fit));
+	ut_assertok(fdt_end_node(fit));
+	ut_assertok(fdt_end_node(fit));
+	ut_assertok(fdt_finish(fit));
+
+	return 0;
+}
+
+/* Load the test FIT, returning the result of spl_load_simple_fit() */
+static int spl_test_load_fit(struct unit_test_state *uts, const char *algo,
+			     bool corrupt, int *retp)
+{
+	struct spl_image_info image;
+	struct spl_load_info load;
+	int size;
+	void *fit;
+
+	size = ALIGN(TEST_FIT_HDR_SIZE + TEST_FIT_DATA_SIZE,
+		     TEST_FIT_BLK_SIZE);
+	fit = calloc(1, size);
+	ut_assertnonnull(fit);
+	ut_assertok(spl_test_build_fit(uts, fit, algo, corrupt));
+	memset(map_sysmem(TEST_FIT_LOAD, TEST_FIT_DATA_SIZE), '\0',
+	       TEST_FIT_DATA_SIZE);
+
+	memset(&load, '\0', sizeof(load));
+	load.bl_len = TEST_FIT_BLK_SIZE;
+	load.read = read_fit_mem;
+	load.priv = fit;
+	memset(&image, '\0', sizeof(image));
+	*retp = spl_load_simple_fit(&image, &load, 0, fit);
+
+	if (!*retp) {
+		ut_asserteq(TEST_FIT_LOAD, image.load_addr);
+		ut_asserteq_mem(fit + TEST_FIT_HDR_SIZE,
+				map_sysmem(TEST_FIT_LOAD, TEST_FIT_DATA_SIZE),
+				TEST_FIT_DATA_SIZE);
+	}
+	free(fit);
+
+	return 0;
+}
+
+/* Test hashing external data while it is read, with each algorithm */
+static int spl_test_fit_stream_hash(struct unit_test_state *uts)
+{
+	static const char *const algos[] = {
+		"crc32", "crc16-ccitt", "sha1", "sha256",
+	};
+	struct hash_algo *algo;
+	int i, ret;
+
+	for (i = 0; i < ARRAY_SIZE(algos); i++) {
+		if (hash_progressive_lookup_algo(algos[i], &algo))
+			continue;
+
+		ut_assertok(spl_test_load_fit(uts, algos[i], false, &ret));
+		ut_assertok(ret);
+		ut_assertok(spl_test_load_fit(uts, algos[i], true, &ret));
+		ut_asserteq(-EPERM, ret);
+	}
+
+	return 0;
+}
+SPL_TEST(spl_test_fit_stream_hash, 0);
+#endif /* CONFIG_SPL_FIT_STREAM_HASH */
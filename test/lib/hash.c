@@ -0,0 +1,160 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for the hash algorithms and their throughput measurement
+ */
+
+#include <common.h>
+#include <hash.h>
+#include <malloc.h>
+#include <linux/sizes.h>
+#include <test/lib.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+#define HASH_TEST_BUF_SIZE	(SZ_4K + 64)
+
+/* Spend as little time as possible timing, this only checks the plumbing */
+#define HASH_TEST_MIN_US	1000
+
+static const uint hash_test_sizes[] = { 0, 1, 63, 64, 65, 127, 129, SZ_4K };
+static const uint hash_test_aligns[] = { 0, 1, 3, 8 };
+static const uint hash_test_chunks[] = { 1, 13, 64, 1000 };
+
+static u8 *hash_test_buf(void)
+{
+	u8 *buf;
+	int i;
+
+	buf = memalign(64, HASH_TEST_BUF_SIZE);
+	if (buf) {
+		for (i = 0; i < HASH_TEST_BUF_SIZE; i++)
+			buf[i] = i * 7 + (i >> 8);
+	}
+
+	return buf;
+}
+
+/* Compute a digest in chunks, as hash_bench() does */
+static int hash_test_chunked(struct unit_test_state *uts,
+			     struct hash_algo *algo, const u8 *buf, uint size,
+			     uint chunk, u8 *digest)
+{
+	uint pos, len;
+	void *ctx;
+
+	ut_assertok(algo->hash_init(algo, &ctx));
+	for (pos = 0; pos < size; pos += len) {
+		len = min(chunk, size - pos);
+		ut_assertok(algo->hash_update(algo, ctx, buf + pos, len,
+					      pos + len == size));
+	}
+	ut_assertok(algo->hash_finish(algo, ctx, digest,
+				      HASH_MAX_DIGEST_SIZE));
+
+	return 0;
+}
+
+/* Test that chunked and one-shot hashing agree for odd sizes and alignments */
+static int lib_test_hash_chunked(struct unit_test_state *uts)
+{
+	u8 oneshot[HASH_MAX_DIGEST_SIZE], chunked[HASH_MAX_DIGEST_SIZE];
+	struct hash_algo *algo;
+	int i, s, a, c;
+	u8 *buf;
+
+	buf = hash_test_buf();
+	ut_assertnonnull(buf);
+
+	for (i = 0; !hash_lookup_algo_index(i, &algo); i++) {
+		if (!algo->hash_init)
+			continue;
+		for (s = 0; s < ARRAY_SIZE(hash_test_sizes); s++) {
+			uint size = hash_test_sizes[s];
+
+			for (a = 0; a < ARRAY_SIZE(hash_test_aligns); a++) {
+				const u8 *data = buf + hash_test_aligns[a];
+
+				algo->hash_func_ws(data, size, oneshot,
+						   algo->chunk_size);
+				for (c = 0; c < ARRAY_SIZE(hash_test_chunks);
+				     c++) {
+					ut_assertok(hash_test_chunked(uts, algo,
+						data, size, hash_test_chunks[c],
+						chunked));
+					ut_asserteq_mem(oneshot, chunked,
+							algo->digest_size);
+				}
+			}
+		}
+	}
+	free(buf);
+
+	return 0;
+}
+LIB_TEST(lib_test_hash_chunked, 0);
+
+/* Test timing each algorithm */
+static int lib_test_hash_bench(struct unit_test_state *uts)
+{
+	struct hash_bench_result res;
+	struct hash_algo *algo;
+	int i, ret;
+	u8 *buf;
+
+	buf = hash_test_buf();
+	ut_assertnonnull(buf);
+
+	ut_assertok(hash_lookup_algo_index(0, &algo));
+	ut_asserteq(-ENOENT, hash_lookup_algo_index(-1, &algo));
+
+	for (i = 0; !hash_lookup_algo_index(i, &algo); i++) {
+		ut_assertok(hash_bench(algo, buf + 1, SZ_4K, 0,
+				       HASH_TEST_MIN_US, &res));
+		ut_assert(res.time_us >= HASH_TEST_MIN_US);
+		ut_assert(res.bytes >= SZ_4K);
+		ut_asserteq(0, (ulong)(res.bytes % SZ_4K));
+
+		ret = hash_bench(algo, buf, SZ_4K, 512, HASH_TEST_MIN_US,
+				 &res);
+		if (!algo->hash_init) {
+			ut_asserteq(-ENOSYS, ret);
+			continue;
+		}
+		ut_assertok(ret);
+		ut_assert(res.time_us >= HASH_TEST_MIN_US);
+		ut_assert(res.bytes >= SZ_4K);
+	}
+	ut_assert(i > 0);
+	free(buf);
+
+	return 0;
+}
+LIB_TEST(lib_test_hash_bench, 0);
+
+/* Test the throughput and cycles-per-byte calculations */
+static int lib_test_hash_bench_calc(struct unit_test_state *uts)
+{
+	struct hash_bench_result res;
+
+	/* 250 MB in two seconds */
+	res.bytes = 250000000;
+	res.time_us = 2000000;
+	ut_asserteq(1250, hash_bench_rate(&res));
+	/* 1 GHz gives 8 cycles per byte */
+	ut_asserteq(800, hash_bench_cpb(&res, 1000000000));
+
+	/* 3 bytes in 2 us */
+	res.bytes = 3;
+	res.time_us = 2;
+	ut_asserteq(15, hash_bench_rate(&res));
+
+	/* Too quick to measure */
+	res.time_us = 0;
+	ut_asserteq(30, hash_bench_rate(&res));
+
+	res.bytes = 0;
+	ut_asserteq(0, hash_bench_cpb(&res, 1000000000));
+
+	return 0;
+}
+LIB_TEST(lib_test_hash_bench_calc, 0);
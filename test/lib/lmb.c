@@ -677,52 +677,59 @@ static int lib_test_lmb_max_regions(struct unit_test_state *uts)
 	lmb_init(&lmb);
 
 	ut_asserteq(lmb.memory.cnt, 0);
-	ut_asserteq(lmb.memory.max, 8);
+	ut_asserteq(lmb.memory.max, LMB_MEMORY_REGIONS);
 	ut_asserteq(lmb.reserved.cnt, 0);
-	ut_asserteq(lmb.reserved.max, 8);
+	ut_asserteq(lmb.reserved.max, LMB_RESERVED_REGIONS);
 
-	/*  Add 8 memory regions */
-	for (i = 0; i < 8; i++) {
+	/*  Fill the memory regions held in struct lmb */
+	for (i = 0; i < LMB_MEMORY_REGIONS; i++) {
 		offset = ram + 2 * i * ram_size;
 		ret = lmb_add(&lmb, offset, ram_size);
 		ut_asserteq(ret, 0);
 	}
-	ut_asserteq(lmb.memory.cnt, 8);
+	ut_asserteq(lmb.memory.cnt, LMB_MEMORY_REGIONS);
 	ut_asserteq(lmb.reserved.cnt, 0);
+	ut_asserteq_ptr(lmb.memory.region, lmb.memory_regions);
 
-	/*  error for the 9th memory regions */
-	offset = ram + 2 * 8 * ram_size;
+	/*  the next memory region moves them to the heap */
+	offset = ram + 2 * LMB_MEMORY_REGIONS * ram_size;
 	ret = lmb_add(&lmb, offset, ram_size);
-	ut_asserteq(ret, -1);
+	ut_asserteq(ret, 0);
 
-	ut_asserteq(lmb.memory.cnt, 8);
+	ut_asserteq(lmb.memory.cnt, LMB_MEMORY_REGIONS + 1);
+	ut_assert(lmb.memory.max > LMB_MEMORY_REGIONS);
+	ut_assert(lmb.memory.region != lmb.memory_regions);
 	ut_asserteq(lmb.reserved.cnt, 0);
 
-	/*  reserve 8 regions */
-	for (i = 0; i < 8; i++) {
+	/*  Fill the reserved regions held in struct lmb */
+	for (i = 0; i < LMB_RESERVED_REGIONS; i++) {
 		offset = ram + 2 * i * blk_size;
 		ret = lmb_reserve(&lmb, offset, blk_size);
 		ut_asserteq(ret, 0);
 	}
 
-	ut_asserteq(lmb.memory.cnt, 8);
-	ut_asserteq(lmb.reserved.cnt, 8);
+	ut_asserteq(lmb.memory.cnt, LMB_MEMORY_REGIONS + 1);
+	ut_asserteq(lmb.reserved.cnt, LMB_RESERVED_REGIONS);
 
-	/*  error for the 9th reserved blocks */
-	offset = ram + 2 * 8 * blk_size;
+	/*  the next reserved block also moves to the heap */
+	offset = ram + 2 * LMB_RESERVED_REGIONS * blk_size;
 	ret = lmb_reserve(&lmb, offset, blk_size);
-	ut_asserteq(ret, -1);
+	ut_asserteq(ret, 0);
 
-	ut_asserteq(lmb.memory.cnt, 8);
-	ut_asserteq(lmb.reserved.cnt, 8);
+	ut_asserteq(lmb.memory.cnt, LMB_MEMORY_REGIONS + 1);
+	ut_asserteq(lmb.reserved.cnt, LMB_RESERVED_REGIONS + 1);
 
 	/*  check each regions */
-	for (i = 0; i < 8; i++)
+	for (i = 0; i <= LMB_MEMORY_REGIONS; i++)
 		ut_asserteq(lmb.memory.region[i].base, ram + 2 * i * ram_size);
 
-	for (i = 0; i < 8; i++)
+	for (i = 0; i <= LMB_RESERVED_REGIONS; i++)
 		ut_asserteq(lmb.reserved.region[i].base, ram + 2 * i * blk_size);
 
+	lmb_uninit(&lmb);
+	ut_asserteq(lmb.memory.cnt, 0);
+	ut_asserteq(lmb.reserved.cnt, 0);
+
 	return 0;
 }
 
@@ -817,3 +824,168 @@ static int lib_test_lmb_flags(struct unit_test_state *uts)
 
 DM_TEST(lib_test_lmb_flags,
 	UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+
+/* Size of the memory used by the stress test, in pages of LMB_STRESS_PAGE */
+#define LMB_STRESS_PAGES	0x4000
+#define LMB_STRESS_PAGE		0x1000
+#define LMB_STRESS_OPS		5000
+
+static uint lmb_stress_seed;
+
+static uint lmb_stress_rand(uint range)
+{
+	lmb_stress_seed = lmb_stress_seed * 1103515245 + 12345;
+
+	return (lmb_stress_seed >> 8) % range;
+}
+
+/* Check that the reserved regions match the reference bitmap exactly */
+static int lmb_stress_check(struct unit_test_state *uts, struct lmb *lmb,
+			    phys_addr_t ram, const u8 *map)
+{
+	struct lmb_region *rgn = &lmb->reserved;
+	uint page, r, end;
+
+	for (r = 0; r < rgn->cnt; r++) {
+		phys_addr_t base = rgn->region[r].base;
+		phys_size_t size = rgn->region[r].size;
+
+		ut_assert(size);
+		/* Sorted, disjoint and fully coalesced */
+		if (r)
+			ut_assert(rgn->region[r - 1].base +
+				  rgn->region[r - 1].size < base);
+		ut_assert(base >= ram);
+		ut_asserteq(0, (base - ram) % LMB_STRESS_PAGE);
+		ut_asserteq(0, size % LMB_STRESS_PAGE);
+	}
+
+	/* Walk the runs of the bitmap alongside the regions */
+	r = 0;
+	for (page = 0; page < LMB_STRESS_PAGES; page = end) {
+		for (end = page; end < LMB_STRESS_PAGES &&
+		     map[end] == map[page]; end++)
+			;
+		if (!map[page])
+			continue;
+		ut_assert(r < rgn->cnt);
+		ut_asserteq(ram + page * LMB_STRESS_PAGE,
+			    rgn->region[r].base);
+		ut_asserteq((end - page) * LMB_STRESS_PAGE,
+			    rgn->region[r].size);
+		r++;
+	}
+	ut_asserteq(r, rgn->cnt);
+
+	/* Spot-check the lookups */
+	for (r = 0; r < 16; r++) {
+		phys_size_t expect = 0;
+		phys_addr_t addr;
+
+		page = lmb_stress_rand(LMB_STRESS_PAGES);
+		addr = ram + page * LMB_STRESS_PAGE;
+		ut_asserteq(map[page], lmb_is_reserved(lmb, addr));
+		for (end = page; end < LMB_STRESS_PAGES && !map[end]; end++)
+			expect += LMB_STRESS_PAGE;
+		if (!map[page])
+			ut_asserteq(expect, lmb_get_free_size(lmb, addr));
+	}
+
+	return 0;
+}
+
+/*
+ * Run a long random sequence of reservations, allocations and frees against
+ * a bitmap of pages, so that many more regions are in use than fit into
+ * struct lmb.
+ */
+static int lib_test_lmb_stress(struct unit_test_state *uts)
+{
+	const phys_addr_t ram = 0x40000000;
+	uint page, pages, i, op;
+	phys_addr_t addr;
+	struct lmb lmb;
+	ulong max_cnt = 0;
+	long ret;
+	u8 *map;
+
+	map = calloc(1, LMB_STRESS_PAGES);
+	ut_assertnonnull(map);
+	lmb_stress_seed = 1;
+
+	lmb_init(&lmb);
+	ut_assertok(lmb_add(&lmb, ram, LMB_STRESS_PAGES * LMB_STRESS_PAGE));
+
+	for (op = 0; op < LMB_STRESS_OPS; op++) {
+		bool used = false;
+
+		pages = 1 + lmb_stress_rand(8);
+		page = lmb_stress_rand(LMB_STRESS_PAGES - pages);
+		addr = ram + page * LMB_STRESS_PAGE;
+		for (i = page; i < page + pages; i++)
+			used |= map[i];
+
+		switch (lmb_stress_rand(4)) {
+		case 0:
+		case 1:
+			/*
+			 * Reserve a range, which fails if any of it is used,
+			 * unless it matches an existing region exactly
+			 */
+			ret = lmb_reserve(&lmb, addr, pages * LMB_STRESS_PAGE);
+			if (used) {
+				if (ret)
+					ut_asserteq(-2, ret);
+				for (i = page; !ret && i < page + pages; i++)
+					ut_assert(map[i]);
+				break;
+			}
+			ut_assert(ret >= 0);
+			memset(map + page, 1, pages);
+			break;
+		case 2:
+			/* Free part of a reserved region, maybe splitting it */
+			if (!lmb.reserved.cnt)
+				break;
+			i = lmb_stress_rand(lmb.reserved.cnt);
+			page = (lmb.reserved.region[i].base - ram) /
+				LMB_STRESS_PAGE;
+			pages = lmb.reserved.region[i].size / LMB_STRESS_PAGE;
+			i = lmb_stress_rand(pages);
+			page += i;
+			pages = 1 + lmb_stress_rand(pages - i);
+			ut_assertok(lmb_free(&lmb, ram + page * LMB_STRESS_PAGE,
+					     pages * LMB_STRESS_PAGE));
+			memset(map + page, 0, pages);
+			break;
+		case 3:
+			/* Allocate anywhere that is free */
+			addr = lmb_alloc(&lmb, pages * LMB_STRESS_PAGE,
+					 LMB_STRESS_PAGE);
+			if (!addr)
+				break;
+			page = (addr - ram) / LMB_STRESS_PAGE;
+			for (i = page; i < page + pages; i++) {
+				ut_assert(!map[i]);
+				map[i] = 1;
+			}
+			break;
+		}
+		max_cnt = max(max_cnt, lmb.reserved.cnt);
+
+		if (!(op % 64))
+			ut_assertok(lmb_stress_check(uts, &lmb, ram, map));
+	}
+	ut_assertok(lmb_stress_check(uts, &lmb, ram, map));
+
+	/* The test is pointless unless the regions were moved to the heap */
+	ut_assert(max_cnt > LMB_RESERVED_REGIONS);
+
+	lmb_uninit(&lmb);
+	free(map);
+
+	return 0;
+}
+
+DM_TEST(lib_test_lmb_stress,
+	UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
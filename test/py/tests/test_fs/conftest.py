@@ -15,6 +15,7 @@ supported_fs_ext = ['fat16', 'fat32']
 supported_fs_mkdir = ['fat16', 'fat32']
 supported_fs_unlink = ['fat16', 'fat32']
 supported_fs_symlink = ['ext4']
+supported_fs_fat_chain = ['fat16', 'fat32']
 
 #
 # Filesystem test specific setup
@@ -51,6 +52,7 @@ def pytest_configure(config):
     global supported_fs_mkdir
     global supported_fs_unlink
     global supported_fs_symlink
+    global supported_fs_fat_chain
 
     def intersect(listA, listB):
         return  [x for x in listA if x in listB]
@@ -63,6 +65,8 @@ def pytest_configure(config):
         supported_fs_mkdir =  intersect(supported_fs, supported_fs_mkdir)
         supported_fs_unlink =  intersect(supported_fs, supported_fs_unlink)
         supported_fs_symlink =  intersect(supported_fs, supported_fs_symlink)
+        supported_fs_fat_chain =  intersect(supported_fs,
+                                            supported_fs_fat_chain)
 
 def pytest_generate_tests(metafunc):
     """Parametrize fixtures, fs_obj_xxx
@@ -91,6 +95,9 @@ def pytest_generate_tests(metafunc):
     if 'fs_obj_symlink' in metafunc.fixturenames:
         metafunc.parametrize('fs_obj_symlink', supported_fs_symlink,
             indirect=True, scope='module')
+    if 'fs_obj_fat_chain' in metafunc.fixturenames:
+        metafunc.parametrize('fs_obj_fat_chain', supported_fs_fat_chain,
+            indirect=True, scope='module')
 
 #
 # Helper functions
@@ -670,3 +677,34 @@ def fs_obj_symlink(request, u_boot_config):
     finally:
         call('rmdir %s' % mount_dir, shell=True)
         call('rm -f %s' % fs_img, shell=True)
+
+#
+# Fixture for FAT cluster chain test
+#
+@pytest.fixture()
+def fs_obj_fat_chain(request, u_boot_config):
+    """Set up a file system to be used in FAT cluster chain test.
+
+    Args:
+        request: Pytest request object.
+        u_boot_config: U-boot configuration.
+
+    Return:
+        A fixture for FAT cluster chain test, i.e. a duplet of file system
+        type and volume file name.
+    """
+    fs_type = request.param
+    fs_img = ''
+
+    fs_ubtype = fstype_to_ubname(fs_type)
+    check_ubconfig(u_boot_config, fs_ubtype)
+
+    try:
+        # 64MiB volume
+        fs_img = mk_fs(u_boot_config, fs_type, 0x4000000, '64MB')
+    except:
+        pytest.skip('Setup failed for filesystem: ' + fs_type)
+        return
+    else:
+        yield [fs_ubtype, fs_img]
+    call('rm -f %s' % fs_img, shell=True)
@@ -0,0 +1,138 @@
+# SPDX-License-Identifier:      GPL-2.0+
+#
+# U-Boot File System: FAT cluster chain test
+
+"""
+This test verifies that the FAT cluster chain of a file, which is kept
+across file system operations, is dropped once the medium behind the
+block device changes.
+"""
+
+import pytest
+import struct
+
+ADDR_WRITE = 0x1000000
+ADDR_READ = 0x2000000
+ADDR_EXPECT = 0x3000000
+FILE = 'CHAIN.BIN'
+
+class FatImage(object):
+    """Minimal access to the FAT and root directory of a fresh volume."""
+
+    def __init__(self, fs_img):
+        self.fs_img = fs_img
+        with open(fs_img, 'rb') as fd:
+            bs = fd.read(512)
+        self.sec_size, = struct.unpack_from('<H', bs, 11)
+        clust_secs = bs[13]
+        rsvd_secs, = struct.unpack_from('<H', bs, 14)
+        self.num_fats = bs[16]
+        root_ents, = struct.unpack_from('<H', bs, 17)
+        self.fat_secs, = struct.unpack_from('<H', bs, 22)
+        self.fat32 = not self.fat_secs
+        if self.fat32:
+            self.fat_secs, = struct.unpack_from('<I', bs, 36)
+        self.clust_size = clust_secs * self.sec_size
+        self.fat_start = rsvd_secs * self.sec_size
+        root_start = self.fat_start + \
+            self.num_fats * self.fat_secs * self.sec_size
+        self.data_start = root_start + root_ents * 32
+        if self.fat32:
+            root_clust, = struct.unpack_from('<I', bs, 44)
+            self.root_start = self.clust_offset(root_clust)
+            self.root_size = self.clust_size
+        else:
+            self.root_start = root_start
+            self.root_size = root_ents * 32
+
+    def clust_offset(self, clust):
+        return self.data_start + (clust - 2) * self.clust_size
+
+    def start_clust(self, name):
+        """Get the first cluster of a file in the root directory."""
+        base, ext = name.split('.')
+        short = ('%-8s%-3s' % (base, ext)).encode()
+        with open(self.fs_img, 'rb') as fd:
+            fd.seek(self.root_start)
+            root = fd.read(self.root_size)
+        for pos in range(0, len(root), 32):
+            if root[pos:pos + 11] == short:
+                hi, = struct.unpack_from('<H', root, pos + 20)
+                lo, = struct.unpack_from('<H', root, pos + 26)
+                return hi << 16 | lo
+        return None
+
+    def get_fatent(self, fd, clust):
+        if self.fat32:
+            fd.seek(self.fat_start + clust * 4)
+            return struct.unpack('<I', fd.read(4))[0] & 0x0fffffff
+        fd.seek(self.fat_start + clust * 2)
+        return struct.unpack('<H', fd.read(2))[0]
+
+    def set_fatent(self, fd, clust, val):
+        fat_size = self.fat_secs * self.sec_size
+        for i in range(self.num_fats):
+            if self.fat32:
+                fd.seek(self.fat_start + i * fat_size + clust * 4)
+                old, = struct.unpack('<I', fd.read(4))
+                fd.seek(-4, 1)
+                fd.write(struct.pack('<I', old & 0xf0000000 | val))
+            else:
+                fd.seek(self.fat_start + i * fat_size + clust * 2)
+                fd.write(struct.pack('<H', val))
+
+    def move_second_clust(self, name, fill):
+        """Move the second cluster of a file to a free cluster.
+
+        The new cluster is filled with 'fill'; the directory entry of the
+        file stays exactly as it was.
+        """
+        eoc = 0x0fffffff if self.fat32 else 0xffff
+        first = self.start_clust(name)
+        with open(self.fs_img, 'r+b') as fd:
+            second = self.get_fatent(fd, first)
+            new = second + 1
+            while self.get_fatent(fd, new):
+                new += 1
+            fd.seek(self.clust_offset(new))
+            fd.write(bytes([fill]) * self.clust_size)
+            self.set_fatent(fd, new, self.get_fatent(fd, second))
+            self.set_fatent(fd, second, 0)
+            self.set_fatent(fd, first, new)
+            assert self.get_fatent(fd, new) == eoc
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.slow
+class TestFatChain(object):
+    def test_fat_chain1(self, u_boot_console, fs_obj_fat_chain):
+        """
+        Test Case 1 - read a file again after its chain changed on a new
+        medium
+        """
+        fs_type,fs_img = fs_obj_fat_chain
+        fat = FatImage(fs_img)
+        clust = fat.clust_size
+        size = 2 * clust
+        with u_boot_console.log.section('Test Case 1a - write and read'):
+            output = u_boot_console.run_command_list([
+                'host bind 0 %s' % fs_img,
+                'mw.b %x 5a %x' % (ADDR_WRITE, size),
+                '%swrite host 0:0 %x /%s %x'
+                    % (fs_type, ADDR_WRITE, FILE, size),
+                '%sload host 0:0 %x /%s' % (fs_type, ADDR_READ, FILE),
+                'cmp.b %x %x %x' % (ADDR_WRITE, ADDR_READ, size)])
+            assert('Total of %d byte(s) were the same' % size
+                   in ''.join(output))
+
+        with u_boot_console.log.section('Test Case 1b - read new medium'):
+            # Same directory entry, but another second cluster
+            fat.move_second_clust(FILE, 0xa5)
+            output = u_boot_console.run_command_list([
+                'host bind 0 %s' % fs_img,
+                'mw.b %x 5a %x' % (ADDR_EXPECT, clust),
+                'mw.b %x a5 %x' % (ADDR_EXPECT + clust, clust),
+                'mw.b %x 0 %x' % (ADDR_READ, size),
+                '%sload host 0:0 %x /%s' % (fs_type, ADDR_READ, FILE),
+                'cmp.b %x %x %x' % (ADDR_EXPECT, ADDR_READ, size)])
+            assert('Total of %d byte(s) were the same' % size
+                   in ''.join(output))